@@ -34,6 +34,7 @@ DuinoCube::Core DuinoCubeClass::Core;
 DuinoCube::File DuinoCubeClass::File;
 DuinoCube::Mem DuinoCubeClass::Mem;
 DuinoCube::RPC DuinoCubeClass::RPC;
+DuinoCube::VM DuinoCubeClass::VM;
 
 static FILE uart_stdout;  // For linking UART to printf, etc.
 static int uart_putchar (char c, FILE *stream) {
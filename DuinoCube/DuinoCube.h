@@ -25,8 +25,11 @@
 #include "gamepad.h"
 #include "mem.h"
 #include "rpc.h"
+#include "shared_array.h"
 #include "usb.h"
 #include "utils.h"
+#include "vm.h"
+#include "xaddr.h"
 
 class DuinoCubeClass {
  public:
@@ -40,6 +43,7 @@ class DuinoCubeClass {
   static DuinoCube::Mem Mem;
   static DuinoCube::RPC RPC;
   static DuinoCube::USB USB;
+  static DuinoCube::VM VM;
 };
 
 extern DuinoCubeClass DC;
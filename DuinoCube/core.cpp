@@ -24,6 +24,10 @@
 
 #include "file.h"
 #include "pins.h"
+#include "rpc.h"
+#include "rpc_file.h"
+#include "spi_burst.h"
+#include "xaddr.h"
 
 #define WRITE_BIT_MASK      0x80
 
@@ -32,9 +36,77 @@ extern SPIClass SPI;
 namespace DuinoCube {
 
 static File file;
+static Mem mem;
+static RPC rpc;
+
+// Loads a file into Core memory at |addr|, reading at most |max_size| bytes.
+// The open, size, read and close RPCs are issued as one batch so that they take
+// only one RPC handshake. Returns true if the entire file was loaded.
+static bool LoadFileToCore(const char* filename, uint16_t addr,
+                           uint16_t max_size) {
+  // Copy the name string to shared memory (including null terminator).
+  mem.write(STRING_BUF_ADDR, filename, strlen(filename) + 1);
+
+  RPCBatch batch;
+
+  RPC_FileOpenArgs open_args;
+  open_args.in.filename_addr = STRING_BUF_ADDR;
+  open_args.in.mode = FILE_READ_ONLY;
+  uint8_t open_entry = batch.add(RPC_CMD_FILE_OPEN,
+                                 &open_args.in, sizeof(open_args.in),
+                                 sizeof(open_args.out));
+
+  // The remaining commands take the handle returned by RPC_CMD_FILE_OPEN. The
+  // handle is the first field of each of their arg structs.
+  RPC_FileSizeArgs size_args;
+  size_args.in.handle = 0;
+  uint8_t size_entry = batch.addLinked(RPC_CMD_FILE_SIZE,
+                                       &size_args.in, sizeof(size_args.in),
+                                       sizeof(size_args.out), open_entry, 0, 0);
+
+  // The Core memory space is at 0x8000, from the coprocessor's point of view.
+  RPC_FileReadArgs read_args;
+  read_args.in.handle = 0;
+  read_args.in.dst_addr = addr + SHARED_MEMORY_SIZE;
+  read_args.in.size = max_size;
+  uint8_t read_entry = batch.addLinked(RPC_CMD_FILE_READ,
+                                       &read_args.in, sizeof(read_args.in),
+                                       sizeof(read_args.out), open_entry, 0, 0);
+
+  RPC_FileCloseArgs close_args;
+  close_args.in.handle = 0;
+  uint8_t close_entry = batch.addLinked(RPC_CMD_FILE_CLOSE,
+                                        &close_args.in, sizeof(close_args.in),
+                                        0, open_entry, 0, 0);
+
+  // The batch stops at the first entry that does not succeed. If the file was
+  // opened but that happened before the close, close it here so that the
+  // handle is not lost.
+  uint16_t num_executed = batch.exec();
+  if (num_executed <= close_entry) {
+    if (num_executed > open_entry) {
+      batch.readOutput(open_entry, &open_args.out, sizeof(open_args.out));
+      if (open_args.out.handle) {
+        close_args.in.handle = open_args.out.handle;
+        rpc.exec(RPC_CMD_FILE_CLOSE, &close_args.in, sizeof(close_args.in),
+                 NULL, 0);
+      }
+    }
+    return false;
+  }
+
+  batch.readOutput(size_entry, &size_args.out, sizeof(size_args.out));
+  batch.readOutput(read_entry, &read_args.out, sizeof(read_args.out));
+  return (size_args.out.size == read_args.out.size_read);
+}
 
 // Static member variables.
 Core::TileRegs Core::s_tile_regs[NUM_TILE_LAYERS];
+CoreWriteQueue* Core::s_write_queue;
+uint16_t Core::s_saved_sys_ctrl;
+uint16_t Core::s_saved_mem_bank;
+uint16_t Core::s_sys_ctrl;
+uint16_t Core::s_mem_bank;
 
 void Core::begin() {
   SET_PIN(CORE_SELECT_DIR, OUTPUT);
@@ -45,11 +117,9 @@ void Core::begin() {
 
   // Reset the system.
   writeWord(REG_SYS_CTRL, (1 << REG_SYS_CTRL_RESET));
-  // Sprites have to be disabled manually. The register reset doesn't reset
+  // Sprites have to be cleared manually. The register reset doesn't reset
   // them.
-  for (uint16_t i = 0; i < NUM_SPRITES; ++i) {
-    disableSprite(i);
-  }
+  fill(SPRITE_BASE, 0, NUM_SPRITES * NUM_SPRITE_REGS * sizeof(uint16_t));
 
   // Clear cached tile register values.
   memset(s_tile_regs, 0, sizeof(s_tile_regs));
@@ -64,7 +134,7 @@ void Core::moveCamera(int16_t x, int16_t y) {
   values.x = x;
   values.y = y;
 
-  writeData(REG_SCROLL_X, &values, sizeof(values));
+  writeRegs(REG_SCROLL_X, (const uint16_t*) &values, 2);
 }
 
 void Core::waitForEvent(uint16_t events) {
@@ -98,32 +168,14 @@ void Core::waitForEvent(uint16_t events) {
 }
 
 bool Core::loadPalette(const char* filename, uint8_t palette_index) {
-  uint16_t handle = file.open(filename, FILE_READ_ONLY);
-  if (!handle) {
-    return false;
-  }
-  uint32_t file_size = file.size(handle);
-  uint32_t size_read =
-      file.readToCore(handle, PALETTE(palette_index), file_size);
-
-  file.close(handle);
-  return (file_size == size_read);
+  return LoadFileToCore(filename, PALETTE(palette_index), PALETTE_SIZE);
 }
 
 bool Core::loadTilemap(const char* filename, uint8_t tilemap_index) {
-  uint16_t handle = file.open(filename, FILE_READ_ONLY);
-  if (!handle) {
-    return false;
-  }
-
+  // The tilemap bank is only mapped while VRAM access is off.
+  writeWord(REG_SYS_CTRL, (0 << REG_SYS_CTRL_VRAM_ACCESS));
   writeWord(REG_MEM_BANK, TILEMAP_BANK);
-
-  uint32_t file_size = file.size(handle);
-  uint32_t size_read =
-      file.readToCore(handle, TILEMAP(tilemap_index), file_size);
-
-  file.close(handle);
-  return (file_size == size_read);
+  return LoadFileToCore(filename, TILEMAP(tilemap_index), TILEMAP_SIZE);
 }
 
 uint32_t Core::loadImageData(const char* filename, uint32_t vram_offset) {
@@ -134,50 +186,67 @@ uint32_t Core::loadImageData(const char* filename, uint32_t vram_offset) {
 
   uint32_t file_size = file.size(handle);
 
-  // Allow access to the VRAM.
-  writeWord(REG_SYS_CTRL, (1 << REG_SYS_CTRL_VRAM_ACCESS));
-
+  beginVRAMAccess();
   uint32_t total_size_read = 0;
-  while (true) {
-    // Calculate the bank and offset within the bank.
-    uint16_t bank_offset = vram_offset % VRAM_BANK_SIZE;
-
-    // Select the current bank.
-    writeWord(REG_MEM_BANK, VRAM_BANK_BEGIN + (vram_offset / VRAM_BANK_SIZE));
-
-    uint16_t bank_size_remaining = VRAM_BANK_SIZE - bank_offset;
-    uint16_t size_read =
-        file.readToCore(handle, VRAM_BASE + bank_offset, bank_size_remaining);
-    // Exit conditions: reached end of data or reached file size.
+  while (total_size_read < file_size) {
+    // Read up to the end of the current bank.
+    uint16_t addr;
+    uint16_t bank_size_remaining = selectVRAMBank(vram_offset, &addr);
+    uint16_t size_read = file.readToCore(handle, addr, bank_size_remaining);
     if (size_read == 0) {
       break;
     }
     total_size_read += size_read;
-    if (total_size_read >= file_size) {
-      break;
-    }
-
-    // Go to the next bank.
-    vram_offset += bank_size_remaining;
+    vram_offset += size_read;
   }
+  endVRAMAccess();
   file.close(handle);
 
-  // Turn off access to VRAM.
-  writeWord(REG_SYS_CTRL, (0 << REG_SYS_CTRL_VRAM_ACCESS));
-
   return total_size_read;
 }
 
+void Core::writeVRAM(uint32_t vram_offset, const void* data, uint16_t size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  beginVRAMAccess();
+  while (size > 0) {
+    uint16_t addr;
+    uint16_t chunk = selectVRAMBank(vram_offset, &addr);
+    if (chunk > size)
+      chunk = size;
+    writeCoreData(addr, bytes, chunk);
+    bytes += chunk;
+    vram_offset += chunk;
+    size -= chunk;
+  }
+  endVRAMAccess();
+}
+
+void Core::readVRAM(uint32_t vram_offset, void* data, uint16_t size) {
+  uint8_t* bytes = static_cast<uint8_t*>(data);
+  beginVRAMAccess();
+  while (size > 0) {
+    uint16_t addr;
+    uint16_t chunk = selectVRAMBank(vram_offset, &addr);
+    if (chunk > size)
+      chunk = size;
+    readData(addr, bytes, chunk);
+    bytes += chunk;
+    vram_offset += chunk;
+    size -= chunk;
+  }
+  endVRAMAccess();
+}
+
 void Core::enableTileLayer(uint8_t layer_index) {
-  TileRegs& regs = s_tile_regs[layer_index];
+  TileRegs& regs = getTileRegs(layer_index);
   regs.enabled = 1;
-  writeData(TILE_LAYER_REG(layer_index, TILE_CTRL_0), &regs, sizeof(regs));
+  writeReg(TILE_LAYER_REG(layer_index, TILE_CTRL_0), regs.value);
 }
 
 void Core::disableTileLayer(uint8_t layer_index) {
-  TileRegs& regs = s_tile_regs[layer_index];
+  TileRegs& regs = getTileRegs(layer_index);
   regs.enabled = 0;
-  writeData(TILE_LAYER_REG(layer_index, TILE_CTRL_0), &regs, sizeof(regs));
+  writeReg(TILE_LAYER_REG(layer_index, TILE_CTRL_0), regs.value);
 }
 
 void Core::moveTileLayer(uint8_t layer_index, int16_t x, int16_t y) {
@@ -188,46 +257,63 @@ void Core::moveTileLayer(uint8_t layer_index, int16_t x, int16_t y) {
   values.y = y;
 
   // Block copy both x and y values at the same time.
-  writeData(TILE_LAYER_REG(layer_index, TILE_OFFSET_X),
-            &values, sizeof(values));
+  writeRegs(TILE_LAYER_REG(layer_index, TILE_OFFSET_X),
+            (const uint16_t*) &values, 2);
 }
 
 void Core::setTileLayerProperty(uint8_t layer_index, uint16_t property,
                                 uint16_t value) {
-  TileRegs& regs = s_tile_regs[layer_index];
+  TileRegs& regs = getTileRegs(layer_index);
   switch (property) {
   case TILE_PROP_FLAGS:
     // Apply the flags. Be sure not to touch the other parts of the register
     // value.
     regs.value &= ~TILE_FLAGS_MASK;
     regs.value |= (value & TILE_FLAGS_MASK);
-    writeData(TILE_LAYER_REG(layer_index, TILE_CTRL_0), &regs, sizeof(regs));
+    writeReg(TILE_LAYER_REG(layer_index, TILE_CTRL_0), regs.value);
     break;
   case TILE_PROP_PALETTE:
     regs.palette = value;
-    writeData(TILE_LAYER_REG(layer_index, TILE_CTRL_0), &regs, sizeof(regs));
+    writeReg(TILE_LAYER_REG(layer_index, TILE_CTRL_0), regs.value);
     break;
   default:
     // Otherwise, treat the property index as a register value.
-    writeWord(TILE_LAYER_REG(layer_index, property), value);
+    writeReg(TILE_LAYER_REG(layer_index, property), value);
     break;
   }
 }
 
+uint16_t Core::getTileLayerProperty(uint8_t layer_index, uint16_t property) {
+  const TileRegs& regs = getTileRegs(layer_index);
+  switch (property) {
+  case TILE_PROP_FLAGS:
+    return regs.value & TILE_FLAGS_MASK;
+  case TILE_PROP_PALETTE:
+    return regs.palette;
+  default:
+    return readReg(TILE_LAYER_REG(layer_index, property));
+  }
+}
+
+void Core::reloadTileLayerRegs() {
+  for (uint8_t layer = 0; layer < NUM_TILE_LAYERS; ++layer)
+    s_tile_regs[layer].value = readReg(TILE_LAYER_REG(layer, TILE_CTRL_0));
+}
+
 void Core::setSpriteDepth(uint8_t depth) {
-  writeWord(REG_SPRITE_Z, depth);
+  writeReg(REG_SPRITE_Z, depth);
 }
 
 void Core::enableSprite(uint8_t sprite_index) {
-  uint16_t reg_value = readWord(SPRITE_REG(sprite_index, SPRITE_CTRL_0));
+  uint16_t reg_value = readReg(SPRITE_REG(sprite_index, SPRITE_CTRL_0));
   reg_value |= (1 << SPRITE_ENABLED);
-  writeWord(SPRITE_REG(sprite_index, SPRITE_CTRL_0), reg_value);
+  writeReg(SPRITE_REG(sprite_index, SPRITE_CTRL_0), reg_value);
 }
 
 void Core::disableSprite(uint8_t sprite_index) {
-  uint16_t reg_value = readWord(SPRITE_REG(sprite_index, SPRITE_CTRL_0));
+  uint16_t reg_value = readReg(SPRITE_REG(sprite_index, SPRITE_CTRL_0));
   reg_value &= ~(1 << SPRITE_ENABLED);
-  writeWord(SPRITE_REG(sprite_index, SPRITE_CTRL_0), reg_value);
+  writeReg(SPRITE_REG(sprite_index, SPRITE_CTRL_0), reg_value);
 }
 
 void Core::moveSprite(uint8_t sprite_index, int16_t x, int16_t y) {
@@ -238,7 +324,24 @@ void Core::moveSprite(uint8_t sprite_index, int16_t x, int16_t y) {
   values.y = y;
 
   // Block copy both x and y values at the same time.
-  writeData(SPRITE_REG(sprite_index, SPRITE_OFFSET_X), &values, sizeof(values));
+  writeRegs(SPRITE_REG(sprite_index, SPRITE_OFFSET_X),
+            (const uint16_t*) &values, 2);
+}
+
+void Core::moveSprites(uint8_t first_index, uint16_t count,
+                        const SpriteXY* locations) {
+  // Don't run past the end of the sprite table.
+  if (count > NUM_SPRITES - first_index)
+    count = NUM_SPRITES - first_index;
+  writeCoreData(SPRITE_XY(first_index), locations, count * sizeof(SpriteXY));
+}
+
+uint16_t Core::moveSpritesFromMem(uint8_t first_index, uint16_t count,
+                                  uint16_t addr) {
+  if (count > NUM_SPRITES - first_index)
+    count = NUM_SPRITES - first_index;
+  return mem.copy(XADDR_CORE(SPRITE_XY(first_index)), XADDR_SHMEM(addr),
+                  count * sizeof(SpriteXY));
 }
 
 void Core::setSpriteProperty(uint8_t sprite_index, uint16_t property,
@@ -249,49 +352,203 @@ void Core::setSpriteProperty(uint8_t sprite_index, uint16_t property,
   case SPRITE_PROP_FLAGS:
     // Apply the flags. Be sure not to touch the other parts of the register
     // value.
-    regs.values[SPRITE_CTRL_0] = readWord(SPRITE_REG(index, SPRITE_CTRL_0));
+    regs.values[SPRITE_CTRL_0] = readReg(SPRITE_REG(index, SPRITE_CTRL_0));
     regs.values[SPRITE_CTRL_0] &= ~SPRITE_FLAGS_MASK;
     regs.values[SPRITE_CTRL_0] |= (value & SPRITE_FLAGS_MASK);
-    writeWord(SPRITE_REG(index, SPRITE_CTRL_0), regs.values[SPRITE_CTRL_0]);
+    writeReg(SPRITE_REG(index, SPRITE_CTRL_0), regs.values[SPRITE_CTRL_0]);
     break;
   case SPRITE_PROP_ORIENTATION:
-    regs.values[SPRITE_CTRL_0] = readWord(SPRITE_REG(index, SPRITE_CTRL_0));
+    regs.values[SPRITE_CTRL_0] = readReg(SPRITE_REG(index, SPRITE_CTRL_0));
     regs.values[SPRITE_CTRL_0] &= ~SPRITE_FLIP_MASK;
     regs.values[SPRITE_CTRL_0] |= (value & SPRITE_FLIP_MASK);
-    writeWord(SPRITE_REG(index, SPRITE_CTRL_0), regs.values[SPRITE_CTRL_0]);
+    writeReg(SPRITE_REG(index, SPRITE_CTRL_0), regs.values[SPRITE_CTRL_0]);
     break;
   case SPRITE_PROP_PALETTE:
-    regs.values[SPRITE_CTRL_0] = readWord(SPRITE_REG(index, SPRITE_CTRL_0));
+    regs.values[SPRITE_CTRL_0] = readReg(SPRITE_REG(index, SPRITE_CTRL_0));
     regs.palette = value;
-    writeWord(SPRITE_REG(index, SPRITE_CTRL_0), regs.values[SPRITE_CTRL_0]);
+    writeReg(SPRITE_REG(index, SPRITE_CTRL_0), regs.values[SPRITE_CTRL_0]);
     break;
   case SPRITE_PROP_WIDTH:
   case SPRITE_PROP_HEIGHT:
-    regs.values[SPRITE_CTRL_1] = readWord(SPRITE_REG(index, SPRITE_CTRL_1));
+    regs.values[SPRITE_CTRL_1] = readReg(SPRITE_REG(index, SPRITE_CTRL_1));
     if (property == SPRITE_PROP_WIDTH) {
       regs.width = value;
     } else {
       regs.height = value;
     }
-    writeWord(SPRITE_REG(index, SPRITE_CTRL_1), regs.values[SPRITE_CTRL_1]);
+    writeReg(SPRITE_REG(index, SPRITE_CTRL_1), regs.values[SPRITE_CTRL_1]);
     break;
   default:
     // Otherwise, treat the property type as a register value.
     // Make sure to adjust the property type by |NUM_SPRITE_REGS|.
-    writeWord(SPRITE_REG(index, property - NUM_SPRITE_REGS), value);
+    writeReg(SPRITE_REG(index, property - NUM_SPRITE_REGS), value);
     break;
   }
 }
 
+void Core::beginWrites(CoreWriteQueue* queue) {
+  queue->num_writes = 0;
+  s_write_queue = queue;
+}
+
+void Core::flushWrites() {
+  CoreWriteQueue* queue = s_write_queue;
+  if (!queue)
+    return;
+
+  // Sort the queued writes by address. The queue is short, so insertion sort
+  // will do.
+  for (uint8_t i = 1; i < queue->num_writes; ++i) {
+    uint16_t addr = queue->addrs[i];
+    uint16_t value = queue->values[i];
+    uint8_t j = i;
+    for (; j > 0 && queue->addrs[j - 1] > addr; --j) {
+      queue->addrs[j] = queue->addrs[j - 1];
+      queue->values[j] = queue->values[j - 1];
+    }
+    queue->addrs[j] = addr;
+    queue->values[j] = value;
+  }
+
+  // The values of a run of adjacent registers are now next to each other, so
+  // each run is written straight from the queue.
+  uint8_t run_start = 0;
+  for (uint8_t i = 1; i <= queue->num_writes; ++i) {
+    if (i < queue->num_writes && queue->addrs[i] == queue->addrs[i - 1] + 2)
+      continue;
+    writeCoreData(queue->addrs[run_start], &queue->values[run_start],
+                  (i - run_start) * sizeof(queue->values[0]));
+    run_start = i;
+  }
+  queue->num_writes = 0;
+}
+
+void Core::endWrites() {
+  flushWrites();
+  s_write_queue = NULL;
+}
+
+void Core::writeRegs(uint16_t addr, const uint16_t* values, uint8_t count) {
+  CoreWriteQueue* queue = s_write_queue;
+  if (!queue) {
+    writeData(addr, values, count * sizeof(values[0]));
+    return;
+  }
+
+  updateTileLayerRegs(addr, values, count * sizeof(values[0]));
+  for (uint8_t i = 0; i < count; ++i, addr += sizeof(values[0])) {
+    // A later write to the same register replaces the earlier one.
+    uint8_t index = 0;
+    while (index < queue->num_writes && queue->addrs[index] != addr)
+      ++index;
+    if (index == CORE_WRITE_QUEUE_SIZE) {
+      flushWrites();
+      index = 0;
+    }
+    if (index == queue->num_writes)
+      ++queue->num_writes;
+    queue->addrs[index] = addr;
+    queue->values[index] = values[i];
+  }
+}
+
+uint16_t Core::readReg(uint16_t addr) {
+  const CoreWriteQueue* queue = s_write_queue;
+  for (uint8_t i = 0; queue && i < queue->num_writes; ++i) {
+    if (queue->addrs[i] == addr)
+      return queue->values[i];
+  }
+  return readWord(addr);
+}
+
+void Core::updateTileLayerRegs(uint16_t addr, const void* data,
+                               uint16_t size) {
+  const uint16_t kTileRegsEnd = TILE_LAYER_REG(NUM_TILE_LAYERS, 0);
+  if (addr >= kTileRegsEnd || addr + size <= TILE_REG_BASE)
+    return;
+
+  // Copy the bytes that fall within the TILE_CTRL_0 register of a layer.
+  const uint8_t* bytes = (const uint8_t*) data;
+  for (uint8_t layer = 0; layer < NUM_TILE_LAYERS; ++layer) {
+    uint16_t reg_addr = TILE_LAYER_REG(layer, TILE_CTRL_0);
+    for (uint8_t i = 0; i < sizeof(s_tile_regs[0]); ++i) {
+      if (reg_addr + i >= addr && reg_addr + i < addr + size)
+        ((uint8_t*) &s_tile_regs[layer])[i] = bytes[reg_addr + i - addr];
+    }
+  }
+}
+
 void Core::writeData(uint16_t addr, const void* data, uint16_t size) {
+  updateTileLayerRegs(addr, data, size);
+  writeCoreData(addr, data, size);
+}
+
+void Core::beginVRAMAccess() {
+  // REG_SYS_CTRL and REG_MEM_BANK are adjacent, so read them together. Only
+  // the VRAM access bit is saved. Writing back the other bits, such as the
+  // reset bit, would have side effects.
+  uint16_t regs[2];
+  readData(REG_SYS_CTRL, regs, sizeof(regs));
+  s_saved_sys_ctrl = regs[0] & (1 << REG_SYS_CTRL_VRAM_ACCESS);
+  s_saved_mem_bank = regs[1];
+  s_sys_ctrl = s_saved_sys_ctrl;
+  s_mem_bank = s_saved_mem_bank;
+}
+
+uint16_t Core::selectVRAMBank(uint32_t vram_offset, uint16_t* addr) {
+  const uint16_t kSysCtrl = (1 << REG_SYS_CTRL_VRAM_ACCESS);
+  if (s_sys_ctrl != kSysCtrl) {
+    s_sys_ctrl = kSysCtrl;
+    writeWord(REG_SYS_CTRL, s_sys_ctrl);
+  }
+  uint16_t bank = GET_VRAM_BANK(vram_offset);
+  if (s_mem_bank != bank) {
+    s_mem_bank = bank;
+    writeWord(REG_MEM_BANK, s_mem_bank);
+  }
+
+  uint16_t bank_offset = GET_VRAM_BANK_OFFSET(vram_offset);
+  *addr = VRAM_BASE + bank_offset;
+  return VRAM_BANK_SIZE - bank_offset;
+}
+
+void Core::endVRAMAccess() {
+  if (s_sys_ctrl != s_saved_sys_ctrl)
+    writeWord(REG_SYS_CTRL, s_saved_sys_ctrl);
+  if (s_mem_bank != s_saved_mem_bank)
+    writeWord(REG_MEM_BANK, s_saved_mem_bank);
+}
+
+void Core::writeCoreData(uint16_t addr, const void* data, uint16_t size) {
   SET_PIN(CORE_SELECT_PIN, LOW);
 
-  SPI.transfer(highByte(addr) | WRITE_BIT_MASK);
-  SPI.transfer(lowByte(addr));
+  uint8_t header[] = {
+    (uint8_t)(highByte(addr) | WRITE_BIT_MASK), lowByte(addr)
+  };
+  spiBurstWrite(header, sizeof(header));
+  spiBurstWrite(data, size);
+
+  SET_PIN(CORE_SELECT_PIN, HIGH);
+}
+
+void Core::fill(uint16_t addr, uint16_t value, uint16_t size) {
+  // Update the tile layer register copy one pattern word at a time, but only
+  // if the range overlaps the tile registers.
+  const uint16_t kTileRegsEnd = TILE_LAYER_REG(NUM_TILE_LAYERS, 0);
+  if (addr < kTileRegsEnd && addr + size > TILE_REG_BASE) {
+    for (uint16_t i = 0; i < size; i += sizeof(value)) {
+      updateTileLayerRegs(addr + i, &value,
+                          (size - i < sizeof(value)) ? 1 : sizeof(value));
+    }
+  }
+
+  SET_PIN(CORE_SELECT_PIN, LOW);
 
-  const uint8_t* data8 = static_cast<const uint8_t*>(data);
-  for (const uint8_t* data_end = data8 + size; data8 < data_end; ++data8)
-    SPI.transfer(*data8);
+  uint8_t header[] = {
+    (uint8_t)(highByte(addr) | WRITE_BIT_MASK), lowByte(addr)
+  };
+  spiBurstWrite(header, sizeof(header));
+  spiBurstFill(value, size);
 
   SET_PIN(CORE_SELECT_PIN, HIGH);
 }
@@ -299,17 +556,18 @@ void Core::writeData(uint16_t addr, const void* data, uint16_t size) {
 void Core::readData(uint16_t addr, void* data, uint16_t size) {
   SET_PIN(CORE_SELECT_PIN, LOW);
 
-  SPI.transfer(highByte(addr) & ~WRITE_BIT_MASK);
-  SPI.transfer(lowByte(addr));
-
-  uint8_t* data8 = static_cast<uint8_t*>(data);
-  for (uint8_t* data_end = data8 + size; data8 < data_end; ++data8)
-    *data8 = SPI.transfer(lowByte(addr));
+  uint8_t header[] = {
+    (uint8_t)(highByte(addr) & ~WRITE_BIT_MASK), lowByte(addr)
+  };
+  spiBurstWrite(header, sizeof(header));
+  spiBurstRead(data, size);
 
   SET_PIN(CORE_SELECT_PIN, HIGH);
 }
 
 void Core::writeByte(uint16_t addr, uint8_t data) {
+  updateTileLayerRegs(addr, &data, sizeof(data));
+
   SET_PIN(CORE_SELECT_PIN, LOW);
 
   SPI.transfer(highByte(addr) | WRITE_BIT_MASK);
@@ -332,6 +590,8 @@ uint8_t Core::readByte(uint16_t addr) {
 }
 
 void Core::writeWord(uint16_t addr, uint16_t data) {
+  updateTileLayerRegs(addr, &data, sizeof(data));
+
   SET_PIN(CORE_SELECT_PIN, LOW);
 
   SPI.transfer(highByte(addr) | WRITE_BIT_MASK);
@@ -359,4 +619,82 @@ uint16_t Core::readWord(uint16_t addr) {
   return value_16;
 }
 
+Core::WriteList::WriteList() : addr_(0), size_(0), used_(0), buffer_(0) {}
+
+bool Core::WriteList::begin(uint16_t size) {
+  end();
+  // Both buffers must fit in the 16-bit size passed to Mem::alloc().
+  if (size > 0x7fff)
+    return false;
+  addr_ = mem.alloc(size * 2);
+  if (!addr_)
+    return false;
+  size_ = size;
+  return true;
+}
+
+void Core::WriteList::end() {
+  if (!addr_)
+    return;
+  wait();
+  mem.free(addr_);
+  addr_ = 0;
+  size_ = 0;
+  used_ = 0;
+  buffer_ = 0;
+}
+
+bool Core::WriteList::add(uint16_t addr, const void* data, uint16_t size) {
+  RPC_WriteListEntry entry;
+  if (size > size_ - used_ || sizeof(entry) > size_ - used_ - size)
+    return false;
+
+  // Keep the client's copy of the tile layer registers up to date.
+  updateTileLayerRegs(addr, data, size);
+
+  uint16_t entry_addr = addr_ + buffer_ * size_ + used_;
+  entry.addr = addr;
+  entry.size = size;
+  mem.write(entry_addr, &entry, sizeof(entry));
+  mem.write(entry_addr + sizeof(entry), data, size);
+  used_ += sizeof(entry) + size;
+  return true;
+}
+
+bool Core::WriteList::addWord(uint16_t addr, uint16_t value) {
+  return add(addr, &value, sizeof(value));
+}
+
+uint16_t Core::WriteList::submit() {
+  // Only one list can be waiting at a time.
+  wait();
+
+  // Use the priority lane so that the list is not held up behind other
+  // commands, and is ready in time for the vertical blank.
+  RPC_CoreWriteListArgs args;
+  args.in.list_addr = addr_ + buffer_ * size_;
+  args.in.list_size = used_;
+  uint16_t status = rpc.execPriority(RPC_CMD_CORE_WRITE_LIST,
+                                     &args.in, sizeof(args.in), NULL, 0);
+
+  // The other buffer is free, since its list has already been applied. If the
+  // list was not accepted, keep it so that it can be submitted again.
+  if (status == RPC_STATUS_OK) {
+    buffer_ ^= 1;
+    used_ = 0;
+  }
+  return status;
+}
+
+bool Core::WriteList::isPending() const {
+  RPC_CoreWriteListStatusArgs args;
+  rpc.execPriority(RPC_CMD_CORE_WRITE_LIST_STATUS, NULL, 0,
+                   &args.out, sizeof(args.out));
+  return args.out.pending;
+}
+
+void Core::WriteList::wait() const {
+  while (isPending());
+}
+
 }  // namespace DuinoCube
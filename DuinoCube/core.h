@@ -23,6 +23,7 @@
 #include <stdint.h>
 
 #include "core_defs.h"
+#include "rpc_core.h"
 
 // Event masks used by waitForEvent().
 #define CORE_EVENT_VBLANK_BEGIN   (1 << 0)
@@ -79,8 +80,26 @@
 #define SPRITE_SIZE_32        2
 #define SPRITE_SIZE_64        3
 
+// Max number of register writes that are queued while writes are combined.
+#define CORE_WRITE_QUEUE_SIZE        32
+
 namespace DuinoCube {
 
+// Location of a sprite, laid out like the sprite's X/Y alias registers at
+// SPRITE_XY(index).
+struct SpriteXY {
+  int16_t x, y;
+};
+
+// Queue of combined register writes, with at most one write per address. It is
+// only needed while writes are combined, so it is provided by the caller of
+// Core::beginWrites(), e.g. on the stack while a scene is set up.
+struct CoreWriteQueue {
+  uint16_t addrs[CORE_WRITE_QUEUE_SIZE];
+  uint16_t values[CORE_WRITE_QUEUE_SIZE];
+  uint8_t num_writes;
+};
+
 class Core {
  public:
   // Initialize and teardown functions.
@@ -95,21 +114,63 @@ class Core {
   static bool loadTilemap(const char* filename, uint8_t tilemap_index);
   static uint32_t loadImageData(const char* filename, uint32_t vram_offset);
 
+  // Write or read |size| bytes of VRAM at |vram_offset|, which counts from the
+  // start of the first VRAM bank. Transfers are split where they cross into the
+  // next bank. The memory bank and VRAM access are only written when they need
+  // to change, and are restored afterwards, as with loadImageData(). Tilemap
+  // bank writes need VRAM access to be off, so turn it off explicitly before
+  // them rather than relying on the restored state.
+  static void writeVRAM(uint32_t vram_offset, const void* data, uint16_t size);
+  static void readVRAM(uint32_t vram_offset, void* data, uint16_t size);
+
   // Tile layer functions.
   static void enableTileLayer(uint8_t layer_index);
   static void disableTileLayer(uint8_t layer_index);
   static void moveTileLayer(uint8_t layer_index, int16_t x, int16_t y);
   static void setTileLayerProperty(uint8_t layer_index, uint16_t property,
                                    uint16_t value);
+  // Returns the value of a tile layer property. |property| is a TILE_PROP_*
+  // value or a register index. TILE_PROP_FLAGS and TILE_PROP_PALETTE come from
+  // a copy of TILE_CTRL_0 kept on the client, and other registers are read
+  // back.
+  static uint16_t getTileLayerProperty(uint8_t layer_index, uint16_t property);
+  // The copy of TILE_CTRL_0 is kept up to date by writes from the client,
+  // including write lists. Writes made by the coprocessor on its own, e.g.
+  // Mem::copy() and Mem::fill() into the tile registers or VM scripts, are not
+  // seen, so call this after them to read the registers back into the copy.
+  static void reloadTileLayerRegs();
 
   // Sprite functions.
   static void setSpriteDepth(uint8_t depth);
   static void enableSprite(uint8_t sprite_index);
   static void disableSprite(uint8_t sprite_index);
   static void moveSprite(uint8_t sprite_index, int16_t x, int16_t y);
+  // Moves |count| sprites starting at |first_index| to the locations in
+  // |locations|, in one burst through the X/Y alias registers. The writes are
+  // never queued for write combining. |count| is clamped to the sprites from
+  // |first_index| to the end of the sprite table.
+  static void moveSprites(uint8_t first_index, uint16_t count,
+                          const SpriteXY* locations);
+  // Same, but the coprocessor copies the SpriteXY locations from shared memory
+  // at |addr|. Returns an RPC_STATUS_* code.
+  static uint16_t moveSpritesFromMem(uint8_t first_index, uint16_t count,
+                                     uint16_t addr);
   static void setSpriteProperty(uint8_t sprite_index, uint16_t property,
                                 uint16_t value);
 
+  // Write combining. Between beginWrites() and endWrites(), register writes
+  // made by the functions above are queued in |queue| instead of being written
+  // right away. flushWrites() sorts them by address, merges adjacent registers,
+  // e.g. all the registers of a sprite, and writes each run in one burst. Use it
+  // to cut down on SPI transactions when setting up a scene. The queue is
+  // flushed when it fills up. |queue| must stay valid until endWrites().
+  //
+  // Writes made with writeWord() and writeData() are not queued. Flush the
+  // queue first if they must come after the queued writes.
+  static void beginWrites(CoreWriteQueue* queue);
+  static void flushWrites();
+  static void endWrites();
+
   // TODO: the preceding functions are higher level functions than the
   // memory-level access functions that follow. The former should replace the
   // latter as Core API. The below functions should become private.
@@ -124,8 +185,59 @@ class Core {
   static void readData(uint16_t addr, void* data, uint16_t size);
   static void writeData(uint16_t addr, const void* data, uint16_t size);
 
+  // Fills |size| bytes at |addr| with the 16-bit pattern |value|, low byte
+  // first, in one SPI transaction, e.g. to clear a tilemap or the sprite table.
+  // For large regions or ranges across VRAM banks, have the coprocessor do it
+  // with Mem::fill() on XADDR_VRAM() or XADDR_TILEMAP() addresses instead.
+  static void fill(uint16_t addr, uint16_t value, uint16_t size);
+
+  // A list of writes to Core registers and memory, which the coprocessor
+  // applies all at once at the start of the next vertical blank. The list is
+  // built in shared memory during active display and submitted once, so that
+  // updates do not tear and the client does not have to wait for the vertical
+  // blank itself. See rpc_core.h for the list format.
+  //
+  // Two buffers are used in turn, so that the next list can be built while the
+  // last one is waiting to be applied. The coprocessor checks for the vertical
+  // blank when it is idle and in between the segments of long-running RPCs, so
+  // the list can still be applied late if one segment, e.g. one file system
+  // read, outlasts the vertical blank.
+  class WriteList {
+   public:
+    WriteList();
+
+    // Allocates two |size|-byte buffers in shared memory. Returns false if
+    // they could not be allocated, or if |size| is over 0x7fff.
+    bool begin(uint16_t size);
+
+    // Waits for the last list to be applied, and frees the buffers.
+    void end();
+
+    // Adds a write of |size| bytes of |data| at Core address |addr| to the
+    // list. Returns false if it does not fit.
+    bool add(uint16_t addr, const void* data, uint16_t size);
+    bool addWord(uint16_t addr, uint16_t value);
+
+    // Submits the list to be applied at the start of the next vertical blank,
+    // and starts a new empty list. Waits for the last list that was submitted
+    // to be applied first. Returns an RPC_STATUS_* code. If it is not
+    // RPC_STATUS_OK, the list is kept as it is.
+    uint16_t submit();
+
+    // Returns true if the last list that was submitted has not been applied.
+    bool isPending() const;
+    // Waits until the last list that was submitted has been applied.
+    void wait() const;
+
+   private:
+    uint16_t addr_;       // Shared memory address of both buffers.
+    uint16_t size_;       // Size of each buffer.
+    uint16_t used_;       // Size of the list being built.
+    uint8_t buffer_;      // Index of the buffer that the list is built in.
+  };
+
  private:
-  // Cached copy of tile registers.
+  // Layout of the first tile layer register, TILE_CTRL_0.
   union TileRegs {
     struct {
       // Bit fields for the first register, TILE_CTRL_1.
@@ -146,7 +258,43 @@ class Core {
     // TODO: Support TILE_CTRL_1.
     uint16_t value;
   };
+  // Copy of the TILE_CTRL_0 register of each tile layer, which is kept up to
+  // date by every write to it, so that it does not have to be read back
+  // before its fields are changed.
   static TileRegs s_tile_regs[NUM_TILE_LAYERS];
+  static TileRegs& getTileRegs(uint8_t layer_index) {
+    return s_tile_regs[layer_index];
+  }
+  static void updateTileLayerRegs(uint16_t addr, const void* data,
+                                  uint16_t size);
+
+  // Queue of combined register writes, or NULL if writes are not combined.
+  static CoreWriteQueue* s_write_queue;
+
+  // Writes |count| registers starting at |addr|, or queues the writes while
+  // writes are combined. readReg() returns a register's value, including any
+  // queued write.
+  static void writeRegs(uint16_t addr, const uint16_t* values, uint8_t count);
+  static void writeReg(uint16_t addr, uint16_t value) {
+    writeRegs(addr, &value, 1);
+  }
+  static uint16_t readReg(uint16_t addr);
+
+  // Writes block data without updating the tile layer register copy.
+  static void writeCoreData(uint16_t addr, const void* data, uint16_t size);
+
+  // VRAM bank selection. beginVRAMAccess() saves the VRAM access bit and the
+  // memory bank, and endVRAMAccess() restores them. In between,
+  // selectVRAMBank() maps the bank containing |vram_offset| to VRAM_BASE,
+  // stores the Core address of |vram_offset| in |addr|, and returns the number
+  // of bytes from there to the end of the bank.
+  static uint16_t s_saved_sys_ctrl;
+  static uint16_t s_saved_mem_bank;
+  static uint16_t s_sys_ctrl;
+  static uint16_t s_mem_bank;
+  static void beginVRAMAccess();
+  static uint16_t selectVRAMBank(uint32_t vram_offset, uint16_t* addr);
+  static void endVRAMAccess();
 
   // Cached copy of sprite registers.
   // These are not cached beyond the local scope because there are too many
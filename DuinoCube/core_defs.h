@@ -90,6 +90,8 @@
 #define NUM_SPRITES           256
 #define NUM_SPRITE_REGS        16  // Number of registers per sprite.
 #define SPRITE_XY_BASE     0x0400  // Address of block of X/Y alias registers.
+#define SPRITE_XY_SIZE          4  // Size of each sprite's X/Y alias registers.
+#define SPRITE_XY(index)   (SPRITE_XY_BASE + (index) * SPRITE_XY_SIZE)
 
 #define SPRITE_REG(index, reg)  \
             (SPRITE_BASE + (index) * NUM_SPRITE_REGS * 2 + (reg) * 2)
@@ -80,17 +80,12 @@ static void test_file_copy(const char* filename,
     return;
   }
 
-  // Compute a checksum of the file data by adding it all up.
-  uint64_t checksum = 0;
-  for (uint16_t offset = 0; offset < size; offset += sizeof(checksum)) {
-    uint64_t value;
-    DC.Mem.read(buf_addr + offset, &value, sizeof(value));
-    checksum += value;
-  }
+  // Have the coprocessor compute the CRC of the file data in shared memory.
+  uint32_t crc;
+  DC.Mem.crc(XADDR_SHMEM(buf_addr), size, &crc);
   DC.Mem.free(buf_addr);
 
-  printf("Data checksum is 0x%08lx%08lx\n",
-         (uint32_t)(checksum >> 32), (uint32_t) checksum);
+  printf("Data CRC is 0x%08lx\n", crc);
 
   // Reset file pointer.
   DC.File.seek(handle, 0);
@@ -106,21 +101,19 @@ static void test_file_copy(const char* filename,
 
   DC.File.close(handle);
 
-  // Read the data back from Core memory.
-  uint64_t core_checksum = 0;
-  for (uint16_t offset = 0; offset < size; offset += sizeof(core_checksum)) {
-    uint64_t value;
-    DC.Core.readData(addr + offset, &value, sizeof(value));
-    core_checksum += value;
-  }
   DC.Core.writeWord(REG_SYS_CTRL, 0);
   DC.Core.writeWord(REG_MEM_BANK, 0);
 
-  printf("Core checksum is 0x%08lx%08lx\n",
-         (uint32_t)(core_checksum >> 32), (uint32_t) core_checksum);
+  // Check the data in Core memory without reading it back.
+  uint32_t core_addr =
+      (addr < VRAM_BASE) ? XADDR_CORE(addr) : XADDR_BANK(bank, addr - VRAM_BASE);
+  uint32_t core_crc;
+  DC.Mem.crc(core_addr, size, &core_crc);
+
+  printf("Core CRC is 0x%08lx\n", core_crc);
 
-  if (core_checksum != checksum) {
-    printf("File and core data checksums do not match!\n");
+  if (core_crc != crc) {
+    printf("File and core data CRCs do not match!\n");
     return;
   }
 }
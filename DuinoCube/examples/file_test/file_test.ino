@@ -66,6 +66,34 @@ void loop() {
     DC.File.close(handle);
   }
 
+  // Write a new file, then read it back.
+  const char* write_filename = "bar.txt";
+  const char kWriteString[] = "Written by the DuinoCube file test.";
+  DC.Mem.write(addr, kWriteString, sizeof(kWriteString));
+  handle = DC.File.open(write_filename, FILE_WRITE | FILE_CREATE);
+  if (!handle) {
+    printf("Could not create file.\n");
+  } else {
+    uint16_t size_written = DC.File.write(handle, addr, sizeof(kWriteString));
+    DC.File.close(handle);
+    printf("Wrote 0x%x bytes to file.\n", size_written);
+
+    memset(buf, 0, sizeof(buf));
+    DC.Mem.write(addr, buf, sizeof(kWriteString));
+    handle = DC.File.open(write_filename, FILE_READ_ONLY);
+    size_read = handle ? DC.File.read(handle, addr, sizeof(buf)) : 0;
+    if (handle)
+      DC.File.close(handle);
+    DC.Mem.read(addr, buf, sizeof(kWriteString));
+    if (size_written == sizeof(kWriteString) &&
+        size_read == sizeof(kWriteString) &&
+        memcmp(buf, kWriteString, sizeof(kWriteString)) == 0) {
+      printf("Read back matches what was written.\n");
+    } else {
+      printf("Read back mismatch: read 0x%x bytes: %s\n", size_read, buf);
+    }
+  }
+
   // TODO: Test other file operations.
 
   printf("End of test.\n");
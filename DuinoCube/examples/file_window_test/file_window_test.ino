@@ -0,0 +1,125 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube system shield file window test. Writes a file that is twice the
+// size of shared memory, then reads it back at scattered offsets through a
+// small File::Window.
+
+#include <DuinoCube.h>
+#include <SPI.h>
+
+// Each 16-bit word of the test file holds its own word index.
+#define TEST_FILE_SIZE      0x10000UL
+#define WRITE_CHUNK_SIZE      256
+
+#define WINDOW_PAGE_SIZE      512
+#define WINDOW_NUM_PAGES        2
+
+// Distance between the offsets that are checked. It is not a multiple of the
+// page size, so successive reads land at different places in their pages.
+#define CHECK_STRIDE       0x0f02
+
+static const char* kFilename = "window.dat";
+
+void setup() {
+  Serial.begin(115200);
+  DC.begin();
+}
+
+// Writes the test file. Returns true if all of it was written.
+static bool write_test_file(uint16_t buf_addr) {
+  uint16_t handle = DC.File.open(kFilename, FILE_WRITE | FILE_CREATE);
+  if (!handle)
+    return false;
+
+  uint32_t total_size_written = 0;
+  uint16_t words[WRITE_CHUNK_SIZE / sizeof(uint16_t)];
+  for (uint32_t offset = 0; offset < TEST_FILE_SIZE;
+       offset += WRITE_CHUNK_SIZE) {
+    for (uint16_t i = 0; i < WRITE_CHUNK_SIZE / sizeof(uint16_t); ++i)
+      words[i] = offset / sizeof(uint16_t) + i;
+    DC.Mem.write(buf_addr, words, sizeof(words));
+    total_size_written += DC.File.write(handle, buf_addr, sizeof(words));
+  }
+  DC.File.close(handle);
+
+  return total_size_written == TEST_FILE_SIZE;
+}
+
+// Reads the word at |offset| through |window| and checks it. Returns true if
+// it matches.
+static bool check_word(DuinoCube::File::Window* window, uint32_t offset) {
+  uint16_t value = 0;
+  if (window->read(offset, &value, sizeof(value)) != sizeof(value) ||
+      value != offset / sizeof(uint16_t)) {
+    printf("Mismatch at 0x%lx: 0x%x\n", offset, value);
+    return false;
+  }
+  return true;
+}
+
+void loop() {
+  uint16_t buf_addr = DC.Mem.alloc(WINDOW_PAGE_SIZE * WINDOW_NUM_PAGES);
+  if (!buf_addr) {
+    printf("Unable to allocate window pages.\n");
+    while(1);
+  }
+
+  if (!write_test_file(buf_addr)) {
+    printf("Could not write file %s.\n", kFilename);
+    DC.Mem.free(buf_addr);
+    while(1);
+  }
+  printf("Wrote 0x%lx bytes to %s.\n", TEST_FILE_SIZE, kFilename);
+
+  uint16_t handle = DC.File.open(kFilename, FILE_READ_ONLY);
+  DuinoCube::File::Window window;
+  if (!handle || !window.begin(handle, 0, buf_addr,
+                               WINDOW_PAGE_SIZE, WINDOW_NUM_PAGES)) {
+    printf("Could not map file %s.\n", kFilename);
+  } else {
+    uint16_t num_errors = 0;
+
+    // Walk forward and then backward through the file, so that pages are
+    // evicted and read in again.
+    uint32_t offset;
+    for (offset = 0; offset < TEST_FILE_SIZE; offset += CHECK_STRIDE)
+      num_errors += !check_word(&window, offset);
+    while (offset >= CHECK_STRIDE) {
+      offset -= CHECK_STRIDE;
+      num_errors += !check_word(&window, offset);
+    }
+
+    // A read that spans two pages.
+    uint16_t words[2];
+    window.read(WINDOW_PAGE_SIZE - sizeof(uint16_t), words, sizeof(words));
+    if (words[0] != WINDOW_PAGE_SIZE / sizeof(uint16_t) - 1 ||
+        words[1] != WINDOW_PAGE_SIZE / sizeof(uint16_t)) {
+      printf("Mismatch across pages: 0x%x 0x%x\n", words[0], words[1]);
+      ++num_errors;
+    }
+
+    printf("Window reads done, %u errors.\n", num_errors);
+    window.end();
+  }
+  if (handle)
+    DC.File.close(handle);
+  DC.Mem.free(buf_addr);
+
+  printf("End of test.\n");
+  while(1);
+}
@@ -138,12 +138,33 @@ static void draw() {
   }
 }
 
+// Scroll register writes for each frame, which the coprocessor applies at the
+// start of vblank.
+static DuinoCube::Core::WriteList write_list;
+// Set if |write_list| could be allocated. Otherwise the registers are written
+// directly after polling for vblank.
+static bool use_write_list;
+
+// Writes a scroll register for the next frame.
+static void write_scroll_reg(uint16_t addr, uint16_t value) {
+  if (use_write_list)
+    write_list.addWord(addr, value);
+  else
+    DC.Core.writeWord(addr, value);
+}
+
 void setup() {
   Serial.begin(115200);
 
   DC.begin();
 
   draw();
+
+  // Room for the four scroll register writes.
+  use_write_list =
+      write_list.begin(4 * (sizeof(RPC_WriteListEntry) + sizeof(uint16_t)));
+  if (!use_write_list)
+    printf("Unable to allocate write list, polling for vblank instead.\n");
 }
 
 void loop() {
@@ -153,25 +174,30 @@ void loop() {
 
   const int step = 8;
   for (uint16_t i = 0; ; i += step) {
-    // Wait for the start of the next Vblank.  So first wait for non-Vblanking,
-    // and then wait for Vblank.
-    while (DC.Core.readWord(REG_OUTPUT_STATUS) & (1 << REG_VBLANK));
-
-    // Calculate the next scroll values during the non-Vblank area, where there
-    // is more time.
     uint16_t scroll_x = (i / 16) % 512;
     uint16_t scroll_y = (i / 8) % 512;
     uint16_t clouds_x = (i / 8);
     uint16_t clouds_y = -(i / 16);
 
-    while (!(DC.Core.readWord(REG_OUTPUT_STATUS) & (1 << REG_VBLANK))) ;
+    if (!use_write_list) {
+      // Wait for the start of the next Vblank.  So first wait for
+      // non-Vblanking, and then wait for Vblank.
+      while (DC.Core.readWord(REG_OUTPUT_STATUS) & (1 << REG_VBLANK));
+      while (!(DC.Core.readWord(REG_OUTPUT_STATUS) & (1 << REG_VBLANK)));
+    }
 
     // Scroll the camera.
-    DC.Core.writeWord(REG_SCROLL_X, scroll_x);
-    DC.Core.writeWord(REG_SCROLL_Y, scroll_y);
+    write_scroll_reg(REG_SCROLL_X, scroll_x);
+    write_scroll_reg(REG_SCROLL_Y, scroll_y);
 
     // Scroll the cloud layer independently.
-    DC.Core.writeWord(TILE_LAYER_REG(3, TILE_OFFSET_X), clouds_x);
-    DC.Core.writeWord(TILE_LAYER_REG(3, TILE_OFFSET_Y), clouds_y);
+    write_scroll_reg(TILE_LAYER_REG(3, TILE_OFFSET_X), clouds_x);
+    write_scroll_reg(TILE_LAYER_REG(3, TILE_OFFSET_Y), clouds_y);
+
+    // The writes are applied at the start of the next Vblank. This waits for
+    // the previous frame's writes to be applied, so there is one frame per
+    // Vblank.
+    if (use_write_list)
+      write_list.submit();
   }
 }
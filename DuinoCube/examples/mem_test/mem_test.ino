@@ -22,6 +22,12 @@
 
 static void test_alloc();
 static void test_access();
+static void test_arena();
+static void test_copy_fill();
+static void test_crc();
+static void test_handles();
+static void test_ring();
+static void test_shared_array();
 
 void setup() {
   Serial.begin(115200);
@@ -32,6 +38,12 @@ void setup() {
 void loop() {
   test_alloc();
   test_access();
+  test_arena();
+  test_copy_fill();
+  test_crc();
+  test_handles();
+  test_ring();
+  test_shared_array();
 
   printf("End of test.\n");
   while(1);
@@ -74,15 +86,18 @@ struct TestCommand {
 };
 
 #define BLOCK_SIZE          SHARED_MEMORY_BLOCK_SIZE
-#define MAX_ALLOC_ADDRS     8
+#define SLAB_MIN_SIZE       SHARED_MEMORY_SLAB_MIN_SIZE
+#define SLAB_MAX_SIZE       SHARED_MEMORY_SLAB_MAX_SIZE
+#define MAX_ALLOC_ADDRS    10
 
 static uint16_t alloc_addrs[MAX_ALLOC_ADDRS];
 
 static const TestCommand kTestCommands[] = {
   // Zero size allocation should change nothing.
   { COMMAND_ALLOC, 0, 0, 0, 0 },
-  // Even a small allocation should reserve a whole block.
-  { COMMAND_ALLOC, 1, 0, -BLOCK_SIZE, -BLOCK_SIZE },
+  // A small allocation takes the smallest size class from a new slab, which
+  // reserves a whole block.  The rest of the slab is still free.
+  { COMMAND_ALLOC, 1, 0, -SLAB_MIN_SIZE, -BLOCK_SIZE },
   // Allocate one unit less than the block size.  Should still allocate an
   // entire block.
   { COMMAND_ALLOC, BLOCK_SIZE - 1, 1, -BLOCK_SIZE, -BLOCK_SIZE },
@@ -107,7 +122,8 @@ static const TestCommand kTestCommands[] = {
   // the largest free size.
   { COMMAND_FREE, 0, 3, BLOCK_SIZE * 2, 0 },
   { COMMAND_FREE, 0, 1, BLOCK_SIZE, 0 },
-  { COMMAND_FREE, 0, 0, BLOCK_SIZE, 0 },
+  // Freeing the only object in a slab returns the whole block.
+  { COMMAND_FREE, 0, 0, SLAB_MIN_SIZE, 0 },
 
   // Free the region allocated in slot 4.
   // The largest size should be increased by the sizes of addresses in slots 3
@@ -127,16 +143,29 @@ static const TestCommand kTestCommands[] = {
   // Free the allocated region in slot 6.
   { COMMAND_FREE, 0, 6, (SHARED_MEMORY_HEAP_SIZE - BLOCK_SIZE * 12),
     (SHARED_MEMORY_HEAP_SIZE - BLOCK_SIZE * 12) },
+
+  // Small allocations of the same size class share a slab.
+  { COMMAND_ALLOC, SLAB_MIN_SIZE, 7, -SLAB_MIN_SIZE, -BLOCK_SIZE },
+  { COMMAND_ALLOC, SLAB_MIN_SIZE - 4, 8, -SLAB_MIN_SIZE, 0 },
+  // A different size class needs its own slab.
+  { COMMAND_ALLOC, SLAB_MAX_SIZE - 28, 9, -SLAB_MAX_SIZE, -BLOCK_SIZE },
+  { COMMAND_FREE, 0, 8, SLAB_MIN_SIZE, 0 },
+  // The first slab is now empty, so its block is freed.  It is not next to
+  // the largest free region, because the second slab is in between.
+  { COMMAND_FREE, 0, 7, SLAB_MIN_SIZE, 0 },
+  // Freeing the second slab joins both blocks with the largest free region.
+  { COMMAND_FREE, 0, 9, SLAB_MAX_SIZE, BLOCK_SIZE * 2 },
 };
 
 // Tests allocation/freeing of shared memory.
 static void test_alloc() {
   // Get initial memory stats.
-  uint16_t prev_total, prev_largest;
-  DC.Mem.stat(&prev_total, &prev_largest);
+  uint16_t prev_total, prev_largest, fragmentation;
+  DC.Mem.stat(&prev_total, &prev_largest, &fragmentation);
 
-  printf("Total free memory: %d\n", prev_total);
-  printf("Largest block of free memory: %d\n", prev_largest);
+  printf("Total free memory: %u\n", prev_total);
+  printf("Largest block of free memory: %u\n", prev_largest);
+  printf("Fragmentation: %u%%\n", fragmentation);
 
   // Clear allocated address array.
   memset(alloc_addrs, 0, sizeof(alloc_addrs));
@@ -207,3 +236,229 @@ static void test_access() {
 
   DC.Mem.free(addr);
 }
+
+// Tests allocation from a client-side arena.
+static void test_arena() {
+  const uint16_t kArenaSize = 1024;
+  uint16_t prev_total;
+  DC.Mem.stat(&prev_total, NULL);
+
+  // Only the arena itself is allocated from the heap.
+  DuinoCube::Mem::Arena arena;
+  EXPECT_EQ(arena.begin(kArenaSize), true);
+  uint16_t new_total;
+  DC.Mem.stat(&new_total, NULL);
+  EXPECT_EQ(new_total, prev_total - kArenaSize);
+  EXPECT_EQ(arena.getFreeSize(), kArenaSize);
+
+  // Allocations are contiguous.
+  uint16_t addr0 = arena.alloc(100);
+  uint16_t addr1 = arena.alloc(200);
+  EXPECT_NE(addr0, 0);
+  EXPECT_EQ(addr1, addr0 + 100);
+  EXPECT_EQ(arena.getFreeSize(), kArenaSize - 300);
+
+  // Allocate up to the end of the arena, and then release back to a marker.
+  uint16_t marker = arena.mark();
+  EXPECT_NE(arena.alloc(kArenaSize - 300), 0);
+  EXPECT_EQ(arena.alloc(1), 0);
+  arena.release(marker);
+  EXPECT_EQ(arena.getFreeSize(), kArenaSize - 300);
+  EXPECT_EQ(arena.alloc(kArenaSize - 299), 0);
+
+  // Reset frees everything.
+  arena.reset();
+  EXPECT_EQ(arena.getFreeSize(), kArenaSize);
+  EXPECT_EQ(arena.alloc(100), addr0);
+
+  // Ending the arena returns its memory to the heap.
+  arena.end();
+  DC.Mem.stat(&new_total, NULL);
+  EXPECT_EQ(new_total, prev_total);
+}
+
+static void test_copy_fill() {
+  const uint16_t kSize = 300;    // Spans several coprocessor chunks.
+  uint16_t src = DC.Mem.alloc(kSize);
+  uint16_t dst = DC.Mem.alloc(kSize);
+  EXPECT_NE(src, 0);
+  EXPECT_NE(dst, 0);
+
+  // Fill starting on the second byte of the pattern.
+  EXPECT_EQ(DC.Mem.fill(XADDR_SHMEM(src), 0x55aa, kSize), RPC_STATUS_OK);
+  EXPECT_EQ(DC.Mem.fill(XADDR_SHMEM(src + 1), 0x3412, kSize - 2),
+            RPC_STATUS_OK);
+  uint8_t buf[kSize];
+  DC.Mem.read(src, buf, kSize);
+  EXPECT_EQ(buf[0], 0xaa);
+  EXPECT_EQ(buf[1], 0x12);
+  EXPECT_EQ(buf[2], 0x34);
+  EXPECT_EQ(buf[kSize - 2], 0x34);
+  EXPECT_EQ(buf[kSize - 1], 0x55);
+
+  // Copy it across, and round trip it through the tile map bank.
+  EXPECT_EQ(DC.Mem.copy(XADDR_SHMEM(dst), XADDR_SHMEM(src), kSize),
+            RPC_STATUS_OK);
+  EXPECT_EQ(DC.Mem.copy(XADDR_TILEMAP(0), XADDR_SHMEM(dst), kSize),
+            RPC_STATUS_OK);
+  EXPECT_EQ(DC.Mem.fill(XADDR_SHMEM(dst), 0, kSize), RPC_STATUS_OK);
+  EXPECT_EQ(DC.Mem.copy(XADDR_SHMEM(dst), XADDR_TILEMAP(0), kSize),
+            RPC_STATUS_OK);
+  uint8_t copy_buf[kSize];
+  DC.Mem.read(dst, copy_buf, kSize);
+  EXPECT_EQ(memcmp(buf, copy_buf, kSize), 0);
+
+  // Flash is read-only, and forward overlapping copies are rejected.
+  EXPECT_EQ(DC.Mem.fill(XADDR_FLASH(0), 0, 1), RPC_STATUS_INVALID_ARGS);
+  EXPECT_EQ(DC.Mem.copy(XADDR_SHMEM(src + 1), XADDR_SHMEM(src), 2),
+            RPC_STATUS_INVALID_ARGS);
+  EXPECT_EQ(DC.Mem.copy(XADDR_SHMEM(SHARED_MEMORY_SIZE - 1), XADDR_SHMEM(src),
+                        2),
+            RPC_STATUS_INVALID_ARGS);
+
+  DC.Mem.free(dst);
+  DC.Mem.free(src);
+}
+
+static void test_crc() {
+  // The standard CRC-32 check value.
+  const char kCheckString[] = "123456789";
+  const uint16_t kCheckSize = sizeof(kCheckString) - 1;
+  uint16_t addr = DC.Mem.alloc(kCheckSize);
+  EXPECT_NE(addr, 0);
+  DC.Mem.write(addr, kCheckString, kCheckSize);
+
+  uint32_t crc = 0;
+  EXPECT_EQ(DC.Mem.crc(XADDR_SHMEM(addr), kCheckSize, &crc), RPC_STATUS_OK);
+  EXPECT_EQ(crc >> 16, 0xcbf4);
+  EXPECT_EQ(crc & 0xffff, 0x3926);
+
+  // The same data across a VRAM bank boundary.
+  uint32_t vram_addr = XADDR_VRAM(VRAM_BANK_SIZE - kCheckSize / 2);
+  EXPECT_EQ(DC.Mem.copy(vram_addr, XADDR_SHMEM(addr), kCheckSize),
+            RPC_STATUS_OK);
+  uint32_t vram_crc = 0;
+  EXPECT_EQ(DC.Mem.crc(vram_addr, kCheckSize, &vram_crc), RPC_STATUS_OK);
+  EXPECT_EQ(vram_crc == crc, true);
+
+  EXPECT_EQ(DC.Mem.crc(XADDR_SHMEM(SHARED_MEMORY_SIZE - 1), 2, &crc),
+            RPC_STATUS_INVALID_ARGS);
+
+  DC.Mem.free(addr);
+}
+
+static void test_handles() {
+  uint16_t prev_total;
+  DC.Mem.stat(&prev_total, NULL);
+
+  // Leave a hole below a relocatable block.
+  uint16_t hole = DC.Mem.alloc(SHARED_MEMORY_BLOCK_SIZE);
+  uint16_t handle = DC.Mem.allocHandle(SHARED_MEMORY_BLOCK_SIZE * 2);
+  EXPECT_NE(hole, 0);
+  EXPECT_NE(handle, 0);
+
+  uint16_t addr = DC.Mem.lock(handle);
+  EXPECT_NE(addr, 0);
+  const char kData[] = "relocatable";
+  DC.Mem.write(addr, kData, sizeof(kData));
+  DC.Mem.free(hole);
+
+  // A locked block is not moved.
+  DC.Mem.compact();
+  EXPECT_EQ(DC.Mem.lock(handle), addr);
+  DC.Mem.unlock(handle);
+  DC.Mem.unlock(handle);
+
+  // Once unlocked, it may be moved, but keeps its contents.
+  DC.Mem.compact();
+  uint16_t new_addr = DC.Mem.lock(handle);
+  EXPECT_NE(new_addr, 0);
+  char buf[sizeof(kData)];
+  DC.Mem.read(new_addr, buf, sizeof(buf));
+  EXPECT_EQ(memcmp(buf, kData, sizeof(kData)), 0);
+  DC.Mem.unlock(handle);
+
+  // Handles cannot be freed by address, and are invalid once freed.
+  DC.Mem.free(new_addr);
+  DC.Mem.freeHandle(handle);
+  EXPECT_EQ(DC.Mem.lock(handle), 0);
+
+  uint16_t new_total;
+  uint16_t high_water;
+  DC.Mem.stat(&new_total, NULL, NULL, &high_water);
+  EXPECT_EQ(new_total, prev_total);
+  EXPECT_NE(high_water, 0);
+}
+
+static void test_ring() {
+  const uint16_t kRingSize = 16;
+  uint16_t addr = DC.Mem.alloc(RING_BUFFER_HEADER_SIZE + kRingSize);
+  EXPECT_NE(addr, 0);
+
+  // The client is both producer and consumer here.
+  DuinoCube::Mem::Ring ring;
+  ring.begin(addr, kRingSize);
+  EXPECT_EQ(ring.getReadSize(), 0);
+  EXPECT_EQ(ring.getWriteSize(), kRingSize - 1);
+
+  // Only as much as fits is written.
+  uint8_t data[kRingSize];
+  for (uint8_t i = 0; i < sizeof(data); ++i)
+    data[i] = i;
+  EXPECT_EQ(ring.write(data, 10), 10);
+  EXPECT_EQ(ring.write(data + 10, 6), 5);
+  EXPECT_EQ(ring.getWriteSize(), 0);
+
+  uint8_t buf[kRingSize];
+  EXPECT_EQ(ring.read(buf, 8), 8);
+  EXPECT_EQ(buf[7], 7);
+
+  // Wrap around the end of the data.
+  EXPECT_EQ(ring.write(data, 8), 8);
+  DuinoCube::Mem::Ring other_ring;
+  other_ring.attach(addr);
+  EXPECT_EQ(other_ring.getReadSize(), 15);
+  EXPECT_EQ(other_ring.read(buf, sizeof(buf)), 15);
+  EXPECT_EQ(buf[6], 14);
+  EXPECT_EQ(buf[7], 0);
+  EXPECT_EQ(buf[14], 7);
+  EXPECT_EQ(ring.getReadSize(), 0);
+
+  DC.Mem.free(addr);
+}
+
+static void test_shared_array() {
+  const uint16_t kArraySize = 20;
+  uint16_t addr = DC.Mem.alloc(kArraySize * sizeof(uint16_t));
+  EXPECT_NE(addr, 0);
+
+  // The array is not a multiple of the window size, so the last window is
+  // partial.
+  DuinoCube::SharedArray<uint16_t, 8> array;
+  array.begin(addr, kArraySize);
+  for (uint16_t i = 0; i < kArraySize; ++i)
+    array[i] = i * 3;
+  array.flush();
+
+  uint16_t buf[kArraySize];
+  DC.Mem.read(addr, buf, sizeof(buf));
+  EXPECT_EQ(buf[0], 0);
+  EXPECT_EQ(buf[kArraySize - 1], (kArraySize - 1) * 3);
+
+  // Out of range elements read as zero, and writes to them are dropped.
+  EXPECT_EQ(array.get(kArraySize), 0);
+  array[kArraySize] = 0x1234;
+  array[0xffff] = 0x5678;
+  EXPECT_EQ(array.get(kArraySize), 0);
+  EXPECT_EQ(array.get(kArraySize - 1), (kArraySize - 1) * 3);
+
+  // Only the changed element is written back.
+  array[kArraySize - 2] = 0xabcd;
+  array.end();
+  DC.Mem.read(addr, buf, sizeof(buf));
+  EXPECT_EQ(buf[kArraySize - 2], 0xabcd);
+  EXPECT_EQ(buf[kArraySize - 1], (kArraySize - 1) * 3);
+  EXPECT_EQ(buf[kArraySize - 3], (kArraySize - 3) * 3);
+
+  DC.Mem.free(addr);
+}
@@ -107,20 +107,20 @@ void setupOcclusionLayer() {
                     DEFAULT_EMPTY_TILE_VALUE);
 
   // Write a 16x16 black tile at the offset location.
-  DC.Core.writeWord(REG_MEM_BANK,
-                    VRAM_BANK_BEGIN + g_vram_offset / VRAM_BANK_SIZE);
-  DC.Core.writeWord(REG_SYS_CTRL, (1 << REG_SYS_CTRL_VRAM_ACCESS));
   uint8_t occlusion_tile_data[OCCL_TILE_SIZE];
   memset(occlusion_tile_data, 0, sizeof(occlusion_tile_data));
-  DC.Core.writeData(VRAM_BASE + g_vram_offset % VRAM_BANK_SIZE,
-                    occlusion_tile_data, sizeof(occlusion_tile_data));
-  DC.Core.writeWord(REG_SYS_CTRL, 0);
+  DC.Core.writeVRAM(g_vram_offset, occlusion_tile_data,
+                    sizeof(occlusion_tile_data));
 }
 
 }  // namespace
 
 // Load image, palette, and tilemap data from file system.
 void loadResources() {
+  // The tilemap bank is only mapped while VRAM access is off. loadImageData()
+  // leaves it as it was.
+  DC.Core.writeWord(REG_SYS_CTRL, (0 << REG_SYS_CTRL_VRAM_ACCESS));
+
   uint16_t vram_offset = 0;
   for (int i = 0; i < sizeof(kFiles) / sizeof(kFiles[0]); ++i) {
     const File& file = kFiles[i];
@@ -144,37 +144,19 @@ void loadResources() {
       continue;
     }
 
-    // Compute write destination.
-    uint16_t dest_addr;
-    uint16_t dest_bank;
-
     if (file.vram_offset) {
-      // Set up for VRAM write.
-
-      // If this doesn't fit in the remaining part of the current bank, use the
-      // next VRAM bank.
-      if (vram_offset % VRAM_BANK_SIZE + file_size > VRAM_BANK_SIZE)
-        vram_offset += VRAM_BANK_SIZE - (vram_offset % VRAM_BANK_SIZE);
-
-      // Record VRAM offset.
+      // VRAM data is packed back to back. loadImageData() takes care of
+      // selecting banks, including when the data crosses into the next one.
+      DC.File.close(handle);
+      printf("Writing to VRAM offset 0x%x\n", vram_offset);
       *file.vram_offset = vram_offset;
-
-      // Determine the destination VRAM address and bank.
-      dest_addr = VRAM_BASE + vram_offset % VRAM_BANK_SIZE;
-      dest_bank = vram_offset / VRAM_BANK_SIZE + VRAM_BANK_BEGIN;
-      DC.Core.writeWord(REG_SYS_CTRL, (1 << REG_SYS_CTRL_VRAM_ACCESS));
-
-      // Update the VRAM offset.
-      vram_offset += file_size;
-    } else {
-      // Set up for non-VRAM write.
-      dest_addr = file.addr;
-      dest_bank = file.bank;
+      vram_offset += DC.Core.loadImageData(filename, vram_offset);
+      continue;
     }
 
-    printf("Writing to 0x%x with bank = %d\n", dest_addr, dest_bank);
-    DC.Core.writeWord(REG_MEM_BANK, dest_bank);
-    DC.File.readToCore(handle, dest_addr, file_size);
+    printf("Writing to 0x%x with bank = %d\n", file.addr, file.bank);
+    DC.Core.writeWord(REG_MEM_BANK, file.bank);
+    DC.File.readToCore(handle, file.addr, file_size);
 
     DC.File.close(handle);
   }
@@ -183,9 +165,6 @@ void loadResources() {
 
   // Set to bank 0.
   DC.Core.writeWord(REG_MEM_BANK, 0);
-
-  // Allow the graphics pipeline access to VRAM.
-  DC.Core.writeWord(REG_SYS_CTRL, (0 << REG_SYS_CTRL_VRAM_ACCESS));
 }
 
 void setupLayers() {
@@ -0,0 +1,85 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube RPC latency test.  Measures how long the RPC server takes to
+// acknowledge and to complete a trivial command.  Run it with and without a
+// USB gamepad attached to see how much USB polling affects the latency.
+
+#include <DuinoCube.h>
+#include <SPI.h>
+
+#define NUM_ITERATIONS      1000
+
+// Keeps track of the min, max and average of a series of measurements.
+struct LatencyStats {
+  uint32_t min;
+  uint32_t max;
+  uint32_t total;
+};
+
+static void reset_stats(LatencyStats* stats) {
+  stats->min = ~0UL;
+  stats->max = 0;
+  stats->total = 0;
+}
+
+static void add_sample(LatencyStats* stats, uint32_t sample) {
+  if (sample < stats->min)
+    stats->min = sample;
+  if (sample > stats->max)
+    stats->max = sample;
+  stats->total += sample;
+}
+
+static void print_stats(const char* name, const LatencyStats& stats) {
+  printf("%s: min = %lu us, avg = %lu us, max = %lu us\n", name,
+         stats.min, stats.total / NUM_ITERATIONS, stats.max);
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  DC.begin();
+}
+
+void loop() {
+  LatencyStats ack_stats;     // Time for submit() to be acknowledged.
+  LatencyStats exec_stats;    // Time for the entire exec().
+  reset_stats(&ack_stats);
+  reset_stats(&exec_stats);
+
+  RPC_ReadCoreIDArgs args;
+  for (uint16_t i = 0; i < NUM_ITERATIONS; ++i) {
+    uint32_t t0 = micros();
+    uint16_t ticket = DC.RPC.submit(RPC_CMD_READ_CORE_ID, NULL, 0);
+    uint32_t t1 = micros();
+    DC.RPC.wait(ticket, &args.out, sizeof(args.out));
+    uint32_t t2 = micros();
+
+    add_sample(&ack_stats, t1 - t0);
+    add_sample(&exec_stats, t2 - t0);
+  }
+
+  printf("Core ID: 0x%04x\n", args.out.id);
+  print_stats("Acknowledge", ack_stats);
+  print_stats("Execute", exec_stats);
+
+  // Compare with the time spent on the server side.
+  DC.RPC.printStats(true);
+
+  delay(1000);
+}
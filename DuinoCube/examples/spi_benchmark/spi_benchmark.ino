@@ -0,0 +1,172 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube SPI throughput benchmark.  Measures the bytes/s of block reads and
+// writes to shared memory and to the Core from the Arduino, and of copies done
+// by the coprocessor, for 16, 256 and 4096-byte blocks. Also measures setting
+// up the sprites and tile layers of a scene with and without write combining.
+//
+// The Arduino does not have enough RAM for a 4096-byte buffer, so on the
+// Arduino side, larger blocks are sent as back-to-back BUFFER_SIZE transfers.
+// The coprocessor copies each block with a single RPC.
+//
+// This overwrites the start of VRAM.
+
+#include <DuinoCube.h>
+#include <SPI.h>
+
+#define BUFFER_SIZE       256
+#define MAX_BLOCK_SIZE   4096
+
+// Number of bytes moved for each measurement.
+#define BYTES_PER_TEST  16384
+
+// Number of sprites set up by the scene test.
+#define NUM_SCENE_SPRITES   16
+
+static const uint16_t kBlockSizes[] = { 16, 256, MAX_BLOCK_SIZE };
+
+static uint8_t buffer[BUFFER_SIZE];
+
+// Shared memory blocks to access.
+static uint16_t src_addr;
+static uint16_t dst_addr;
+
+// Reads or writes one block of |size| bytes.
+typedef void (*BlockFunc)(uint16_t size);
+
+static void write_shared_memory(uint16_t size) {
+  for (uint16_t offset = 0; offset < size; offset += BUFFER_SIZE) {
+    DC.Mem.write(dst_addr + offset, buffer, min(size - offset, BUFFER_SIZE));
+  }
+}
+
+static void read_shared_memory(uint16_t size) {
+  for (uint16_t offset = 0; offset < size; offset += BUFFER_SIZE) {
+    DC.Mem.read(src_addr + offset, buffer, min(size - offset, BUFFER_SIZE));
+  }
+}
+
+static void write_vram(uint16_t size) {
+  for (uint16_t offset = 0; offset < size; offset += BUFFER_SIZE) {
+    DC.Core.writeData(VRAM_BASE + offset, buffer,
+                      min(size - offset, BUFFER_SIZE));
+  }
+}
+
+static void read_vram(uint16_t size) {
+  for (uint16_t offset = 0; offset < size; offset += BUFFER_SIZE) {
+    DC.Core.readData(VRAM_BASE + offset, buffer,
+                     min(size - offset, BUFFER_SIZE));
+  }
+}
+
+static void copy_shared_memory(uint16_t size) {
+  DC.Mem.copy(XADDR_SHMEM(dst_addr), XADDR_SHMEM(src_addr), size);
+}
+
+static void copy_to_vram(uint16_t size) {
+  DC.Mem.copy(XADDR_VRAM(0), XADDR_SHMEM(src_addr), size);
+}
+
+// Sets up the registers of a scene through the high-level Core functions.
+static void set_up_scene() {
+  for (uint8_t i = 0; i < NUM_SCENE_SPRITES; ++i) {
+    DC.Core.setSpriteProperty(i, SPRITE_PROP_WIDTH, SPRITE_SIZE_16);
+    DC.Core.setSpriteProperty(i, SPRITE_PROP_HEIGHT, SPRITE_SIZE_16);
+    DC.Core.setSpriteProperty(i, SPRITE_PROP_PALETTE, 1);
+    DC.Core.setSpriteProperty(i, SPRITE_PROP_DATA_OFFSET, i * 0x100);
+    DC.Core.moveSprite(i, i * 16, i * 8);
+    DC.Core.enableSprite(i);
+  }
+  for (uint8_t i = 0; i < NUM_TILE_LAYERS; ++i) {
+    DC.Core.setTileLayerProperty(i, TILE_PROP_FLAGS, TILE_FLAGS_ENABLE_TRANSP);
+    DC.Core.setTileLayerProperty(i, TILE_PROP_PALETTE, i);
+    DC.Core.setTileLayerProperty(i, TILE_PROP_TRANSP_VALUE, 0xff);
+    DC.Core.moveTileLayer(i, 0, 0);
+    DC.Core.enableTileLayer(i);
+  }
+}
+
+static void run_scene_test() {
+  uint32_t t0 = micros();
+  set_up_scene();
+  uint32_t t1 = micros();
+  DuinoCube::CoreWriteQueue queue;
+  DC.Core.beginWrites(&queue);
+  set_up_scene();
+  DC.Core.endWrites();
+  uint32_t t2 = micros();
+
+  printf("%-20s %lu us, combined: %lu us\n", "Scene setup", t1 - t0, t2 - t1);
+
+  for (uint8_t i = 0; i < NUM_SCENE_SPRITES; ++i)
+    DC.Core.disableSprite(i);
+  for (uint8_t i = 0; i < NUM_TILE_LAYERS; ++i)
+    DC.Core.disableTileLayer(i);
+}
+
+static void run_test(const char* name, BlockFunc func) {
+  for (uint8_t i = 0; i < ARRAY_SIZE(kBlockSizes); ++i) {
+    uint16_t size = kBlockSizes[i];
+    uint16_t num_blocks = BYTES_PER_TEST / size;
+
+    uint32_t t0 = micros();
+    for (uint16_t j = 0; j < num_blocks; ++j)
+      func(size);
+    uint32_t time = micros() - t0;
+
+    printf("%-20s %4u bytes: %7lu bytes/s\n", name, size,
+           (uint32_t)((float)BYTES_PER_TEST * 1000000 / time));
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  DC.begin();
+
+  src_addr = DC.Mem.alloc(MAX_BLOCK_SIZE);
+  dst_addr = DC.Mem.alloc(MAX_BLOCK_SIZE);
+  if (!src_addr || !dst_addr) {
+    printf("Unable to allocate shared memory.\n");
+    while(1);
+  }
+
+  for (uint16_t i = 0; i < BUFFER_SIZE; ++i)
+    buffer[i] = i;
+}
+
+void loop() {
+  run_test("Shared memory write", write_shared_memory);
+  run_test("Shared memory read", read_shared_memory);
+
+  // Map the first VRAM bank.
+  DC.Core.writeWord(REG_MEM_BANK, VRAM_BANK_BEGIN);
+  DC.Core.writeWord(REG_SYS_CTRL, (1 << REG_SYS_CTRL_VRAM_ACCESS));
+  run_test("VRAM write", write_vram);
+  run_test("VRAM read", read_vram);
+  DC.Core.writeWord(REG_SYS_CTRL, (0 << REG_SYS_CTRL_VRAM_ACCESS));
+  DC.Core.writeWord(REG_MEM_BANK, 0);
+
+  run_test("Coprocessor copy", copy_shared_memory);
+  run_test("Coprocessor to VRAM", copy_to_vram);
+  run_scene_test();
+  printf("\n");
+
+  delay(1000);
+}
@@ -77,10 +77,8 @@ static uint16_t* sprites_offsets[] = { &sprites16_offset, &sprites32_offset };
 
 #define NUM_SPRITES_DRAWN          256
 
-// Contains the location of a sprite.
-struct SpriteLocation {
-  int16_t x, y;                // Location.
-};
+// Contains the location of a sprite, laid out like the X/Y alias registers.
+typedef DuinoCube::SpriteXY SpriteLocation;
 static SpriteLocation sprite_locations[NUM_SPRITES_DRAWN];
 
 // Contains data used to keep track of a sprite's movement.
@@ -95,8 +93,10 @@ struct SpriteMovement {
                                // When the step counter reaches |FRAME_RATE|,
                                // the location is updated by one.
 };
-// Address in shared memory for storing sprite movement data.
-static uint16_t sprite_movement_addr;
+// Sprite movement data in shared memory. Movement structs are cached several at
+// a time, to reduce the time spent sending control bytes vs data bytes.
+#define NUM_MOVEMENTS_CACHED    64
+static DuinoCube::SharedArray<SpriteMovement, NUM_MOVEMENTS_CACHED> movements;
 
 // Copy graphics data from file system to Core.
 static void load_data() {
@@ -121,35 +121,25 @@ static void load_data() {
     DC.File.close(handle);
   }
 
-  // Load images.
+  // Load images back to back in VRAM. loadImageData() selects the VRAM banks,
+  // so an image may cross into the next bank.
   printf("Loading images.\n");
-  uint16_t addr = VRAM_BASE;
+  uint32_t vram_offset = 0;
   for (int i = 0; i < sizeof(image_files) / sizeof(image_files[0]); ++i) {
     const char* filename = image_files[i];
-    uint16_t handle = DC.File.open(filename, FILE_READ_ONLY);
-    if (!handle) {
-      printf("Could not open file %s.\n", filename);
+    uint32_t size = DC.Core.loadImageData(filename, vram_offset);
+    if (size == 0) {
+      printf("Could not load file %s.\n", filename);
       continue;
     }
-    uint16_t file_size = DC.File.size(handle);
-    DC.Core.writeWord(REG_MEM_BANK, VRAM_BANK_BEGIN);
-    DC.Core.writeWord(REG_SYS_CTRL, 1);
 #if defined(DEBUG) && defined(LOG_LOADING)
-    printf("File %s is 0x%x bytes\n", filename, file_size);
-    printf("Wrote 0x%x bytes to 0x%x\n",
-           DC.File.readToCore(handle, addr, file_size), addr);
+    printf("Wrote 0x%lx bytes to VRAM offset 0x%lx\n", size, vram_offset);
 #endif
-    DC.Core.writeWord(REG_MEM_BANK, 0);
-    DC.Core.writeWord(REG_SYS_CTRL, 0);
 
-    // Store the offset of the image that was loaded, and update the address to
+    // Store the offset of the image that was loaded, and update the offset to
     // point to where the next image will be loaded.
-    // TODO: Make sure this does not overrun the VRAM bank.
-    // .e. if |addr| >= |VRAM_BASE + BANK_SIZE|.
-    *sprites_offsets[i] = addr - VRAM_BASE;
-    addr += file_size;
-
-    DC.File.close(handle);
+    *sprites_offsets[i] = vram_offset;
+    vram_offset += size;
   }
 }
 
@@ -168,23 +158,23 @@ static void setup_sprites() {
   DC.Core.writeWord(REG_SCROLL_Y, 0);
 
   // Allocate movement data.
-  sprite_movement_addr =
+  uint16_t sprite_movement_addr =
       DC.Mem.alloc(sizeof(SpriteMovement) * NUM_SPRITES_DRAWN);
   if (!sprite_movement_addr) {
     printf("Unable to allocate %u bytes for sprite movement data.\n",
            sizeof(SpriteMovement) * NUM_SPRITES_DRAWN);
     return;
   }
+  movements.begin(sprite_movement_addr, NUM_SPRITES_DRAWN);
 
-  uint16_t addr = sprite_movement_addr;
-  for (int i = 0; i < NUM_SPRITES_DRAWN; ++i, addr += sizeof(SpriteMovement)) {
+  for (int i = 0; i < NUM_SPRITES_DRAWN; ++i) {
     // Randomly generate some sprites.
     SpriteLocation& sprite = sprite_locations[i];
     sprite.x = rand() % WORLD_SIZE;
     sprite.y = rand() % WORLD_SIZE;
 
     // Select speed and direction for each sprite.
-    SpriteMovement movement;
+    SpriteMovement& movement = movements[i];
     movement.dx = rand() % (MAX_SPEED - MIN_SPEED) + MIN_SPEED;
     movement.dy = rand() % (MAX_SPEED - MIN_SPEED) + MIN_SPEED;
     if (rand() % 2)
@@ -193,10 +183,8 @@ static void setup_sprites() {
       movement.dy *= -1;
     movement.step_x = 0;
     movement.step_y = 0;
-
-    // Store movement data in shared memory.
-    DC.Mem.write(addr, &movement, sizeof(movement));
   }
+  movements.flush();
 
   for (int i = 0; i < NUM_SPRITES_DRAWN; ++i) {
     uint16_t sprite_ctrl0_value = (1 << SPRITE_ENABLED) |
@@ -238,11 +226,6 @@ static void setup_sprites() {
   }
 }
 
-// Read multiple sprite movement structs at a time, to reduce the time spent
-// sending control bytes vs data bytes.
-#define NUM_MOVEMENTS_TO_READ    64
-SpriteMovement movements[NUM_MOVEMENTS_TO_READ];
-
 extern uint8_t __bss_end;   // End of statically allocated memory.
 extern uint8_t __stack;     // Where local variables are allocated.
 
@@ -276,12 +259,10 @@ void loop() {
   // Update the sprite location values for the next frame.  Compute this
   // during the non-blanking period.  Note that the actual sprites are NOT
   // being updated here, as they are being drawn to the screen.
-  uint16_t addr = sprite_movement_addr;
-  for (int i = 0; i < NUM_SPRITES_DRAWN; ++i, addr += sizeof(SpriteMovement)) {
-    // Load movement data from shared memory.
-    if (i % NUM_MOVEMENTS_TO_READ == 0)
-      DC.Mem.read(addr, movements, sizeof(movements));
-    SpriteMovement& movement = movements[i % NUM_MOVEMENTS_TO_READ];
+  for (int i = 0; i < NUM_SPRITES_DRAWN; ++i) {
+    // Movement data is loaded from and written back to shared memory a window
+    // at a time.
+    SpriteMovement& movement = movements[i];
 
     // Update the location and movement counter.
     SpriteLocation& location = sprite_locations[i];
@@ -296,9 +277,6 @@ void loop() {
       location.y += sign(movement.dy);
     }
 
-    // Write the updated movement data back to shared memory.
-    DC.Mem.write(addr, &movement, sizeof(movement));
-
     // Adjust the sprites if they move off screen -- shift them to the other
     // side so they re-enter the visible area quickly.  This way they spend
     // less time in the off-screen area, so the on-sprite density is higher.
@@ -312,6 +290,7 @@ void loop() {
     else if (location.y < -MAX_SPRITE_SIZE && movement.dy < 0)
       location.y += (SCREEN_HEIGHT + MAX_SPRITE_SIZE);
   }
+  movements.flush();
 
 #ifdef TEST_COLLISION
   // Read the collision status registers.
@@ -379,7 +358,7 @@ void loop() {
 
   // Write the new sprite location values to sprite registers.
 #ifdef FAST_SPRITE_LOCATIONS
-  DC.Core.writeData(SPRITE_XY_BASE, sprite_locations, sizeof(sprite_locations));
+  DC.Core.moveSprites(0, NUM_SPRITES_DRAWN, sprite_locations);
 #else
   for (int i = 0; i < NUM_SPRITES_DRAWN; ++i) {
     SpriteLocation& location = sprite_locations[i];
@@ -0,0 +1,92 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube coprocessor script VM test.  Runs a script once, then runs another
+// script at every vertical blank for a second.
+
+#include <DuinoCube.h>
+#include <SPI.h>
+
+// Adds the numbers from 1 to 10 and stores the sum at r1.
+static const uint8_t kSumScript[] = {
+  VM_INSTR(VM_OP_MOV,  2, 0, 10),   // r2 = 10
+  VM_INSTR(VM_OP_ADD,  3, 2, 0),    // r3 += r2
+  VM_INSTR(VM_OP_DJNZ, 2, 0, 4),    // Repeat until --r2 == 0.
+  VM_INSTR(VM_OP_ST,   3, 1, 0),    // Store r3 at r1.
+  VM_INSTR(VM_OP_END,  0, 0, 0),
+};
+
+// Increments the counter at r1.
+static const uint8_t kCountScript[] = {
+  VM_INSTR(VM_OP_LD,   2, 1, 0),
+  VM_INSTR(VM_OP_ADD,  2, 0, 1),
+  VM_INSTR(VM_OP_ST,   2, 1, 0),
+  VM_INSTR(VM_OP_END,  0, 0, 0),
+};
+
+// Names a register that does not exist, so it stops with VM_ERROR_INVALID_OP at
+// the second instruction.
+static const uint8_t kBadRegScript[] = {
+  VM_INSTR(VM_OP_MOV,  2, 0, 1),
+  VM_INSTR(VM_OP_MOV,  VM_NUM_REGS, 0, 1),
+  VM_INSTR(VM_OP_END,  0, 0, 0),
+};
+
+void setup() {
+  Serial.begin(115200);
+
+  DC.begin();
+}
+
+void loop() {
+  uint16_t script_addr = DC.Mem.alloc(SHARED_MEMORY_BLOCK_SIZE);
+  uint16_t data_addr = STRING_BUF_ADDR;
+  uint16_t value = 0;
+  uint16_t error;
+  uint16_t pc;
+
+  DC.Mem.write(script_addr, kSumScript, sizeof(kSumScript));
+  uint16_t status =
+      DC.VM.run(script_addr, sizeof(kSumScript), data_addr, &error, &pc);
+  DC.Mem.read(data_addr, &value, sizeof(value));
+  printf("Sum script: status %u, error %u, pc 0x%x, sum = %u (expected 55)\n",
+         status, error, pc, value);
+
+  DC.Mem.write(script_addr, kBadRegScript, sizeof(kBadRegScript));
+  status =
+      DC.VM.run(script_addr, sizeof(kBadRegScript), data_addr, &error, &pc);
+  printf("Bad register script: status %u, error %u (expected %u), "
+         "pc 0x%x (expected 0x%x)\n",
+         status, error, VM_ERROR_INVALID_OP, pc, VM_INSTR_SIZE);
+
+  value = 0;
+  DC.Mem.write(data_addr, &value, sizeof(value));
+  DC.Mem.write(script_addr, kCountScript, sizeof(kCountScript));
+  DC.VM.start(script_addr, sizeof(kCountScript), data_addr, VM_MODE_VBLANK);
+  delay(1000);
+  DC.VM.stop();
+
+  uint16_t num_runs;
+  DC.VM.getStatus(&num_runs, &error, &pc);
+  DC.Mem.read(data_addr, &value, sizeof(value));
+  printf("Count script: %u runs, error %u, count = %u (expected about 60)\n",
+         num_runs, error, value);
+
+  DC.Mem.free(script_addr);
+
+  while(1);
+}
@@ -25,6 +25,7 @@
 #include "core.h"
 #include "rpc.h"
 #include "rpc_file.h"
+#include "rpc_stubs.h"
 
 namespace DuinoCube {
 
@@ -52,7 +53,9 @@ void File::close(uint16_t handle) {
   RPC_FileCloseArgs args;
   args.in.handle = handle;
 
-  rpc.exec(RPC_CMD_FILE_CLOSE, &args.in, sizeof(args.in), NULL, 0);
+  // There are no outputs, so don't wait for it to complete. The client can go
+  // on to prepare the next command, e.g. opening the next file.
+  rpc.submit(RPC_CMD_FILE_CLOSE, &args.in, sizeof(args.in));
 }
 
 uint16_t File::read(uint16_t handle, uint16_t dst_addr, uint16_t size) {
@@ -108,4 +111,78 @@ void File::seek(uint16_t handle, uint32_t offset) {
   rpc.exec(RPC_CMD_FILE_SEEK, &args.in, sizeof(args.in), NULL, 0);
 }
 
+uint16_t File::snapshot(const char* filename) {
+  // Copy the name string to shared memory (including null terminator).
+  mem.write(STRING_BUF_ADDR, filename, strlen(filename) + 1);
+
+  return RPCStubs::snapshot(STRING_BUF_ADDR);
+}
+
+// Value of |last_page_| when no page has been touched.
+#define NO_PAGE       0xffff
+
+File::Window::Window() : window_(0), page_size_(0), last_page_(NO_PAGE),
+                         last_page_addr_(0) {}
+
+bool File::Window::begin(uint16_t handle, uint32_t offset, uint16_t buf_addr,
+                         uint16_t page_size, uint8_t num_pages) {
+  end();
+  uint16_t status = RPCStubs::fileWindowMap(handle, offset, buf_addr,
+                                            page_size, num_pages, &window_);
+  if (status != RPC_STATUS_OK) {
+    window_ = 0;
+    return false;
+  }
+  page_size_ = page_size;
+  return true;
+}
+
+void File::Window::end() {
+  if (window_)
+    RPCStubs::fileWindowUnmap(window_);
+  window_ = 0;
+  last_page_ = NO_PAGE;
+}
+
+uint16_t File::Window::getAddr(uint32_t offset) {
+  if (!window_)
+    return (uint16_t) NULL;
+
+  // Pages are numbered with 16 bits, and NO_PAGE is not a page, so offsets
+  // beyond the last one cannot be mapped. Check before truncating, so that
+  // they do not alias lower pages.
+  uint32_t page_index = offset / page_size_;
+  if (page_index >= NO_PAGE)
+    return (uint16_t) NULL;
+
+  // The last page that was touched is the most recently used one, so it is
+  // never evicted by the coprocessor before another page is touched.
+  uint16_t page = page_index;
+  if (page != last_page_) {
+    uint16_t addr;
+    if (RPCStubs::fileWindowTouch(window_, page, &addr) != RPC_STATUS_OK)
+      return (uint16_t) NULL;
+    last_page_ = page;
+    last_page_addr_ = addr;
+  }
+  return last_page_addr_ + offset % page_size_;
+}
+
+uint16_t File::Window::read(uint32_t offset, void* data, uint16_t size) {
+  char* buf = static_cast<char*>(data);
+  uint16_t total_size_read = 0;
+  while (total_size_read < size) {
+    uint16_t addr = getAddr(offset);
+    if (!addr)
+      break;
+    uint16_t size_to_read = page_size_ - offset % page_size_;
+    if (size_to_read > size - total_size_read)
+      size_to_read = size - total_size_read;
+    mem.read(addr, buf + total_size_read, size_to_read);
+    offset += size_to_read;
+    total_size_read += size_to_read;
+  }
+  return total_size_read;
+}
+
 }  // namespace DuinoCube
@@ -25,6 +25,12 @@
 // Taken from FatFS.
 // TODO: Add more defines.
 #define FILE_READ_ONLY    0x01
+#define FILE_WRITE        0x02
+#define FILE_CREATE       0x08    // Creates the file, or truncates it.
+
+// Max number of file windows that can be mapped at once, and of pages in each.
+#define FILE_NUM_WINDOWS          2
+#define FILE_WINDOW_MAX_PAGES     8
 
 namespace DuinoCube {
 
@@ -42,6 +48,49 @@ class File {
   // Move the file access pointer to |offset| bytes from the start.  It can also
   // increase the file size.
   static void seek(uint16_t handle, uint32_t offset);
+
+  // Saves the Core's memory and registers and all of shared memory to a new
+  // file, for debugging on a host. The coprocessor streams the data straight
+  // to the SD card. See snapshot.h for the file format. Returns an
+  // RPC_STATUS_* code.
+  static uint16_t snapshot(const char* filename);
+
+  // Maps a range of a file to a fixed-size region of shared memory, which is
+  // split into pages. The coprocessor reads a page from the file when it is
+  // touched and is not in memory, in place of the least recently used page.
+  // This allows data that is bigger than shared memory, such as large maps, to
+  // be read as if it were in shared memory. The pages are read-only, and the
+  // file must not be read in other ways while it is mapped.
+  class Window {
+   public:
+    Window();
+
+    // Maps the file range starting at |offset| of open file |handle| to
+    // |num_pages| pages of |page_size| bytes at shared memory |buf_addr|.
+    // Returns false if there are no free windows or the args are invalid.
+    bool begin(uint16_t handle, uint32_t offset, uint16_t buf_addr,
+               uint16_t page_size, uint8_t num_pages);
+    void end();
+
+    // Returns the shared memory address of byte |offset| of the mapped range,
+    // reading in its page if needed, or NULL on failure. The rest of the page
+    // follows it, and stays there until another page is read in. Offsets in
+    // page 0xffff or beyond cannot be mapped.
+    uint16_t getAddr(uint32_t offset);
+
+    // Reads |size| bytes at |offset| of the mapped range, across pages if
+    // needed. Returns the number of bytes read.
+    uint16_t read(uint32_t offset, void* data, uint16_t size);
+
+   private:
+    uint16_t window_;           // Handle of the mapping, or 0 if none.
+    uint16_t page_size_;
+
+    // The last page that was touched. It is always kept in memory, so it can
+    // be accessed without an RPC.
+    uint16_t last_page_;
+    uint16_t last_page_addr_;
+  };
 };
 
 }  // namespace DuinoCube
@@ -26,6 +26,8 @@
 #include "pins.h"
 #include "rpc.h"
 #include "rpc_mem.h"
+#include "rpc_stubs.h"
+#include "spi_burst.h"
 
 namespace DuinoCube {
 
@@ -49,13 +51,9 @@ void Mem::read(uint16_t addr, void* data, uint16_t size) {
   SET_PIN(RAM_SELECT_PIN, LOW);
 
   // The SPI RAM uses MSB first mode.
-  SPI.transfer(RAM_READ);
-  SPI.transfer(highByte(addr));
-  SPI.transfer(lowByte(addr));
-
-  char* buf = (char*)data;
-  for (uint16_t i = 0; i < size; ++i)
-    buf[i] = SPI.transfer(0);
+  uint8_t header[] = { RAM_READ, highByte(addr), lowByte(addr) };
+  spiBurstWrite(header, sizeof(header));
+  spiBurstRead(data, size);
 
   SET_PIN(RAM_SELECT_PIN, HIGH);
 }
@@ -64,26 +62,27 @@ void Mem::write(uint16_t addr, const void* data, uint16_t size) {
   SET_PIN(RAM_SELECT_PIN, LOW);
 
   // The SPI RAM uses MSB first mode.
-  SPI.transfer(RAM_WRITE);
-  SPI.transfer(highByte(addr));
-  SPI.transfer(lowByte(addr));
-
-  const char* buf = (const char*)data;
-  for (uint16_t i = 0; i < size; ++i)
-    SPI.transfer(buf[i]);
+  uint8_t header[] = { RAM_WRITE, highByte(addr), lowByte(addr) };
+  spiBurstWrite(header, sizeof(header));
+  spiBurstWrite(data, size);
 
   SET_PIN(RAM_SELECT_PIN, HIGH);
 }
 
-void Mem::stat(uint16_t* total_free_size, uint16_t* largest_free_size) {
+void Mem::stat(uint16_t* total_free_size, uint16_t* largest_free_size,
+               uint16_t* fragmentation, uint16_t* high_water_size) {
   RPC_MemStatArgs args;
 
-  rpc.exec(RPC_CMD_MEM_STAT, NULL, 0, &args.out, sizeof(args.out));
+  rpc.execPriority(RPC_CMD_MEM_STAT, NULL, 0, &args.out, sizeof(args.out));
 
   if (total_free_size)
     *total_free_size = args.out.total_free_size;
   if (largest_free_size)
     *largest_free_size = args.out.largest_free_size;
+  if (fragmentation)
+    *fragmentation = args.out.fragmentation;
+  if (high_water_size)
+    *high_water_size = args.out.high_water_size;
 }
 
 uint16_t Mem::alloc(uint16_t size) {
@@ -104,4 +103,198 @@ void Mem::free(uint16_t addr) {
   rpc.exec(RPC_CMD_MEM_FREE, &args.in, sizeof(args.in), NULL, 0);
 }
 
+uint16_t Mem::allocHandle(uint16_t size) {
+  RPC_MemAllocHandleArgs args;
+  args.in.size = size;
+
+  rpc.exec(RPC_CMD_MEM_ALLOC_HANDLE,
+           &args.in, sizeof(args.in),
+           &args.out, sizeof(args.out));
+
+  return args.out.handle;
+}
+
+void Mem::freeHandle(uint16_t handle) {
+  RPC_MemFreeHandleArgs args;
+  args.in.handle = handle;
+
+  rpc.exec(RPC_CMD_MEM_FREE_HANDLE, &args.in, sizeof(args.in), NULL, 0);
+}
+
+uint16_t Mem::lock(uint16_t handle) {
+  RPC_MemLockArgs args;
+  args.in.handle = handle;
+
+  uint16_t status = rpc.execPriority(RPC_CMD_MEM_LOCK,
+                                     &args.in, sizeof(args.in),
+                                     &args.out, sizeof(args.out));
+
+  return (status == RPC_STATUS_OK) ? args.out.addr : (uint16_t) NULL;
+}
+
+void Mem::unlock(uint16_t handle) {
+  RPC_MemUnlockArgs args;
+  args.in.handle = handle;
+
+  rpc.execPriority(RPC_CMD_MEM_UNLOCK, &args.in, sizeof(args.in), NULL, 0);
+}
+
+uint16_t Mem::compact() {
+  RPC_MemCompactArgs args;
+
+  rpc.exec(RPC_CMD_MEM_COMPACT, NULL, 0, &args.out, sizeof(args.out));
+
+  return args.out.largest_free_size;
+}
+
+uint16_t Mem::copy(uint32_t dst_addr, uint32_t src_addr, uint32_t size) {
+  return RPCStubs::copy(dst_addr, src_addr, size);
+}
+
+uint16_t Mem::fill(uint32_t dst_addr, uint16_t value, uint32_t size) {
+  return RPCStubs::fill(dst_addr, size, value);
+}
+
+uint16_t Mem::crc(uint32_t addr, uint32_t size, uint32_t* result) {
+  return RPCStubs::crc(addr, size, result);
+}
+
+Mem::Arena::Arena() : addr_(0), size_(0), used_(0) {}
+
+bool Mem::Arena::begin(uint16_t size) {
+  end();
+  addr_ = Mem::alloc(size);
+  if (!addr_)
+    return false;
+  size_ = size;
+  return true;
+}
+
+void Mem::Arena::end() {
+  if (addr_)
+    Mem::free(addr_);
+  addr_ = 0;
+  size_ = 0;
+  used_ = 0;
+}
+
+uint16_t Mem::Arena::alloc(uint16_t size) {
+  if (size == 0 || size > size_ - used_)
+    return (uint16_t) NULL;
+  uint16_t addr = addr_ + used_;
+  used_ += size;
+  return addr;
+}
+
+void Mem::Arena::reset() {
+  used_ = 0;
+}
+
+void Mem::Arena::release(uint16_t marker) {
+  if (marker < used_)
+    used_ = marker;
+}
+
+// Returns the number of bytes in a ring buffer of |size| bytes.
+static uint16_t get_ring_read_size(uint16_t head, uint16_t tail,
+                                   uint16_t size) {
+  return (head >= tail) ? (head - tail) : (size - tail + head);
+}
+
+// Returns the number of bytes that can be added to a ring buffer. One byte is
+// always left unused, so that a full buffer is not mistaken for an empty one.
+static uint16_t get_ring_write_size(uint16_t head, uint16_t tail,
+                                    uint16_t size) {
+  return size - 1 - get_ring_read_size(head, tail, size);
+}
+
+Mem::Ring::Ring() : addr_(0), size_(0) {}
+
+void Mem::Ring::begin(uint16_t addr, uint16_t size) {
+  addr_ = addr;
+  size_ = size;
+  RingBufferHeader header;
+  header.head = 0;
+  header.tail = 0;
+  header.size = size;
+  Mem::write(addr_, &header, sizeof(header));
+}
+
+void Mem::Ring::attach(uint16_t addr) {
+  addr_ = addr;
+  Mem::read(addr_ + offsetof(RingBufferHeader, size), &size_, sizeof(size_));
+}
+
+void Mem::Ring::readIndexes(uint16_t* head, uint16_t* tail) const {
+  // Read both indexes at once, since they are next to each other.
+  uint16_t indexes[2];
+  Mem::read(addr_ + offsetof(RingBufferHeader, head), indexes,
+            sizeof(indexes));
+  *head = indexes[0];
+  *tail = indexes[1];
+}
+
+uint16_t Mem::Ring::getWriteSize() const {
+  uint16_t head, tail;
+  readIndexes(&head, &tail);
+  return get_ring_write_size(head, tail, size_);
+}
+
+uint16_t Mem::Ring::getReadSize() const {
+  uint16_t head, tail;
+  readIndexes(&head, &tail);
+  return get_ring_read_size(head, tail, size_);
+}
+
+uint16_t Mem::Ring::write(const void* data, uint16_t size) {
+  uint16_t head, tail;
+  readIndexes(&head, &tail);
+  uint16_t room = get_ring_write_size(head, tail, size_);
+  if (size > room)
+    size = room;
+  if (size == 0)
+    return 0;
+
+  // The data may wrap around the end.
+  uint16_t data_addr = addr_ + RING_BUFFER_HEADER_SIZE;
+  uint16_t first_size = min(size, size_ - head);
+  Mem::write(data_addr + head, data, first_size);
+  if (size > first_size) {
+    Mem::write(data_addr, static_cast<const char*>(data) + first_size,
+               size - first_size);
+  }
+
+  // Publish the data only once it has been written.
+  head += size;
+  if (head >= size_)
+    head -= size_;
+  Mem::write(addr_ + offsetof(RingBufferHeader, head), &head, sizeof(head));
+  return size;
+}
+
+uint16_t Mem::Ring::read(void* data, uint16_t size) {
+  uint16_t head, tail;
+  readIndexes(&head, &tail);
+  uint16_t available = get_ring_read_size(head, tail, size_);
+  if (size > available)
+    size = available;
+  if (size == 0)
+    return 0;
+
+  uint16_t data_addr = addr_ + RING_BUFFER_HEADER_SIZE;
+  uint16_t first_size = min(size, size_ - tail);
+  Mem::read(data_addr + tail, data, first_size);
+  if (size > first_size) {
+    Mem::read(data_addr, static_cast<char*>(data) + first_size,
+              size - first_size);
+  }
+
+  // Free up the space only once the data has been read.
+  tail += size;
+  if (tail >= size_)
+    tail -= size_;
+  Mem::write(addr_ + offsetof(RingBufferHeader, tail), &tail, sizeof(tail));
+  return size;
+}
+
 }  // namespace DuinoCube
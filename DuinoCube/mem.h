@@ -20,14 +20,64 @@
 #ifndef __DUINOCUBE_MEM_H__
 #define __DUINOCUBE_MEM_H__
 
+#include <stddef.h>
 #include <stdint.h>
 
 #define SHARED_MEMORY_SIZE   0x8000   // System contains 32KB of shared memory.
 
-// Addresses of RPC input and output args in shared memory.
-#define RPC_COMMAND_ADDR     0x0000
-#define RPC_INPUT_ARG_ADDR   (RPC_COMMAND_ADDR + 0x10)
-#define RPC_OUTPUT_ARG_ADDR  0x0000
+// RPC commands are passed through alternating slots in shared memory, so that
+// the client can prepare the next command while the server runs the current
+// one. Commands use the slots in order, starting from slot 0 after the server
+// is reset.
+#define RPC_NUM_SLOTS             2
+#define RPC_SLOT_SIZE          0x40
+#define RPC_SLOT_ADDR(slot)    ((slot) * RPC_SLOT_SIZE)
+
+// An RPC command is issued as a single frame at the start of a slot: the
+// command code, a flags byte and the input args are contiguous, so the client
+// can write them in one burst and the server can read them in one burst.
+#define RPC_FRAME_SIZE           32
+#define RPC_MAX_ARG_SIZE     (RPC_FRAME_SIZE - 2)
+#define RPC_FRAME_ADDR(slot) RPC_SLOT_ADDR(slot)
+
+// Address of the 16-bit status word and output args of the command in a slot.
+// They do not overlap the frame, so the server never has to read back what it
+// has written, and the client can read them together.
+#define RPC_STATUS_ADDR(slot)       (RPC_SLOT_ADDR(slot) + RPC_FRAME_SIZE)
+#define RPC_OUTPUT_ARG_ADDR(slot)   (RPC_STATUS_ADDR(slot) + 2)
+#define RPC_MAX_OUTPUT_ARG_SIZE     (RPC_SLOT_SIZE - RPC_FRAME_SIZE - 2)
+
+// The server writes the number of commands it has completed to this 16-bit
+// mailbox word.
+#define RPC_MAILBOX_ADDR     (RPC_SLOT_ADDR(RPC_NUM_SLOTS))
+
+// The client writes the ticket of a command to cancel to this 16-bit word. Long
+// commands check it in between segments. Otherwise it holds RPC_NO_TICKET,
+// which the server writes back once it has acted on a cancel or completed the
+// command it names, so that a stale ticket never cancels a later command.
+#define RPC_CANCEL_ADDR      (RPC_MAILBOX_ADDR + 2)
+
+// Tickets and the completed command count wrap around at RPC_TICKET_PERIOD
+// instead of 0x10000, so that RPC_NO_TICKET is never issued. The period is a
+// multiple of RPC_NUM_SLOTS, which must be a power of two, so a ticket's slot
+// does not change at the wraparound.
+#define RPC_TICKET_PERIOD    (0x10000UL - RPC_NUM_SLOTS)
+#define RPC_NO_TICKET        0xffff
+
+// The priority lane is a separate frame for small commands, which the server
+// runs ahead of the commands in the slots, and in between the segments of long
+// commands. The client writes the command code last, and the server clears it
+// once the command has completed.
+#define RPC_PRIORITY_FRAME_ADDR        0x0090
+#define RPC_PRIORITY_FRAME_SIZE            16
+#define RPC_PRIORITY_MAX_ARG_SIZE     (RPC_PRIORITY_FRAME_SIZE - 2)
+#define RPC_PRIORITY_STATUS_ADDR       0x00a0
+#define RPC_PRIORITY_OUTPUT_ARG_ADDR   (RPC_PRIORITY_STATUS_ADDR + 2)
+#define RPC_PRIORITY_MAX_OUTPUT_ARG_SIZE   14
+
+// The default buffer address and size for RPC batch command lists.
+#define RPC_BATCH_BUF_ADDR   0x00b0
+#define RPC_BATCH_BUF_SIZE       80
 
 // The default buffer address and size for passing shared memory strings.
 #define STRING_BUF_ADDR      0x0100
@@ -38,6 +88,11 @@
 #define SHARED_MEMORY_HEAP_SIZE      \
     (SHARED_MEMORY_SIZE - SHARED_MEMORY_HEAP_START)
 #define SHARED_MEMORY_BLOCK_SIZE     256  // Size of heap alloc chunk.
+// Allocations of up to SHARED_MEMORY_SLAB_MAX_SIZE bytes are rounded up to a
+// power of two, starting at SHARED_MEMORY_SLAB_MIN_SIZE, and share blocks with
+// other allocations of the same size.
+#define SHARED_MEMORY_SLAB_MIN_SIZE   16
+#define SHARED_MEMORY_SLAB_MAX_SIZE  128
 
 // Shared RAM opcodes.
 #define RAM_ST_READ          5   // Read/write status register.
@@ -47,6 +102,20 @@
 
 #define RAM_SEQUENTIAL    0x40   // Sets sequential access mode.
 
+// Ring buffers in shared memory, for streaming data between the client and the
+// coprocessor without RPCs. A ring buffer is a RingBufferHeader followed by
+// |size| bytes of data, and holds up to |size| - 1 bytes. It has one producer
+// and one consumer, which can be on either side. The producer only writes
+// |head|, after the data, and the consumer only writes |tail|, after reading
+// the data, so neither side has to wait for the other.
+struct RingBufferHeader {
+  uint16_t head;      // Offset at which the next byte is written.
+  uint16_t tail;      // Offset of the next byte to be read.
+  uint16_t size;      // Size in bytes of the data.
+};
+
+#define RING_BUFFER_HEADER_SIZE   sizeof(RingBufferHeader)
+
 namespace DuinoCube {
 
 class Mem {
@@ -54,16 +123,120 @@ class Mem {
   // Sets up shared memory.
   void begin();
 
-  // Gets stats about shared memory allocation usage.
-  static void stat(uint16_t* free_size, uint16_t* largest_size);
+  // Gets stats about shared memory allocation usage. |fragmentation| is the
+  // percentage of free memory that is outside the largest free region.
+  // |high_water_size| is the most memory that has been allocated at once.
+  static void stat(uint16_t* free_size, uint16_t* largest_size,
+                   uint16_t* fragmentation = NULL,
+                   uint16_t* high_water_size = NULL);
 
   // Alloc and free shared memory.
   static uint16_t alloc(uint16_t size);
   static void free(uint16_t addr);
 
+  // Alloc and free relocatable shared memory, which is referred to by a handle.
+  // It is allocated in whole SHARED_MEMORY_BLOCK_SIZE blocks, so it suits large
+  // buffers. When an allocation does not fit, the coprocessor compacts the heap
+  // by moving relocatable memory that is not locked. allocHandle() returns 0 if
+  // the allocation failed.
+  static uint16_t allocHandle(uint16_t size);
+  static void freeHandle(uint16_t handle);
+
+  // Pins relocatable memory and returns its current address, or NULL if
+  // |handle| is invalid. The address is only valid until the matching unlock().
+  // Locks nest.
+  static uint16_t lock(uint16_t handle);
+  static void unlock(uint16_t handle);
+
+  // Compacts the heap, e.g. between levels. Returns the size in bytes of the
+  // largest free region afterwards.
+  static uint16_t compact();
+
   // Copy data to/from shared memory.
-  void read(uint16_t addr, void* data, uint16_t size);
-  void write(uint16_t addr, const void* data, uint16_t size);
+  static void read(uint16_t addr, void* data, uint16_t size);
+  static void write(uint16_t addr, const void* data, uint16_t size);
+
+  // Copy and fill in the extended address space, which covers shared memory,
+  // the Core and flash. See xaddr.h. The coprocessor handles memory banks and
+  // VRAM access, and leaves them as they were. Copies may not overlap with the
+  // destination after the source. Returns an RPC_STATUS_* code.
+  static uint16_t copy(uint32_t dst_addr, uint32_t src_addr, uint32_t size);
+  // Fills with 16-bit |value|, stored little-endian starting at |dst_addr|.
+  static uint16_t fill(uint32_t dst_addr, uint16_t value, uint32_t size);
+  // Computes the CRC-32 of |size| bytes at |addr| on the coprocessor, e.g. to
+  // verify data loaded into VRAM without reading it back. The result matches
+  // zlib's crc32() and utils/crc32.
+  static uint16_t crc(uint32_t addr, uint32_t size, uint32_t* result);
+
+  // Allocates shared memory from a region that is reserved from the heap once.
+  // Allocations are made on the client without any RPC, by bumping a pointer,
+  // and are all freed at once. This suits buffers that last for a level or a
+  // frame.
+  class Arena {
+   public:
+    Arena();
+
+    // Reserves |size| bytes from the heap. Returns false if the region could
+    // not be allocated.
+    bool begin(uint16_t size);
+
+    // Returns the region to the heap. All allocations from the arena become
+    // invalid.
+    void end();
+
+    // Allocates |size| bytes. Returns NULL if there is not enough room left.
+    uint16_t alloc(uint16_t size);
+
+    // Frees all allocations, e.g. when changing scenes.
+    void reset();
+
+    // Returns a marker for the current allocation state. release() frees
+    // everything allocated after the marker was taken, e.g. per-frame buffers
+    // allocated on top of per-level ones.
+    uint16_t mark() const { return used_; }
+    void release(uint16_t marker);
+
+    // Returns the number of bytes that can still be allocated.
+    uint16_t getFreeSize() const { return size_ - used_; }
+
+   private:
+    uint16_t addr_;             // Location and size of the reserved region.
+    uint16_t size_;
+    uint16_t used_;             // Number of bytes allocated so far.
+  };
+
+  // Client side of a ring buffer in shared memory. See RingBufferHeader.
+  class Ring {
+   public:
+    Ring();
+
+    // Sets up an empty ring buffer at |addr|, with room for
+    // RING_BUFFER_HEADER_SIZE + |size| bytes. Only one side sets it up, before
+    // the other side uses it.
+    void begin(uint16_t addr, uint16_t size);
+
+    // Uses a ring buffer that the coprocessor has set up at |addr|.
+    void attach(uint16_t addr);
+
+    // Producer side. Writes as much of |size| bytes as there is room for, and
+    // returns the number of bytes written. Room only grows until the next
+    // write, so a record can be written whole by checking getWriteSize()
+    // first.
+    uint16_t write(const void* data, uint16_t size);
+    uint16_t getWriteSize() const;
+
+    // Consumer side. Reads up to |size| bytes, and returns the number of bytes
+    // read.
+    uint16_t read(void* data, uint16_t size);
+    uint16_t getReadSize() const;
+
+   private:
+    // Reads |head| and |tail| from shared memory.
+    void readIndexes(uint16_t* head, uint16_t* tail) const;
+
+    uint16_t addr_;             // Location of the header.
+    uint16_t size_;             // Size of the data.
+  };
 };
 
 }  // namespace DuinoCube
@@ -19,16 +19,23 @@
 
 #include "rpc.h"
 
+#include <stdio.h>
+
 #include <Arduino.h>
 #include <SPI.h>
 
 #include "core.h"
 #include "pins.h"
+#include "rpc_stubs.h"
+#include "utils.h"
 
 #define NUM_RESET_CYCLES     4   // Atmega 328 requires 2.5 us reset pulse.
                                  // At 16 MHz with F = F_osc / 2, that's 2.5
                                  // SPI cycles.
 
+#define MIN_ACK_TIME_MS      2   // Time the server is always given to latch a
+                                 // command, even if the timeout has run out.
+
 extern SPIClass SPI;
 
 namespace DuinoCube {
@@ -36,40 +43,111 @@ namespace DuinoCube {
 // For accessing memory.
 static Mem mem;
 
+// Static member variables.
+uint16_t RPC::s_ticket;
+uint16_t RPC::s_num_completed;
+
 void RPC::begin() {
   SET_PIN(RPC_CLIENT_COMMAND_DIR, OUTPUT);
-  writeCommand(RPC_CMD_NONE);
+  setCommandStatus(RPC_CLIENT_NO_COMMAND);
+
+  reset();
+}
 
+void RPC::reset() {
   // Reset the RPC server using SPI cycles for timing.
   SET_PIN(RPC_RESET_DIR, OUTPUT);
   SET_PIN(RPC_RESET_PIN, LOW);
   for (uint8_t i = 0; i < NUM_RESET_CYCLES; ++i)
     SPI.transfer(0);
   SET_PIN(RPC_RESET_DIR, INPUT);
+
+  // The server's completed command count starts from zero after reset.
+  s_ticket = 0;
+  s_num_completed = 0;
 }
 
 uint16_t RPC::hello(uint16_t buf_addr) {
-  RPC_HelloArgs args;
-  args.in.buf_addr = buf_addr;
-  uint16_t status = exec(RPC_CMD_HELLO, &args.in, sizeof(args.in), NULL, 0);
-
-  return status;
+  return RPCStubs::hello(buf_addr);
 }
 
 uint16_t RPC::invert(uint16_t buf_addr, uint16_t size) {
-  RPC_InvertArgs args;
+  return RPCStubs::invert(buf_addr, size);
+}
+
+uint16_t RPC::readCoreID() {
+  uint16_t id;
+  RPCStubs::readCoreID(&id);
+  return id;
+}
+
+uint16_t RPC::readStats(uint16_t buf_addr, bool reset) {
+  RPC_StatsArgs args;
   args.in.buf_addr = buf_addr;
-  args.in.size     = size;
-  uint16_t status = exec(RPC_CMD_INVERT, &args.in, sizeof(args.in), NULL, 0);
+  args.in.reset = reset;
+  exec(RPC_CMD_STATS, &args.in, sizeof(args.in), &args.out, sizeof(args.out));
 
-  return status;
+  return args.out.num_entries;
 }
 
-uint16_t RPC::readCoreID() {
-  RPC_ReadCoreIDArgs args;
-  uint16_t status = exec(RPC_CMD_READ_CORE_ID,
-                         NULL, 0, &args.out, sizeof(args.out));
-  return args.out.id;
+// Names of the RPC command groups, indexed by the upper nibble of the command
+// code.
+static const char* const kCommandGroupNames[RPC_STATS_NUM_GROUPS] = {
+  "None", "Test", "File", "Mem", "USB", "Flash", "Control", "VM", "Core",
+};
+
+void RPC::printStats(bool reset) {
+  // The stats do not fit in the string buffer.
+  uint16_t buf_addr =
+      mem.alloc(RPC_STATS_MAX_ENTRIES * sizeof(RPC_StatsEntry));
+  if (!buf_addr) {
+    printf_P(PSTR("Could not allocate memory for RPC stats.\n"));
+    return;
+  }
+  uint16_t num_entries = readStats(buf_addr, reset);
+
+  // Totals for each command group.
+  struct {
+    uint16_t count;
+    uint32_t total_time;
+    uint32_t max_time;
+    uint32_t num_bytes;
+  } groups[ARRAY_SIZE(kCommandGroupNames)];
+  memset(groups, 0, sizeof(groups));
+
+  // Unless the server keeps stats for each command, there are only group
+  // entries.
+  bool printed_header = false;
+  for (uint16_t i = 0; i < num_entries; ++i) {
+    RPC_StatsEntry entry;
+    mem.read(buf_addr + i * sizeof(entry), &entry, sizeof(entry));
+    if (!(entry.command & RPC_STATS_GROUP_FLAG)) {
+      if (!printed_header)
+        printf_P(PSTR("Command  Count  Total us  Max us  Bytes\n"));
+      printed_header = true;
+      printf_P(PSTR("0x%02x  %5u  %8lu  %6lu  %lu\n"), entry.command,
+               entry.count, entry.total_time, entry.max_time, entry.num_bytes);
+    }
+
+    uint8_t group = (entry.command >> 4) & 0x0f;
+    if (group >= ARRAY_SIZE(groups))
+      continue;
+    groups[group].count += entry.count;
+    groups[group].total_time += entry.total_time;
+    if (entry.max_time > groups[group].max_time)
+      groups[group].max_time = entry.max_time;
+    groups[group].num_bytes += entry.num_bytes;
+  }
+  mem.free(buf_addr);
+
+  printf_P(PSTR("Group  Count  Total us  Max us  Bytes\n"));
+  for (uint8_t group = 0; group < ARRAY_SIZE(groups); ++group) {
+    if (groups[group].count == 0)
+      continue;
+    printf_P(PSTR("%-7s %5u  %8lu  %6lu  %lu\n"), kCommandGroupNames[group],
+             groups[group].count, groups[group].total_time,
+             groups[group].max_time, groups[group].num_bytes);
+  }
 }
 
 void RPC::setCommandStatus(uint8_t status) {
@@ -83,15 +161,6 @@ void RPC::setCommandStatus(uint8_t status) {
   }
 }
 
-void RPC::writeCommand(uint8_t command) {
-  if (command == RPC_CMD_NONE) {
-    setCommandStatus(RPC_CLIENT_NO_COMMAND);
-  } else {
-    mem.write(RPC_COMMAND_ADDR, &command, sizeof(command));
-    setCommandStatus(RPC_CLIENT_COMMAND);
-  }
-}
-
 uint8_t RPC::readServerStatus() {
   switch (GET_PIN(RPC_SERVER_STATUS_PIN)) {
   case HIGH:
@@ -102,36 +171,284 @@ uint8_t RPC::readServerStatus() {
   return RPC_SERVER_IDLE;
 }
 
-void RPC::waitForServerStatus(uint8_t status) {
-  while (readServerStatus() != status);
+bool RPC::timedOut(uint32_t start_ms, uint16_t timeout_ms) {
+  return timeout_ms != RPC_NO_TIMEOUT && millis() - start_ms > timeout_ms;
+}
+
+bool RPC::waitForServerStatus(uint8_t status,
+                              uint32_t start_ms, uint16_t timeout_ms) {
+  while (readServerStatus() != status) {
+    if (timedOut(start_ms, timeout_ms))
+      return false;
+  }
+  return true;
 }
 
 uint16_t RPC::exec(uint8_t command,
-                            const void* in_args, uint8_t in_size,
-                            void* out_args, uint8_t out_size) {
-  // Wait for the server to be ready.
-  // TODO: add a timeout mechanism or fail immediately if not ready?
-  waitForServerStatus(RPC_SERVER_IDLE);
+                   const void* in_args, uint8_t in_size,
+                   void* out_args, uint8_t out_size,
+                   uint16_t timeout_ms) {
+  // Time spent waiting for a free slot counts toward the timeout.
+  uint32_t start_ms = millis();
+  uint16_t ticket;
+  uint16_t status =
+      issue(command, in_args, in_size, start_ms, timeout_ms, &ticket);
+  if (status != RPC_STATUS_OK)
+    return status;
+
+  status = collect(ticket, out_args, out_size, start_ms, timeout_ms);
+  // No one is going to collect the outputs, so don't let it keep running.
+  if (status == RPC_STATUS_TIMEOUT)
+    cancel(ticket);
+  return status;
+}
+
+uint16_t RPC::execPriority(uint8_t command,
+                           const void* in_args, uint8_t in_size,
+                           void* out_args, uint8_t out_size,
+                           uint16_t timeout_ms) {
+  uint32_t start_ms = millis();
+
+  // Write the input args before the command code, so that the server never
+  // sees a command without its args.
+  RPC_Frame frame;
+  frame.command = command;
+  frame.flags = 0;
+  if (!in_args)
+    in_size = 0;
+  if (in_size > RPC_PRIORITY_MAX_ARG_SIZE) {
+    frame.flags |= RPC_FLAG_ARGS_TOO_LARGE;
+    in_size = 0;
+  }
+  if (in_size > 0)
+    memcpy(frame.args, in_args, in_size);
+  mem.write(RPC_PRIORITY_FRAME_ADDR + sizeof(frame.command), &frame.flags,
+            sizeof(frame.flags) + in_size);
+  mem.write(RPC_PRIORITY_FRAME_ADDR, &frame.command, sizeof(frame.command));
+
+  // The server clears the command code when it is done.
+  do {
+    if (timedOut(start_ms, timeout_ms)) {
+      // Withdraw the command in case the server has not started it yet.
+      frame.command = RPC_CMD_NONE;
+      mem.write(RPC_PRIORITY_FRAME_ADDR, &frame.command, sizeof(frame.command));
+      return RPC_STATUS_TIMEOUT;
+    }
+    mem.read(RPC_PRIORITY_FRAME_ADDR, &frame.command, sizeof(frame.command));
+  } while (frame.command != RPC_CMD_NONE);
+
+  // Read the status word and output args together.
+  struct {
+    uint16_t status;
+    uint8_t args[RPC_PRIORITY_MAX_OUTPUT_ARG_SIZE];
+  } result;
+  if (!out_args || out_size > sizeof(result.args))
+    out_size = 0;
+  mem.read(RPC_PRIORITY_STATUS_ADDR, &result, sizeof(result.status) + out_size);
+  if (out_size > 0)
+    memcpy(out_args, result.args, out_size);
+
+  return result.status;
+}
 
-  // Write the command input args to memory.
+uint16_t RPC::submit(uint8_t command, const void* in_args, uint8_t in_size) {
+  uint16_t ticket;
+  issue(command, in_args, in_size, millis(), RPC_NO_TIMEOUT, &ticket);
+  return ticket;
+}
+
+uint16_t RPC::issue(uint8_t command, const void* in_args, uint8_t in_size,
+                    uint32_t start_ms, uint16_t timeout_ms,
+                    uint16_t* ticket) {
+  // Wait for the server to have a free slot. Until then, the next slot is
+  // still in use by an earlier command.
+  if (!waitForServerStatus(RPC_SERVER_IDLE, start_ms, timeout_ms))
+    return RPC_STATUS_TIMEOUT;
+
+  // Write the command code and input args to the next slot as one frame. Args
+  // that do not fit are reported by the server, so that the command still
+  // gets a ticket.
+  RPC_Frame frame;
+  frame.command = command;
+  frame.flags = 0;
+  if (!in_args)
+    in_size = 0;
+  if (in_size > sizeof(frame.args)) {
+    frame.flags |= RPC_FLAG_ARGS_TOO_LARGE;
+    in_size = 0;
+  }
+  if (in_size > 0)
+    memcpy(frame.args, in_args, in_size);
+  mem.write(RPC_FRAME_ADDR(s_ticket % RPC_NUM_SLOTS), &frame,
+            sizeof(frame) - sizeof(frame.args) + in_size);
+
+  // Issue the command and wait for acknowledgment. The server acknowledges
+  // from its pin change interrupt, so give it a moment even if the timeout has
+  // already run out while waiting for a free slot.
+  setCommandStatus(RPC_CLIENT_COMMAND);
+  uint32_t command_ms = millis();
+  while (readServerStatus() != RPC_SERVER_BUSY) {
+    if (timedOut(start_ms, timeout_ms) &&
+        timedOut(command_ms, MIN_ACK_TIME_MS)) {
+      break;
+    }
+  }
+
+  // Decide whether the command was accepted while the command pin is still
+  // asserted. Until it is released, the server does not go back to idle after
+  // latching the command, so this status is final. Reading it after the release
+  // could see the server already idle again with the command still queued,
+  // which would put the tickets out of step with the server.
+  bool acked = readServerStatus() == RPC_SERVER_BUSY;
+
+  // Clear the command status so that the next command is a new pin change. The
+  // server does not wait for this before running the command.
+  setCommandStatus(RPC_CLIENT_NO_COMMAND);
+
+  if (!acked)
+    return RPC_STATUS_TIMEOUT;
+
+  s_ticket = (s_ticket + 1) % RPC_TICKET_PERIOD;
+  *ticket = s_ticket;
+  return RPC_STATUS_OK;
+}
+
+bool RPC::isCompleted(uint16_t ticket) {
+  // Tickets less than half a period behind the completed count have completed.
+  // This handles wraparound of the ticket counter.
+  uint32_t distance =
+      (RPC_TICKET_PERIOD + s_num_completed - ticket) % RPC_TICKET_PERIOD;
+  return distance < RPC_TICKET_PERIOD / 2;
+}
+
+bool RPC::poll(uint16_t ticket) {
+  // Check the last known count first to avoid reading the mailbox.
+  if (isCompleted(ticket))
+    return true;
+
+  // The server status pin only shows whether there is a free slot, so check
+  // the server's completed command count.
+  mem.read(RPC_MAILBOX_ADDR, &s_num_completed, sizeof(s_num_completed));
+  return isCompleted(ticket);
+}
+
+uint16_t RPC::wait(uint16_t ticket, void* out_args, uint8_t out_size,
+                   uint16_t timeout_ms) {
+  return collect(ticket, out_args, out_size, millis(), timeout_ms);
+}
+
+uint16_t RPC::collect(uint16_t ticket, void* out_args, uint8_t out_size,
+                      uint32_t start_ms, uint16_t timeout_ms) {
+  // The slot of a ticket RPC_NUM_SLOTS or more behind the last one issued has
+  // been reused, and a ticket ahead of it has not been issued. Both wrap around
+  // at RPC_TICKET_PERIOD.
+  uint16_t age = (RPC_TICKET_PERIOD + s_ticket - ticket) % RPC_TICKET_PERIOD;
+  if (ticket >= RPC_TICKET_PERIOD || age >= RPC_NUM_SLOTS)
+    return RPC_STATUS_INVALID_ARGS;
+
+  while (!poll(ticket)) {
+    if (timedOut(start_ms, timeout_ms))
+      return RPC_STATUS_TIMEOUT;
+  }
+
+  // Read the status word and output args together. Tickets start from 1, and
+  // the first command uses slot 0. Ticket 0 comes after the wraparound, and
+  // uses the last slot.
+  struct {
+    uint16_t status;
+    uint8_t args[RPC_MAX_OUTPUT_ARG_SIZE];
+  } result;
+  if (!out_args || out_size > sizeof(result.args))
+    out_size = 0;
+  mem.read(RPC_STATUS_ADDR((uint16_t)(ticket - 1) % RPC_NUM_SLOTS),
+           &result, sizeof(result.status) + out_size);
+  if (out_size > 0)
+    memcpy(out_args, result.args, out_size);
+
+  return result.status;
+}
+
+void RPC::cancel(uint16_t ticket) {
+  mem.write(RPC_CANCEL_ADDR, &ticket, sizeof(ticket));
+}
+
+RPCBatch::RPCBatch(uint16_t addr, uint16_t size) : addr_(addr), size_(size) {
+  clear();
+}
+
+void RPCBatch::clear() {
+  end_ = addr_;
+  num_entries_ = 0;
+}
+
+uint8_t RPCBatch::add(uint8_t command, const void* in_args, uint8_t in_size,
+                      uint8_t out_size) {
+  return append(command, in_args, in_size, out_size, RPC_BATCH_NO_LINK, 0, 0);
+}
+
+uint8_t RPCBatch::addLinked(uint8_t command, const void* in_args,
+                            uint8_t in_size, uint8_t out_size,
+                            uint8_t link_entry, uint8_t link_out_offset,
+                            uint8_t link_in_offset) {
+  // Only values from entries that are already in the list can be linked. This
+  // also catches a |link_entry| that came from a failed add().
+  if (link_entry >= num_entries_ ||
+      link_in_offset + RPC_BATCH_LINK_SIZE > in_size) {
+    return kInvalidEntry;
+  }
+  return append(command, in_args, in_size, out_size,
+                link_entry, link_out_offset, link_in_offset);
+}
+
+uint8_t RPCBatch::append(uint8_t command, const void* in_args,
+                         uint8_t in_size, uint8_t out_size,
+                         uint16_t link_entry, uint8_t link_out_offset,
+                         uint8_t link_in_offset) {
+  // Assemble the header and input args so they can be written in one go.
+  union {
+    RPC_BatchEntry entry;
+    uint8_t bytes[sizeof(RPC_BatchEntry) + RPC_BATCH_MAX_ARG_SIZE];
+  } buf;
+  uint16_t entry_size = sizeof(buf.entry) + in_size + out_size;
+  if (num_entries_ >= RPC_BATCH_MAX_ENTRIES ||
+      in_size > RPC_BATCH_MAX_ARG_SIZE ||
+      out_size > RPC_BATCH_MAX_ARG_SIZE ||
+      end_ + entry_size > addr_ + size_) {
+    return kInvalidEntry;
+  }
+
+  buf.entry.command = command;
+  buf.entry.in_size = in_size;
+  buf.entry.out_size = out_size;
+  buf.entry.link_entry = link_entry;
+  buf.entry.link_out_offset = link_out_offset;
+  buf.entry.link_in_offset = link_in_offset;
   if (in_args && in_size > 0)
-    mem.write(RPC_INPUT_ARG_ADDR, in_args, in_size);
+    memcpy(buf.bytes + sizeof(buf.entry), in_args, in_size);
+  mem.write(end_, &buf, sizeof(buf.entry) + in_size);
 
-  // Issue the command and wait for acknowledgment.
-  writeCommand(command);
-  waitForServerStatus(RPC_SERVER_BUSY);
+  out_addrs_[num_entries_] = end_ + sizeof(buf.entry) + in_size;
+  end_ += entry_size;
+  return num_entries_++;
+}
 
-  // Clear the command status register.
-  writeCommand(RPC_CMD_NONE);
+uint16_t RPCBatch::exec() {
+  RPC_BatchArgs args;
+  args.in.list_addr = addr_;
+  args.in.num_entries = num_entries_;
+  // Nothing is reported as executed if the batch command itself fails.
+  args.out.num_executed = 0;
 
-  // Now wait for the RPC to complete.
-  waitForServerStatus(RPC_SERVER_IDLE);
+  RPC::exec(RPC_CMD_BATCH,
+            &args.in, sizeof(args.in),
+            &args.out, sizeof(args.out));
 
-  if (out_args && out_size > 0)
-    mem.read(RPC_OUTPUT_ARG_ADDR, out_args, out_size);
+  return args.out.num_executed;
+}
 
-  // TODO: implement status codes.
-  return 0;
+void RPCBatch::readOutput(uint8_t entry, void* out_args, uint8_t out_size) {
+  if (entry < num_entries_)
+    mem.read(out_addrs_[entry], out_args, out_size);
 }
 
 }  // namespace DuinoCube
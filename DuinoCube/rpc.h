@@ -17,21 +17,48 @@
 
 // DuinoCube Remote Procedure Call (RPC) definitions.
 
-#ifndef __DUINOCUBE_RPC_H___
+#ifndef __DUINOCUBE_RPC_H__
 #define __DUINOCUBE_RPC_H__
 
 #include <stdint.h>
 
 #include "mem.h"
+#include "rpc_batch.h"
+#include "rpc_generated.h"
+#include "rpc_stats.h"
 
 // Server and client status values.
-#define RPC_SERVER_BUSY            0    // Server is executing a command.
-#define RPC_SERVER_IDLE            1    // Server is idle, ready for commands.
+#define RPC_SERVER_BUSY            0    // Server has no free command slot.
+#define RPC_SERVER_IDLE            1    // Server is ready for commands.
 #define RPC_CLIENT_COMMAND         0    // Client has issued a command.
 #define RPC_CLIENT_NO_COMMAND      1    // Client has issued no command.
 
+// Pass as |timeout_ms| to wait for as long as it takes.
+#define RPC_NO_TIMEOUT        0xffff
+
+// RPC status codes.
+enum {
+  RPC_STATUS_OK = 0,                // Command succeeded.
+  RPC_STATUS_FAILED,                // Command failed, e.g. file not found.
+  RPC_STATUS_INVALID_COMMAND,       // Unrecognized or disallowed command.
+  RPC_STATUS_INVALID_ARGS,          // Args are out of range or do not fit.
+  RPC_STATUS_CANCELED,              // Command was canceled by the client.
+  RPC_STATUS_TIMEOUT,               // Client stopped waiting for the command.
+};
+
+// RPC frame flags.
+#define RPC_FLAG_ARGS_TOO_LARGE     (1 << 0)  // Args did not fit in the frame.
+
+// Layout of an RPC command frame at RPC_FRAME_ADDR().
+typedef struct {
+  uint8_t command;              // RPC command code.
+  uint8_t flags;                // RPC_FLAG_* bits.
+  uint8_t args[RPC_MAX_ARG_SIZE];   // Input args.
+} RPC_Frame;
+
 // RPC command codes.  These should be consistent with definitions in the
-// chronocube repo, for the purposes of RAM bus arbitration.
+// chronocube repo, for the purposes of RAM bus arbitration.  Commands that the
+// firmware implements must also be listed in rpc_commands.txt.
 enum {
 
   RPC_CMD_NONE = 0x00,              // The NOP RPC command value.
@@ -49,11 +76,26 @@ enum {
   RPC_CMD_FILE_WRITE,               // Write data to a file handle.
   RPC_CMD_FILE_SIZE,                // Get the file size in bytes.
   RPC_CMD_FILE_SEEK,                // Move file handle pointer.
+  RPC_CMD_FILE_WINDOW_MAP,          // Map a file range to paged shared memory.
+  RPC_CMD_FILE_WINDOW_UNMAP,        // Unmap a file range.
+  RPC_CMD_FILE_WINDOW_TOUCH,        // Get a page of a file range, reading it in
+                                    // if needed.
+  RPC_CMD_SNAPSHOT,                 // Save Core and shared memory to a file.
 
   // Shared memory allocation commands.
   RPC_CMD_MEM_STAT = 0x30,          // Get stats about shared memory heap.
   RPC_CMD_MEM_ALLOC,                // Allocate memory from heap.
   RPC_CMD_MEM_FREE,                 // Free memory allocated from heap.
+  RPC_CMD_COPY,                     // Copy data in the extended address space.
+  RPC_CMD_FILL,                     // Fill data in the extended address space.
+  RPC_CMD_MEM_ALLOC_HANDLE,         // Allocate relocatable memory from heap.
+  RPC_CMD_MEM_FREE_HANDLE,          // Free relocatable memory.
+  RPC_CMD_MEM_LOCK,                 // Pin relocatable memory, get its address.
+  RPC_CMD_MEM_UNLOCK,               // Unpin relocatable memory.
+  RPC_CMD_MEM_COMPACT,              // Move relocatable memory to merge free
+                                    // regions.
+  RPC_CMD_CRC,                      // Compute the CRC-32 of data in the
+                                    // extended address space.
 
   // USB and Joystick commands.
   RPC_CMD_USB_STATUS = 0x40,        // Get USB device status.
@@ -63,34 +105,24 @@ enum {
   RPC_CMD_FLASH_PROGRAM = 0x50,     // Program flash.
   RPC_CMD_FLASH_VERIFY,             // Verify flash.
 
-};  // enum
+  // RPC control commands.
+  RPC_CMD_BATCH = 0x60,             // Execute a list of commands.
+  RPC_CMD_STATS,                    // Get RPC execution stats.
 
-// RPC argument structures.
+  // Script VM commands.
+  RPC_CMD_VM_RUN = 0x70,            // Run a script once.
+  RPC_CMD_VM_START,                 // Start running a script in the background.
+  RPC_CMD_VM_STOP,                  // Stop the background script.
+  RPC_CMD_VM_STATUS,                // Get the state of the background script.
 
-// For RPC_CMD_HELLO.
-typedef struct {
-  struct {
-    uint16_t buf_addr;          // Shared memory address of buffer.
-  } in;
-  // No outputs.
-} RPC_HelloArgs;
+  // Core commands.
+  RPC_CMD_CORE_WRITE_LIST = 0x80,   // Apply a list of writes at the next vblank.
+  RPC_CMD_CORE_WRITE_LIST_STATUS,   // Get the state of the last write list.
 
-// For RPC_CMD_INVERT.
-typedef struct {
-  struct {
-    uint16_t buf_addr;          // Shared memory address of buffer.
-    uint16_t size;              // Length in bytes of data to invert.
-  } in;
-  // No outputs.
-} RPC_InvertArgs;
-
-// For RPC_CMD_READ_CORE_ID.
-typedef struct {
-  // No inputs.
-  struct {
-    uint16_t id;                // ID code that was read.
-  } out;
-} RPC_ReadCoreIDArgs;
+};  // enum
+
+// RPC argument structures for the test commands are generated, see
+// rpc_commands.txt.
 
 namespace DuinoCube {
 
@@ -98,26 +130,152 @@ class RPC {
  public:
   static void begin();
 
-  // Executes an RPC function.
+  // Resets the RPC server, e.g. to recover from a command that is stuck. Any
+  // outstanding functions are abandoned.
+  static void reset();
+
+  // Executes an RPC function. Returns an RPC_STATUS_* code. If the function
+  // does not complete within |timeout_ms|, it is canceled and
+  // RPC_STATUS_TIMEOUT is returned.
   static uint16_t exec(uint8_t command,
                        const void* in_args, uint8_t in_size,
-                       void* out_args, uint8_t out_size);
+                       void* out_args, uint8_t out_size,
+                       uint16_t timeout_ms = RPC_NO_TIMEOUT);
+
+  // Executes a small RPC function through the priority lane. The server runs it
+  // ahead of any submitted functions, and in between the segments of long
+  // functions such as file reads. Only functions that do not use the file
+  // system are allowed, i.e. those marked "priority" in rpc_commands.txt, such
+  // as RPC_CMD_READ_CORE_ID, RPC_CMD_MEM_STAT and RPC_CMD_USB_READ_JOYSTICK.
+  static uint16_t execPriority(uint8_t command,
+                               const void* in_args, uint8_t in_size,
+                               void* out_args, uint8_t out_size,
+                               uint16_t timeout_ms = RPC_NO_TIMEOUT);
+
+  // Issues an RPC function without waiting for it to complete. Returns a
+  // ticket for use with poll() and wait(). Up to RPC_NUM_SLOTS functions can
+  // be outstanding, so the client can prepare the next function while the
+  // server is running the current one.
+  //
+  // Each function's output args are kept in its slot, which is reused by the
+  // function submitted RPC_NUM_SLOTS tickets later. So to read the outputs,
+  // call wait() before submitting that many more functions. Submitting without
+  // ever waiting is only safe for functions whose outputs are not needed.
+  static uint16_t submit(uint8_t command, const void* in_args, uint8_t in_size);
+
+  // Returns true if the RPC function with |ticket| has completed. Does not
+  // block.
+  static bool poll(uint16_t ticket);
+
+  // Waits for the RPC function with |ticket| to complete and reads its output
+  // args. Returns its RPC_STATUS_* code, or RPC_STATUS_TIMEOUT if it has not
+  // completed within |timeout_ms|. The output args share a slot with later
+  // functions, so they must be collected before another RPC_NUM_SLOTS
+  // functions are submitted. Otherwise, or if |ticket| has not been issued,
+  // returns RPC_STATUS_INVALID_ARGS without reading the slot.
+  static uint16_t wait(uint16_t ticket, void* out_args, uint8_t out_size,
+                       uint16_t timeout_ms = RPC_NO_TIMEOUT);
+
+  // Asks the server to stop the RPC function with |ticket|. Long functions
+  // stop at the next segment boundary and complete with RPC_STATUS_CANCELED.
+  // Short functions may complete normally.
+  static void cancel(uint16_t ticket);
 
   // RPC test functions.
   static uint16_t hello(uint16_t buf_addr);
   static uint16_t invert(uint16_t buf_addr, uint16_t size);
   static uint16_t readCoreID();
 
+  // Copies the server's RPC stats to the shared memory buffer at |buf_addr|,
+  // as an array of up to RPC_STATS_MAX_ENTRIES RPC_StatsEntry, one for each
+  // command group, or each command, that has been executed. Returns the number
+  // of entries. If |reset| is set, the server's stats are cleared afterward.
+  static uint16_t readStats(uint16_t buf_addr, bool reset);
+
+  // Prints the server's RPC stats, per command if the server keeps them, and
+  // per command group. The
+  // stats are read into a buffer allocated from shared memory.
+  static void printStats(bool reset);
+
  private:
   // Sets the client command status pin.
   static void setCommandStatus(uint8_t value);
-  // Writes an RPC command code to shared memory.
-  static void writeCommand(uint8_t command);
   // Reads the server status pin.
   static uint8_t readServerStatus();
 
-  // Waits for the RPC Server status to become |status|.
-  static void waitForServerStatus(uint8_t status);
+  // Returns true if more than |timeout_ms| has passed since |start_ms|.
+  static bool timedOut(uint32_t start_ms, uint16_t timeout_ms);
+
+  // Waits for the RPC Server status to become |status|. Returns false if it
+  // did not within |timeout_ms| of |start_ms|.
+  static bool waitForServerStatus(uint8_t status,
+                                  uint32_t start_ms, uint16_t timeout_ms);
+
+  // Writes a command frame to the next slot and issues it. Returns an
+  // RPC_STATUS_* code, and the ticket in |ticket| if the command was issued.
+  static uint16_t issue(uint8_t command, const void* in_args, uint8_t in_size,
+                        uint32_t start_ms, uint16_t timeout_ms,
+                        uint16_t* ticket);
+
+  // Waits for the function with |ticket| to complete and reads its status word
+  // and output args.
+  static uint16_t collect(uint16_t ticket, void* out_args, uint8_t out_size,
+                          uint32_t start_ms, uint16_t timeout_ms);
+
+  // Returns true if |ticket| is covered by |s_num_completed|.
+  static bool isCompleted(uint16_t ticket);
+
+  // Ticket of the most recently submitted function.
+  static uint16_t s_ticket;
+  // Server's completed function count, as of the last mailbox read.
+  static uint16_t s_num_completed;
+};
+
+// Builds a list of RPC commands in shared memory, to be executed by the server
+// with a single RPC handshake.
+class RPCBatch {
+ public:
+  // Returned by add() if the entry could not be added.
+  static const uint8_t kInvalidEntry = 0xff;
+
+  // The list is built in the shared memory buffer at |addr|.
+  RPCBatch(uint16_t addr = RPC_BATCH_BUF_ADDR,
+           uint16_t size = RPC_BATCH_BUF_SIZE);
+
+  // Appends a command to the list. Returns the index of the new entry, or
+  // |kInvalidEntry| if the list is full.
+  uint8_t add(uint8_t command, const void* in_args, uint8_t in_size,
+              uint8_t out_size);
+
+  // Same as add(), but the 16-bit value at |link_out_offset| in the output
+  // args of entry |link_entry| is placed at |link_in_offset| in the input args
+  // before the command is executed. If that value is zero, the list is
+  // aborted at this entry. A value that does not lie within both sets of args
+  // also aborts the list, with RPC_STATUS_INVALID_ARGS.
+  uint8_t addLinked(uint8_t command, const void* in_args, uint8_t in_size,
+                    uint8_t out_size, uint8_t link_entry,
+                    uint8_t link_out_offset, uint8_t link_in_offset);
+
+  // Executes the list. Returns the number of entries that were executed.
+  uint16_t exec();
+
+  // Reads the output args of |entry| after the list has been executed.
+  void readOutput(uint8_t entry, void* out_args, uint8_t out_size);
+
+  // Empties the list so it can be reused.
+  void clear();
+
+ private:
+  // Writes a new entry to the end of the list.
+  uint8_t append(uint8_t command, const void* in_args, uint8_t in_size,
+                 uint8_t out_size, uint16_t link_entry,
+                 uint8_t link_out_offset, uint8_t link_in_offset);
+
+  uint16_t addr_;               // Location and size of list buffer.
+  uint16_t size_;
+  uint16_t end_;                // Address of the end of the list.
+  uint8_t num_entries_;
+  uint16_t out_addrs_[RPC_BATCH_MAX_ENTRIES];   // Output args of each entry.
 };
 
 }  // namespace DuinoCube
@@ -0,0 +1,71 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube Remote Procedure Call (RPC) definitions: batched command lists.
+
+#ifndef __DUINOCUBE_RPC_BATCH_H__
+#define __DUINOCUBE_RPC_BATCH_H__
+
+#include <stdint.h>
+
+// Note: all fields are to be at least uint16_t for alignment compatibility
+// between 8-bit and non-8-bit systems (e.g. ARM).
+
+// Max number of commands in a batch command list.
+#define RPC_BATCH_MAX_ENTRIES       8
+
+// Max size in bytes of the input or output args of a batched command.
+#define RPC_BATCH_MAX_ARG_SIZE     16
+
+// Value of |link_entry| for entries that do not take an earlier result.
+#define RPC_BATCH_NO_LINK      0xffff
+
+// Linked values are always 16-bit, e.g. file handles, addresses and sizes.
+#define RPC_BATCH_LINK_SIZE   sizeof(uint16_t)
+
+// A batch command list is a sequence of entries packed back to back in shared
+// memory. Each entry consists of this header, followed by |in_size| bytes of
+// input args, followed by |out_size| bytes of space that the server fills in
+// with the command's output args.
+//
+// An entry can take a 16-bit value from the output args of an earlier entry,
+// e.g. the handle returned by RPC_CMD_FILE_OPEN. A linked value of zero means
+// that the earlier command failed, so the rest of the list is skipped.
+struct RPC_BatchEntry {
+  uint16_t command;             // RPC command code.
+  uint16_t in_size;             // Size in bytes of the input args.
+  uint16_t out_size;            // Size in bytes of the output args.
+  uint16_t link_entry;          // Index of the earlier entry whose output is
+                                // passed to this entry, or RPC_BATCH_NO_LINK.
+  uint16_t link_out_offset;     // Offset of the value in the output args of
+                                // entry |link_entry|.
+  uint16_t link_in_offset;      // Offset in this entry's input args at which
+                                // the value is placed.
+};
+
+// For RPC_CMD_BATCH.
+struct RPC_BatchArgs {
+  struct {
+    uint16_t list_addr;         // Shared memory address of the command list.
+    uint16_t num_entries;       // Number of entries in the list.
+  } in;
+  struct {
+    uint16_t num_executed;      // Number of entries that were executed.
+  } out;
+};
+
+#endif  // __DUINOCUBE_RPC_BATCH_H__
@@ -0,0 +1,37 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube Remote Procedure Call (RPC) definitions: Core write lists.
+
+#ifndef __DUINOCUBE_RPC_CORE_H__
+#define __DUINOCUBE_RPC_CORE_H__
+
+#include <stdint.h>
+
+// A write list is a sequence of entries packed back to back in shared memory.
+// Each entry consists of this header, followed by |size| bytes of data to be
+// written to the Core at |addr|. Core addresses are as seen by the client, so
+// writes at VRAM_BASE and above go to the Core memory bank that is selected at
+// the time, which may be changed by an earlier entry in the list. The list may
+// be applied in the middle of another command, so the memory bank and the VRAM
+// access bit of REG_SYS_CTRL are restored once the list has been applied.
+struct RPC_WriteListEntry {
+  uint16_t addr;                // Core address to write to.
+  uint16_t size;                // Size in bytes of the data that follows.
+};
+
+#endif  // __DUINOCUBE_RPC_CORE_H__
@@ -0,0 +1,187 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// Generated by utils/rpcgen from DuinoCube/rpc_commands.txt.  Do not edit.
+
+#ifndef __DUINOCUBE_RPC_GENERATED_H__
+#define __DUINOCUBE_RPC_GENERATED_H__
+
+#include <stdint.h>
+
+// Number of RPC commands, generated or not.
+#define RPC_NUM_COMMANDS  33
+
+// For RPC_CMD_HELLO.
+typedef struct {
+  struct {
+    uint16_t buf_addr;          // Shared memory address of buffer.
+  } __attribute__((packed)) in;
+  // No outputs.
+} RPC_HelloArgs;
+
+// For RPC_CMD_INVERT.
+typedef struct {
+  struct {
+    uint16_t buf_addr;          // Shared memory address of buffer.
+    uint16_t size;              // Length in bytes of data to invert.
+  } __attribute__((packed)) in;
+  // No outputs.
+} RPC_InvertArgs;
+
+// For RPC_CMD_READ_CORE_ID.
+typedef struct {
+  // No inputs.
+  struct {
+    uint16_t id;                // ID code that was read.
+  } __attribute__((packed)) out;
+} RPC_ReadCoreIDArgs;
+
+// For RPC_CMD_FILE_WINDOW_MAP.
+typedef struct {
+  struct {
+    uint16_t handle;            // Handle of file to map, opened for reading.
+    uint32_t offset;            // File offset of the start of the range.
+    uint16_t buf_addr;          // Shared memory address of the pages.
+    uint16_t page_size;         // Size of each page in bytes.
+    uint16_t num_pages;         // At most FILE_WINDOW_MAX_PAGES.
+  } __attribute__((packed)) in;
+  struct {
+    uint16_t window;            // Handle of the mapping, or 0 on failure.
+  } __attribute__((packed)) out;
+} RPC_FileWindowMapArgs;
+
+// For RPC_CMD_FILE_WINDOW_UNMAP.
+typedef struct {
+  struct {
+    uint16_t window;            // Handle of the mapping.
+  } __attribute__((packed)) in;
+  // No outputs.
+} RPC_FileWindowUnmapArgs;
+
+// For RPC_CMD_FILE_WINDOW_TOUCH.
+typedef struct {
+  struct {
+    uint16_t window;            // Handle of the mapping.
+    uint16_t page;              // Index of the page in the mapped range.
+  } __attribute__((packed)) in;
+  struct {
+    uint16_t addr;              // Shared memory address of the page.
+  } __attribute__((packed)) out;
+} RPC_FileWindowTouchArgs;
+
+// For RPC_CMD_SNAPSHOT.
+typedef struct {
+  struct {
+    uint16_t filename_addr;     // Address of filename string in shared memory.
+  } __attribute__((packed)) in;
+  // No outputs.
+} RPC_SnapshotArgs;
+
+// For RPC_CMD_COPY.
+typedef struct {
+  struct {
+    uint32_t dst_addr;          // Extended address to copy to.
+    uint32_t src_addr;          // Extended address to copy from.
+    uint32_t size;              // Number of bytes to copy.
+  } __attribute__((packed)) in;
+  // No outputs.
+} RPC_CopyArgs;
+
+// For RPC_CMD_FILL.
+typedef struct {
+  struct {
+    uint32_t dst_addr;          // Extended address to fill.
+    uint32_t size;              // Number of bytes to fill.
+    uint16_t value;             // 16-bit pattern, stored little-endian.
+  } __attribute__((packed)) in;
+  // No outputs.
+} RPC_FillArgs;
+
+// For RPC_CMD_CRC.
+typedef struct {
+  struct {
+    uint32_t addr;              // Extended address of the data.
+    uint32_t size;              // Number of bytes to check.
+  } __attribute__((packed)) in;
+  struct {
+    uint32_t crc;               // CRC-32 of the data, as computed by zlib.
+  } __attribute__((packed)) out;
+} RPC_CrcArgs;
+
+// For RPC_CMD_VM_RUN.
+typedef struct {
+  struct {
+    uint16_t code_addr;         // Shared memory address of the script.
+    uint16_t code_size;         // Size of the script in bytes.
+    uint16_t data_addr;         // Initial value of r1.
+    uint16_t max_steps;         // Instruction limit, or 0 for the default.
+  } __attribute__((packed)) in;
+  struct {
+    uint16_t error;             // VM_ERROR_* code.
+    uint16_t pc;                // Offset of the last instruction that was run.
+    uint16_t num_steps;         // Number of instructions that were run.
+  } __attribute__((packed)) out;
+} RPC_VmRunArgs;
+
+// For RPC_CMD_VM_START.
+typedef struct {
+  struct {
+    uint16_t code_addr;         // Shared memory address of the script.
+    uint16_t code_size;         // Size of the script in bytes.
+    uint16_t data_addr;         // Initial value of r1.
+    uint16_t max_steps;         // Per-run instruction limit, or 0 for default.
+    uint16_t mode;              // VM_MODE_IDLE or VM_MODE_VBLANK.
+  } __attribute__((packed)) in;
+  // No outputs.
+} RPC_VmStartArgs;
+
+// For RPC_CMD_VM_STOP.
+typedef struct {
+  // No inputs.
+  // No outputs.
+} RPC_VmStopArgs;
+
+// For RPC_CMD_VM_STATUS.
+typedef struct {
+  // No inputs.
+  struct {
+    uint16_t mode;              // VM_MODE_* of the background script.
+    uint16_t num_runs;          // Number of runs since it was started.
+    uint16_t error;             // VM_ERROR_* code of the last run.
+    uint16_t pc;                // Offset of the last instruction that was run.
+  } __attribute__((packed)) out;
+} RPC_VmStatusArgs;
+
+// For RPC_CMD_CORE_WRITE_LIST.
+typedef struct {
+  struct {
+    uint16_t list_addr;         // Shared memory address of the write list.
+    uint16_t list_size;         // Size of the write list in bytes.
+  } __attribute__((packed)) in;
+  // No outputs.
+} RPC_CoreWriteListArgs;
+
+// For RPC_CMD_CORE_WRITE_LIST_STATUS.
+typedef struct {
+  // No inputs.
+  struct {
+    uint16_t pending;           // 1 if the list has not been applied yet.
+    uint16_t num_applied;       // Number of lists applied so far.
+  } __attribute__((packed)) out;
+} RPC_CoreWriteListStatusArgs;
+
+#endif  // __DUINOCUBE_RPC_GENERATED_H__
@@ -32,6 +32,14 @@ struct RPC_MemStatArgs {
     uint16_t total_free_size;     // Number of bytes free.
     uint16_t largest_free_size;   // Size in bytes of largest continguous
                                   // unallocated region.
+    uint16_t num_free_regions;    // Number of separate unallocated regions.
+    uint16_t slab_size;           // Number of bytes used by slabs for small
+                                  // allocations.
+    uint16_t slab_free_size;      // Number of bytes free in slabs.
+    uint16_t fragmentation;       // Percentage of free bytes that are outside
+                                  // the largest free region.
+    uint16_t high_water_size;     // Most bytes that have been allocated at
+                                  // once.
   } out;
 };
 
@@ -51,4 +59,44 @@ struct RPC_MemFreeArgs {
   // No outputs.
 };
 
+struct RPC_MemAllocHandleArgs {
+  struct {
+    uint16_t size;                // Number of bytes to allocate.
+  } in;
+  struct {
+    uint16_t handle;              // Handle of the relocatable memory, or 0.
+  } out;
+};
+
+struct RPC_MemFreeHandleArgs {
+  struct {
+    uint16_t handle;              // Handle of relocatable memory to free.
+  } in;
+  // No outputs.
+};
+
+struct RPC_MemLockArgs {
+  struct {
+    uint16_t handle;              // Handle of relocatable memory to lock.
+  } in;
+  struct {
+    uint16_t addr;                // Current address of the memory.
+  } out;
+};
+
+struct RPC_MemUnlockArgs {
+  struct {
+    uint16_t handle;              // Handle of relocatable memory to unlock.
+  } in;
+  // No outputs.
+};
+
+struct RPC_MemCompactArgs {
+  // No inputs.
+  struct {
+    uint16_t largest_free_size;   // Size in bytes of largest continguous
+                                  // unallocated region after compaction.
+  } out;
+};
+
 #endif  // __DUINOCUBE_RPC_MEM_H__
@@ -0,0 +1,65 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube Remote Procedure Call (RPC) definitions: RPC statistics.
+
+#ifndef __DUINOCUBE_RPC_STATS_H__
+#define __DUINOCUBE_RPC_STATS_H__
+
+#include <stdint.h>
+
+#include "rpc_generated.h"
+
+// Note: all fields are to be at least uint16_t for alignment compatibility
+// between 8-bit and non-8-bit systems (e.g. ARM).
+
+// The server keeps stats for each group of commands, i.e. for each upper nibble
+// of the command code, which saves RAM. If the firmware is built with
+// RPC_STATS_PER_COMMAND defined, it keeps them for each command instead.
+#define RPC_STATS_NUM_GROUPS          9
+
+// Entries that hold the stats of a command group have this flag set in
+// |command|, along with the upper nibble of the group's command codes.
+#define RPC_STATS_GROUP_FLAG      0x100
+
+// Max number of entries, enough for either kind of stats.
+#define RPC_STATS_MAX_ENTRIES      RPC_NUM_COMMANDS
+
+// Stats about one RPC command code.
+struct RPC_StatsEntry {
+  uint16_t command;             // RPC command code, or RPC_STATS_GROUP_FLAG
+                                // and the group's command codes.
+  uint16_t count;               // Number of times the command was executed.
+  uint32_t total_time;          // Total execution time in microseconds.
+  uint32_t max_time;            // Longest execution time in microseconds.
+  uint32_t num_bytes;           // Total number of data bytes moved, e.g. to or
+                                // from files.
+};
+
+// For RPC_CMD_STATS.
+struct RPC_StatsArgs {
+  struct {
+    uint16_t buf_addr;          // Shared memory address to which an array of
+                                // RPC_StatsEntry is written.
+    uint16_t reset;             // If nonzero, clear the stats after reading.
+  } in;
+  struct {
+    uint16_t num_entries;       // Number of entries written.
+  } out;
+};
+
+#endif  // __DUINOCUBE_RPC_STATS_H__
@@ -0,0 +1,232 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// Generated by utils/rpcgen from DuinoCube/rpc_commands.txt.  Do not edit.
+
+#ifndef __DUINOCUBE_RPC_STUBS_H__
+#define __DUINOCUBE_RPC_STUBS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rpc.h"
+
+namespace DuinoCube {
+
+// Each stub executes its command with the given input args, stores the output
+// args through the given pointers and returns an RPC_STATUS_* code.
+namespace RPCStubs {
+
+// RPC_CMD_HELLO.
+inline uint16_t hello(uint16_t buf_addr) {
+  RPC_HelloArgs args;
+  args.in.buf_addr = buf_addr;
+  uint16_t status = RPC::exec(RPC_CMD_HELLO,
+                              &args.in, sizeof(args.in),
+                              NULL, 0);
+  return status;
+}
+
+// RPC_CMD_INVERT.
+inline uint16_t invert(uint16_t buf_addr, uint16_t size) {
+  RPC_InvertArgs args;
+  args.in.buf_addr = buf_addr;
+  args.in.size = size;
+  uint16_t status = RPC::exec(RPC_CMD_INVERT,
+                              &args.in, sizeof(args.in),
+                              NULL, 0);
+  return status;
+}
+
+// RPC_CMD_READ_CORE_ID.
+inline uint16_t readCoreID(uint16_t* id) {
+  RPC_ReadCoreIDArgs args;
+  uint16_t status = RPC::exec(RPC_CMD_READ_CORE_ID,
+                              NULL, 0,
+                              &args.out, sizeof(args.out));
+  *id = args.out.id;
+  return status;
+}
+
+// RPC_CMD_FILE_WINDOW_MAP.
+inline uint16_t fileWindowMap(uint16_t handle, uint32_t offset,
+                              uint16_t buf_addr, uint16_t page_size,
+                              uint16_t num_pages, uint16_t* window) {
+  RPC_FileWindowMapArgs args;
+  args.in.handle = handle;
+  args.in.offset = offset;
+  args.in.buf_addr = buf_addr;
+  args.in.page_size = page_size;
+  args.in.num_pages = num_pages;
+  uint16_t status = RPC::exec(RPC_CMD_FILE_WINDOW_MAP,
+                              &args.in, sizeof(args.in),
+                              &args.out, sizeof(args.out));
+  *window = args.out.window;
+  return status;
+}
+
+// RPC_CMD_FILE_WINDOW_UNMAP.
+inline uint16_t fileWindowUnmap(uint16_t window) {
+  RPC_FileWindowUnmapArgs args;
+  args.in.window = window;
+  uint16_t status = RPC::exec(RPC_CMD_FILE_WINDOW_UNMAP,
+                              &args.in, sizeof(args.in),
+                              NULL, 0);
+  return status;
+}
+
+// RPC_CMD_FILE_WINDOW_TOUCH.
+inline uint16_t fileWindowTouch(uint16_t window, uint16_t page,
+                                uint16_t* addr) {
+  RPC_FileWindowTouchArgs args;
+  args.in.window = window;
+  args.in.page = page;
+  uint16_t status = RPC::exec(RPC_CMD_FILE_WINDOW_TOUCH,
+                              &args.in, sizeof(args.in),
+                              &args.out, sizeof(args.out));
+  *addr = args.out.addr;
+  return status;
+}
+
+// RPC_CMD_SNAPSHOT.
+inline uint16_t snapshot(uint16_t filename_addr) {
+  RPC_SnapshotArgs args;
+  args.in.filename_addr = filename_addr;
+  uint16_t status = RPC::exec(RPC_CMD_SNAPSHOT,
+                              &args.in, sizeof(args.in),
+                              NULL, 0);
+  return status;
+}
+
+// RPC_CMD_COPY.
+inline uint16_t copy(uint32_t dst_addr, uint32_t src_addr, uint32_t size) {
+  RPC_CopyArgs args;
+  args.in.dst_addr = dst_addr;
+  args.in.src_addr = src_addr;
+  args.in.size = size;
+  uint16_t status = RPC::exec(RPC_CMD_COPY,
+                              &args.in, sizeof(args.in),
+                              NULL, 0);
+  return status;
+}
+
+// RPC_CMD_FILL.
+inline uint16_t fill(uint32_t dst_addr, uint32_t size, uint16_t value) {
+  RPC_FillArgs args;
+  args.in.dst_addr = dst_addr;
+  args.in.size = size;
+  args.in.value = value;
+  uint16_t status = RPC::exec(RPC_CMD_FILL,
+                              &args.in, sizeof(args.in),
+                              NULL, 0);
+  return status;
+}
+
+// RPC_CMD_CRC.
+inline uint16_t crc(uint32_t addr, uint32_t size, uint32_t* crc) {
+  RPC_CrcArgs args;
+  args.in.addr = addr;
+  args.in.size = size;
+  uint16_t status = RPC::exec(RPC_CMD_CRC,
+                              &args.in, sizeof(args.in),
+                              &args.out, sizeof(args.out));
+  *crc = args.out.crc;
+  return status;
+}
+
+// RPC_CMD_VM_RUN.
+inline uint16_t vmRun(uint16_t code_addr, uint16_t code_size,
+                      uint16_t data_addr, uint16_t max_steps, uint16_t* error,
+                      uint16_t* pc, uint16_t* num_steps) {
+  RPC_VmRunArgs args;
+  args.in.code_addr = code_addr;
+  args.in.code_size = code_size;
+  args.in.data_addr = data_addr;
+  args.in.max_steps = max_steps;
+  uint16_t status = RPC::exec(RPC_CMD_VM_RUN,
+                              &args.in, sizeof(args.in),
+                              &args.out, sizeof(args.out));
+  *error = args.out.error;
+  *pc = args.out.pc;
+  *num_steps = args.out.num_steps;
+  return status;
+}
+
+// RPC_CMD_VM_START.
+inline uint16_t vmStart(uint16_t code_addr, uint16_t code_size,
+                        uint16_t data_addr, uint16_t max_steps, uint16_t mode) {
+  RPC_VmStartArgs args;
+  args.in.code_addr = code_addr;
+  args.in.code_size = code_size;
+  args.in.data_addr = data_addr;
+  args.in.max_steps = max_steps;
+  args.in.mode = mode;
+  uint16_t status = RPC::exec(RPC_CMD_VM_START,
+                              &args.in, sizeof(args.in),
+                              NULL, 0);
+  return status;
+}
+
+// RPC_CMD_VM_STOP.
+inline uint16_t vmStop() {
+  uint16_t status = RPC::exec(RPC_CMD_VM_STOP,
+                              NULL, 0,
+                              NULL, 0);
+  return status;
+}
+
+// RPC_CMD_VM_STATUS.
+inline uint16_t vmStatus(uint16_t* mode, uint16_t* num_runs, uint16_t* error,
+                         uint16_t* pc) {
+  RPC_VmStatusArgs args;
+  uint16_t status = RPC::exec(RPC_CMD_VM_STATUS,
+                              NULL, 0,
+                              &args.out, sizeof(args.out));
+  *mode = args.out.mode;
+  *num_runs = args.out.num_runs;
+  *error = args.out.error;
+  *pc = args.out.pc;
+  return status;
+}
+
+// RPC_CMD_CORE_WRITE_LIST.
+inline uint16_t coreWriteList(uint16_t list_addr, uint16_t list_size) {
+  RPC_CoreWriteListArgs args;
+  args.in.list_addr = list_addr;
+  args.in.list_size = list_size;
+  uint16_t status = RPC::exec(RPC_CMD_CORE_WRITE_LIST,
+                              &args.in, sizeof(args.in),
+                              NULL, 0);
+  return status;
+}
+
+// RPC_CMD_CORE_WRITE_LIST_STATUS.
+inline uint16_t coreWriteListStatus(uint16_t* pending, uint16_t* num_applied) {
+  RPC_CoreWriteListStatusArgs args;
+  uint16_t status = RPC::exec(RPC_CMD_CORE_WRITE_LIST_STATUS,
+                              NULL, 0,
+                              &args.out, sizeof(args.out));
+  *pending = args.out.pending;
+  *num_applied = args.out.num_applied;
+  return status;
+}
+
+}  // namespace RPCStubs
+
+}  // namespace DuinoCube
+
+#endif  // __DUINOCUBE_RPC_STUBS_H__
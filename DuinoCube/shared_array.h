@@ -0,0 +1,152 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube shared memory array for Arduino.
+
+#ifndef __DUINOCUBE_SHARED_ARRAY_H__
+#define __DUINOCUBE_SHARED_ARRAY_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include "mem.h"
+
+namespace DuinoCube {
+
+// Presents an array of |T| in shared memory as an indexable array, for data
+// that does not fit in Arduino RAM. A window of |WINDOW_SIZE| consecutive
+// elements is cached in Arduino RAM. When an element outside of the window is
+// accessed, the elements of the window that were changed are written back in
+// one burst, and the window that holds the element is read in one burst. Loops
+// over the array therefore move whole windows at a time.
+//
+// |T| must be a plain struct or type that can be copied byte by byte. The
+// shared memory is not read or written by anything else while it is cached,
+// unless the array is flushed or invalidated first.
+//
+// Elements at or past size() are not in shared memory. They read as zeroes, and
+// changes to them are dropped.
+template <typename T, uint8_t WINDOW_SIZE = 16>
+class SharedArray {
+ public:
+  SharedArray() : addr_(0), size_(0), window_start_(0), window_size_(0),
+                  dirty_begin_(0), dirty_end_(0) {}
+
+  // Uses |size| elements at shared memory address |addr|, e.g. from
+  // Mem::alloc(size * sizeof(T)).
+  void begin(uint16_t addr, uint16_t size) {
+    flush();
+    addr_ = addr;
+    size_ = size;
+    window_size_ = 0;
+  }
+
+  // Writes back changes and stops using the shared memory.
+  void end() {
+    flush();
+    addr_ = 0;
+    size_ = 0;
+    window_size_ = 0;
+  }
+
+  uint16_t size() const { return size_; }
+
+  // Returns a reference to element |index|, which stays valid until another
+  // element outside of the window is accessed. The element is assumed to be
+  // changed, so use get() for elements that are only read.
+  T& operator[](uint16_t index) {
+    uint8_t offset = load(index);
+    if (offset == WINDOW_SIZE)    // Out of range, nothing to write back.
+      return window_[offset];
+    if (dirty_begin_ == dirty_end_) {
+      dirty_begin_ = offset;
+      dirty_end_ = offset + 1;
+    } else if (offset < dirty_begin_) {
+      dirty_begin_ = offset;
+    } else if (offset >= dirty_end_) {
+      dirty_end_ = offset + 1;
+    }
+    return window_[offset];
+  }
+
+  // Returns element |index| without marking it as changed.
+  const T& get(uint16_t index) {
+    return window_[load(index)];
+  }
+
+  void set(uint16_t index, const T& value) {
+    (*this)[index] = value;
+  }
+
+  // Writes back the elements that have been changed since the last flush, as
+  // one burst that spans all of them.
+  void flush() {
+    if (dirty_begin_ == dirty_end_)
+      return;
+    Mem::write(addr_ + (window_start_ + dirty_begin_) * sizeof(T),
+               window_ + dirty_begin_,
+               (dirty_end_ - dirty_begin_) * sizeof(T));
+    dirty_begin_ = 0;
+    dirty_end_ = 0;
+  }
+
+  // Drops the cached window without writing it back, e.g. after the
+  // coprocessor has changed the data.
+  void invalidate() {
+    window_size_ = 0;
+    dirty_begin_ = 0;
+    dirty_end_ = 0;
+  }
+
+ private:
+  // Makes sure that element |index| is in the window, and returns its offset
+  // in the window. Returns WINDOW_SIZE, the offset of a zeroed scratch element,
+  // if |index| is out of range.
+  uint8_t load(uint16_t index) {
+    if (index >= size_) {
+      memset(&window_[WINDOW_SIZE], 0, sizeof(T));
+      return WINDOW_SIZE;
+    }
+    if ((uint16_t)(index - window_start_) < window_size_)
+      return index - window_start_;
+
+    flush();
+    window_start_ = index - index % WINDOW_SIZE;
+    window_size_ = WINDOW_SIZE;
+    if (window_start_ + window_size_ > size_)
+      window_size_ = size_ - window_start_;
+    Mem::read(addr_ + window_start_ * sizeof(T), window_,
+              window_size_ * sizeof(T));
+    return index - window_start_;
+  }
+
+  uint16_t addr_;           // Location and number of elements of the array.
+  uint16_t size_;
+
+  // Cached elements, followed by the scratch element for out of range indices.
+  T window_[WINDOW_SIZE + 1];
+  uint16_t window_start_;   // Index of the first cached element.
+  uint8_t window_size_;     // Number of cached elements, 0 if none.
+
+  // Range of offsets in the window that have been changed.
+  uint8_t dirty_begin_;
+  uint8_t dirty_end_;
+};
+
+}  // namespace DuinoCube
+
+#endif  // __DUINOCUBE_SHARED_ARRAY_H__
@@ -0,0 +1,69 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube state snapshot file format.
+//
+// RPC_CMD_SNAPSHOT and the boot menu save the Core's memory and the shared
+// memory to a file on the SD card, for debugging on a host. All values are
+// little endian. A snapshot file consists of:
+//   - A SnapshotHeader.
+//   - |num_sections| SnapshotSection entries.
+//   - The data of each section, in the same order, back to back.
+//
+// Each section is a range of the extended address space of xaddr.h, so that
+// host tools can tell what the data is without knowing how it was captured.
+// The firmware saves these sections:
+//   - Shared memory, XADDR_SHMEM(0), SHARED_MEMORY_SIZE bytes.
+//   - Core registers, palettes, sprites and collision registers, XADDR_CORE(0),
+//     XADDR_CORE_SIZE bytes.
+//   - The tile map bank followed by all VRAM banks, XADDR_TILEMAP(0),
+//     SNAPSHOT_BANKS_SIZE bytes.
+// Core registers are saved as the client had set them, even though the Core
+// memory bank and VRAM access registers change while the banks are saved.
+//
+// The CRC of each section matches zlib's crc32() and utils/crc32, e.g.
+//   crc32 -o <data offset> -n <size> <snapshot file>
+
+#ifndef __DUINOCUBE_SNAPSHOT_H__
+#define __DUINOCUBE_SNAPSHOT_H__
+
+#include <stdint.h>
+
+#include "xaddr.h"
+
+#define SNAPSHOT_MAGIC          0x53504e53UL    // "SNPS"
+#define SNAPSHOT_VERSION        1
+
+#define SNAPSHOT_NUM_SECTIONS   3
+
+// Size of the tile map and VRAM banks, which are saved as one section.
+#define SNAPSHOT_BANKS_SIZE     \
+    ((uint32_t)(XADDR_BANK_END - XADDR_BANK_FIRST) * XADDR_BANK_SIZE)
+
+struct SnapshotHeader {
+  uint32_t magic;               // SNAPSHOT_MAGIC.
+  uint16_t version;             // SNAPSHOT_VERSION.
+  uint16_t num_sections;        // Number of sections that follow.
+};
+
+struct SnapshotSection {
+  uint32_t addr;                // Extended address of the data.
+  uint32_t size;                // Size of the data in bytes.
+  uint32_t crc;                 // CRC-32 of the data.
+};
+
+#endif  // __DUINOCUBE_SNAPSHOT_H__
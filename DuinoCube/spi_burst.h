@@ -0,0 +1,85 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube burst SPI transfers.
+//
+// SPI.transfer() waits for each byte to finish before it returns, so the call
+// and loop overhead leave the bus idle in between bytes. These functions keep
+// the next byte ready in a register, so that it is loaded into SPDR as soon as
+// SPIF is set. At SPI_CLOCK_DIV2, a byte takes 16 cycles to shift out, which is
+// enough to hide the rest of the loop, so it is not unrolled.
+//
+// The caller must have selected the SPI device.
+
+#ifndef __DUINOCUBE_SPI_BURST_H__
+#define __DUINOCUBE_SPI_BURST_H__
+
+#include <Arduino.h>
+
+namespace DuinoCube {
+
+// Sends |size| bytes from |data|. The received bytes are ignored.
+inline void spiBurstWrite(const void* data, uint16_t size) {
+  if (size == 0)
+    return;
+  const uint8_t* buf = static_cast<const uint8_t*>(data);
+  SPDR = *buf++;
+  while (--size > 0) {
+    uint8_t value = *buf++;
+    while (!(SPSR & (1 << SPIF)));
+    SPDR = value;
+  }
+  while (!(SPSR & (1 << SPIF)));
+}
+
+// Sends |size| bytes of the 16-bit pattern |value|, low byte first.
+inline void spiBurstFill(uint16_t value, uint16_t size) {
+  if (size == 0)
+    return;
+  uint8_t bytes[] = { (uint8_t) value, (uint8_t)(value >> 8) };
+  uint8_t index = 0;
+  SPDR = bytes[0];
+  while (--size > 0) {
+    index ^= 1;
+    uint8_t byte = bytes[index];
+    while (!(SPSR & (1 << SPIF)));
+    SPDR = byte;
+  }
+  while (!(SPSR & (1 << SPIF)));
+}
+
+// Receives |size| bytes into |data|, sending zeroes.
+inline void spiBurstRead(void* data, uint16_t size) {
+  if (size == 0)
+    return;
+  uint8_t* buf = static_cast<uint8_t*>(data);
+  SPDR = 0;
+  while (--size > 0) {
+    // The received byte must be read out before the next one has been shifted
+    // in, so start the next byte right after reading it.
+    while (!(SPSR & (1 << SPIF)));
+    uint8_t value = SPDR;
+    SPDR = 0;
+    *buf++ = value;
+  }
+  while (!(SPSR & (1 << SPIF)));
+  *buf = SPDR;
+}
+
+}  // namespace DuinoCube
+
+#endif  // __DUINOCUBE_SPI_BURST_H__
@@ -35,7 +35,9 @@ GamepadState USB::readJoystick() {
   GamepadState state;
 
   RPC_UsbReadJoystickArgs args;
-  rpc.exec(RPC_CMD_USB_READ_JOYSTICK, NULL, 0, &args.out, sizeof(args.out));
+  // Use the priority lane so that input is not held up by long file reads.
+  rpc.execPriority(RPC_CMD_USB_READ_JOYSTICK,
+                   NULL, 0, &args.out, sizeof(args.out));
 
   state.buttons = args.out.buttons;
   state.x = args.out.x;
@@ -0,0 +1,68 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube coprocessor script VM library for Arduino.
+
+#include "vm.h"
+
+#include "rpc.h"
+#include "rpc_stubs.h"
+
+namespace DuinoCube {
+
+static RPC rpc;
+
+uint16_t VM::run(uint16_t addr, uint16_t size, uint16_t data_addr,
+                 uint16_t* error, uint16_t* pc) {
+  uint16_t result_error;
+  uint16_t result_pc;
+  uint16_t num_steps;
+  uint16_t status = RPCStubs::vmRun(addr, size, data_addr, 0,
+                                    &result_error, &result_pc, &num_steps);
+  if (error)
+    *error = result_error;
+  if (pc)
+    *pc = result_pc;
+  return status;
+}
+
+uint16_t VM::start(uint16_t addr, uint16_t size, uint16_t data_addr,
+                   uint16_t mode, uint16_t max_steps) {
+  return RPCStubs::vmStart(addr, size, data_addr, max_steps, mode);
+}
+
+void VM::stop() {
+  // Use the priority lane so that the script is stopped even while the server
+  // is busy with long commands.
+  rpc.execPriority(RPC_CMD_VM_STOP, NULL, 0, NULL, 0);
+}
+
+uint16_t VM::getStatus(uint16_t* num_runs, uint16_t* error, uint16_t* pc) {
+  RPC_VmStatusArgs args;
+  args.out.mode = VM_MODE_STOPPED;
+  rpc.execPriority(RPC_CMD_VM_STATUS, NULL, 0, &args.out, sizeof(args.out));
+
+  if (num_runs)
+    *num_runs = args.out.num_runs;
+  if (error)
+    *error = args.out.error;
+  if (pc)
+    *pc = args.out.pc;
+  return args.out.mode;
+}
+
+}  // namespace DuinoCube
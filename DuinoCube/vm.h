@@ -0,0 +1,64 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube coprocessor script VM library for Arduino.
+
+#ifndef __DUINOCUBE_VM_H__
+#define __DUINOCUBE_VM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vm_defs.h"
+
+namespace DuinoCube {
+
+// Runs bytecode scripts on the coprocessor. A script is copied to shared
+// memory, e.g. with Mem::write(), and then run from there. See vm_defs.h for
+// the instruction set.
+class VM {
+ public:
+  // Runs the |size|-byte script at shared memory address |addr| once, and
+  // waits for it to end. r1 starts out as |data_addr|. Returns an
+  // RPC_STATUS_* code, which is RPC_STATUS_FAILED if the script failed. The
+  // VM_ERROR_* code and the offset of the last instruction that was run are
+  // stored in |error| and |pc|, if they are not NULL.
+  static uint16_t run(uint16_t addr, uint16_t size, uint16_t data_addr,
+                      uint16_t* error = NULL, uint16_t* pc = NULL);
+
+  // Starts running a script in the background, replacing any script that is
+  // already running. |mode| is VM_MODE_IDLE to run it whenever the
+  // coprocessor is idle, or VM_MODE_VBLANK to run it at the start of each
+  // vertical blank. Each run starts from the beginning of the script, and may
+  // run at most |max_steps| instructions. Returns an RPC_STATUS_* code.
+  static uint16_t start(uint16_t addr, uint16_t size, uint16_t data_addr,
+                        uint16_t mode, uint16_t max_steps = 0);
+
+  // Stops the background script.
+  static void stop();
+
+  // Returns the VM_MODE_* of the background script. It is VM_MODE_STOPPED
+  // once the script has failed. The number of runs, and the VM_ERROR_* code
+  // and last instruction offset of the last run are stored in |num_runs|,
+  // |error| and |pc|, if they are not NULL.
+  static uint16_t getStatus(uint16_t* num_runs = NULL, uint16_t* error = NULL,
+                            uint16_t* pc = NULL);
+};
+
+}  // namespace DuinoCube
+
+#endif  // __DUINOCUBE_VM_H__
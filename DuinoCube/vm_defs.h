@@ -0,0 +1,111 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube coprocessor script VM definitions.
+//
+// Scripts are sequences of bytecode instructions in shared memory, which the
+// coprocessor runs on behalf of the client, e.g. once per frame. They let a
+// sketch move repetitive per-object updates to the coprocessor, which has
+// direct access to shared memory and the Core.
+//
+// Every instruction is four bytes long:
+//   byte 0     Opcode, VM_OP_*.
+//   byte 1     Register operands: |rd| in the upper four bits and |rs| in the
+//              lower four bits.
+//   bytes 2-3  16-bit immediate value, little endian.
+//
+// There are VM_NUM_REGS 16-bit registers. Instructions that name a register past
+// them are invalid. r0 always reads as zero, and writes to it are discarded. r1
+// is set to the script's data address at the start of each run. All other
+// registers start out as zero.
+//
+// Most instructions operate on rd and an operand value B = rs + imm. Because r0
+// is zero, B can be a register (imm = 0), an immediate value (rs = r0) or a
+// register plus an offset. Jump targets are byte offsets from the start of the
+// script, and must be a multiple of VM_INSTR_SIZE.
+//
+// utils/vmasm assembles scripts from text, and utils/vmrun runs them on Linux
+// with the same interpreter as the firmware.
+
+#ifndef __DUINOCUBE_VM_DEFS_H__
+#define __DUINOCUBE_VM_DEFS_H__
+
+#include <stdint.h>
+
+#define VM_INSTR_SIZE           4
+#define VM_NUM_REGS             8
+
+// Number of instructions that a script may run before it is stopped, if the
+// client does not specify a limit.
+#define VM_DEFAULT_MAX_STEPS 1024
+
+// Script opcodes.
+enum {
+  VM_OP_END = 0x00,     // Ends the current run of the script.
+
+  // Arithmetic and logic: rd = rd <op> B.
+  VM_OP_MOV = 0x01,     // rd = B.
+  VM_OP_ADD,
+  VM_OP_SUB,
+  VM_OP_MUL,
+  VM_OP_AND,
+  VM_OP_OR,
+  VM_OP_XOR,
+  VM_OP_SHL,
+  VM_OP_SHR,            // Logical shift right.
+  VM_OP_SLT,            // rd = (rd < B) ? 1 : 0, signed.
+
+  // Shared memory access, at address B.
+  VM_OP_LD = 0x10,      // Load 16-bit word into rd.
+  VM_OP_LDB,            // Load byte into rd.
+  VM_OP_ST,             // Store rd as a 16-bit word.
+  VM_OP_STB,            // Store lower byte of rd.
+
+  // Core memory and register access, at Core address B.
+  VM_OP_CLD = 0x18,     // Load 16-bit word into rd.
+  VM_OP_CST,            // Store rd as a 16-bit word.
+
+  // Flow control. The target is imm, except for VM_OP_JMP.
+  VM_OP_JMP = 0x20,     // Jump to B.
+  VM_OP_JZ,             // Jump if rd is zero.
+  VM_OP_JNZ,            // Jump if rd is not zero.
+  VM_OP_DJNZ,           // Decrement rd, and jump if it is not zero.
+};
+
+// Builds the bytes of an instruction, for scripts embedded in a sketch.
+#define VM_INSTR(op, rd, rs, imm) \
+    (op), (((rd) << 4) | (rs)), ((imm) & 0xff), (((imm) >> 8) & 0xff)
+
+// Ways to run a script in the background.
+enum {
+  VM_MODE_STOPPED,      // No script is running.
+  VM_MODE_IDLE,         // Run whenever the coprocessor is idle.
+  VM_MODE_VBLANK,       // Run once at the start of each vertical blank.
+};
+
+// Reasons that a script was stopped.
+enum {
+  VM_ERROR_NONE,
+  VM_ERROR_INVALID_OP,      // Unknown opcode, or register out of range.
+  VM_ERROR_BAD_JUMP,        // Ran past the end of the script, or jumped to an
+                            // invalid target.
+  VM_ERROR_BAD_ADDRESS,     // Memory access outside of shared memory, or
+                            // outside of the Core address space.
+  VM_ERROR_STEP_LIMIT,      // Ran too many instructions.
+};
+
+#endif  // __DUINOCUBE_VM_DEFS_H__
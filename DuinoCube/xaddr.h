@@ -0,0 +1,68 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube extended 24-bit address space.
+//
+// RPC commands that move data around, such as RPC_CMD_COPY and RPC_CMD_FILL,
+// take 24-bit addresses that cover all of the memory that the coprocessor can
+// reach, so that the client does not have to switch Core memory banks or
+// enable VRAM access itself.
+
+#ifndef __DUINOCUBE_XADDR_H__
+#define __DUINOCUBE_XADDR_H__
+
+#include <stdint.h>
+
+#include "core_defs.h"
+#include "mem.h"
+
+// Shared memory, SHARED_MEMORY_SIZE bytes.
+#define XADDR_SHMEM_BASE          0x000000UL
+
+// The part of the Core address space that is not banked: registers, palettes,
+// sprites and collision registers, at Core addresses 0 to VRAM_BASE.
+#define XADDR_CORE_BASE           0x010000UL
+#define XADDR_CORE_SIZE           VRAM_BASE
+
+// Core memory banks, which are mapped at Core address VRAM_BASE one at a time.
+// Bank TILEMAP_BANK holds the tile maps, followed by the VRAM banks. The VRAM
+// banks are contiguous, so a VRAM offset maps directly to an address.
+#define XADDR_BANK_BASE           0x100000UL
+#define XADDR_BANK_SIZE           VRAM_BANK_SIZE
+#define XADDR_BANK_FIRST          TILEMAP_BANK
+#define XADDR_BANK_END            VRAM_BANK_END
+
+// SPI flash, which holds the FPGA configuration. It can only be read.
+#define XADDR_FLASH_BASE          0x200000UL
+#define XADDR_FLASH_SIZE          0x200000UL
+
+// Address of shared memory address |addr|.
+#define XADDR_SHMEM(addr)         (XADDR_SHMEM_BASE + (addr))
+// Address of Core address |addr|, below VRAM_BASE.
+#define XADDR_CORE(addr)          (XADDR_CORE_BASE + (addr))
+// Address of |offset| in Core memory bank |bank|.
+#define XADDR_BANK(bank, offset)  \
+    (XADDR_BANK_BASE + (uint32_t)(bank) * XADDR_BANK_SIZE + (offset))
+// Address of tile map |index|.
+#define XADDR_TILEMAP(index)      \
+    XADDR_BANK(TILEMAP_BANK, TILEMAP(index) - VRAM_BASE)
+// Address of VRAM offset |offset|.
+#define XADDR_VRAM(offset)        XADDR_BANK(VRAM_BANK_BEGIN, offset)
+// Address of |offset| in the SPI flash.
+#define XADDR_FLASH(offset)       (XADDR_FLASH_BASE + (offset))
+
+#endif  // __DUINOCUBE_XADDR_H__
@@ -29,6 +29,7 @@
 #include "file.h"
 #include "isp.h"
 #include "printf.h"
+#include "snapshot.h"
 #include "usb.h"
 #include "utils.h"
 
@@ -80,6 +81,7 @@ enum {
   MENU_LOAD_PROGRAM,
   MENU_BURN_BOOTLOADER,
   MENU_UPDATE_FPGA,
+  MENU_SAVE_SNAPSHOT,
   NUM_MENU_OPTIONS,
 };
 
@@ -91,6 +93,7 @@ const char kMenuStrings[] PROGMEM = {
   "Load program\0"
   "Load bootloader\0"
   "Update FPGA\0"
+  "Save snapshot\0"
 };
 
 // Various message strings.
@@ -99,6 +102,14 @@ const char kFileOpenErrorText[] PROGMEM = "Could not open file.";
 const char kNotSupportedText[] PROGMEM = "Operation not yet supported.";
 const char kProgrammingText[] PROGMEM = "Starting programming operation.";
 const char kDoneText[] PROGMEM = "Done!";
+const char kSavingSnapshotText[] PROGMEM = "Saving snapshot...";
+const char kSnapshotErrorText[] PROGMEM = "Could not save snapshot.";
+
+// Snapshots are saved to the first of these that does not exist yet, where the
+// digits are replaced with 00 to 99.
+static const char kSnapshotFilename[] PROGMEM = "snap00.dcs";
+#define SNAPSHOT_FILENAME_DIGITS    4   // Index of the first digit.
+#define MAX_SNAPSHOT_FILES        100
 
 // Store the length of the last status message so we know how much to erase.
 static uint16_t last_status_message_len;
@@ -257,6 +268,29 @@ void program_file(uint16_t menu_index, const char* filename) {
   }
 }
 
+// Saves a snapshot of the Core and shared memory to a new file.
+static void save_snapshot() {
+  char filename[MAX_FILENAME_SIZE];
+  strcpy_P(filename, kSnapshotFilename);
+
+  FILINFO file_info;
+  uint8_t index = 0;
+  while (f_stat(filename, &file_info) == FR_OK) {
+    if (++index == MAX_SNAPSHOT_FILES) {
+      display_status(kSnapshotErrorText, true);
+      return;
+    }
+    filename[SNAPSHOT_FILENAME_DIGITS] = '0' + index / 10;
+    filename[SNAPSHOT_FILENAME_DIGITS + 1] = '0' + index % 10;
+  }
+
+  display_status(kSavingSnapshotText, true);
+  if (snapshot_save(filename, NULL) == SNAPSHOT_OK)
+    display_status(filename, false);
+  else
+    display_status(kSnapshotErrorText, true);
+}
+
 // Get the user to select a file from the file system.
 // |menu_index| indicates the menu option that was chosen before.
 static uint16_t run_file_operation(uint16_t menu_index) {
@@ -348,6 +382,8 @@ bool boot_mode_enabled() {
  * Load program -> select file -> ask for y/n -> program -> back to menu
  * Burn bootloader -> select file -> ask for y/n -> program -> back to menu
  * Update FPGA -> select file -> ask for y/n -> program -> back to menu
+ * Save snapshot -> save the Core and shared memory to a new file -> back to
+ *                  menu
  *
  */
 
@@ -408,6 +444,9 @@ void boot_run() {
       case MENU_RUN_PROGRAM:
         boot_done = true;
         break;
+      case MENU_SAVE_SNAPSHOT:
+        save_snapshot();
+        break;
       case MENU_LOAD_PROGRAM:
       case MENU_BURN_BOOTLOADER:
       case MENU_UPDATE_FPGA:
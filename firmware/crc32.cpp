@@ -0,0 +1,43 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// CRC-32 checksums.
+
+#include <avr/pgmspace.h>
+
+#include "crc32.h"
+
+// Reflected CRC-32 polynomial 0x04c11db7, processed four bits at a time. A
+// 16-entry table is much smaller than the usual 256-entry one, and still
+// several times faster than working bit by bit.
+static const uint32_t crc32_table[16] PROGMEM = {
+  0x00000000UL, 0x1db71064UL, 0x3b6e20c8UL, 0x26d930acUL,
+  0x76dc4190UL, 0x6b6b51f4UL, 0x4db26158UL, 0x5005713cUL,
+  0xedb88320UL, 0xf00f9344UL, 0xd6d6a3e8UL, 0xcb61b38cUL,
+  0x9b64c2b0UL, 0x86d3d2d4UL, 0xa00ae278UL, 0xbdbdf21cUL,
+};
+
+uint32_t crc32_update(uint32_t crc, const void* data, uint16_t size) {
+  const uint8_t* bytes = (const uint8_t*) data;
+  crc = ~crc;
+  for (uint16_t i = 0; i < size; ++i) {
+    crc ^= bytes[i];
+    crc = (crc >> 4) ^ pgm_read_dword(&crc32_table[crc & 0x0f]);
+    crc = (crc >> 4) ^ pgm_read_dword(&crc32_table[crc & 0x0f]);
+  }
+  return ~crc;
+}
@@ -0,0 +1,32 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// CRC-32 checksums, using the same polynomial and conventions as zlib's
+// crc32(), so that utils/crc32 and other host tools compute matching values.
+
+#ifndef __CRC32_H__
+#define __CRC32_H__
+
+#include <stdint.h>
+
+// Value to start a CRC computation with.
+#define CRC32_INIT      0
+
+// Returns the CRC of |size| bytes at |data| appended to data with CRC |crc|.
+uint32_t crc32_update(uint32_t crc, const void* data, uint16_t size);
+
+#endif  // __CRC32_H__
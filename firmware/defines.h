@@ -24,6 +24,8 @@
 
 // Port B bit definitions.
 #define RPC_COMMAND_BIT            PORTB0
+#define RPC_COMMAND_PCINT          PCINT0     // Pin change interrupt of the
+                                              // RPC command pin.
 #define RPC_STATUS_BIT             PORTB1
 
 // Port C bit definitions.
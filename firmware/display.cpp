@@ -24,11 +24,13 @@
 #include "DuinoCube/core.h"
 #include "DuinoCube/core_defs.h"
 #include "DuinoCube/mem.h"
+#include "DuinoCube/xaddr.h"
 #include "FatFS/ff.h"
 #include "file.h"
 #include "font.h"
 #include "printf.h"
 #include "shmem.h"
+#include "xmem.h"
 
 // Track resource usage.
 static struct {
@@ -73,6 +75,27 @@ static void core_write_data(uint16_t addr, const void* data, uint16_t size) {
 static void core_write_word(uint16_t addr, uint16_t value) {
   shmem_write(CORE_TO_SHMEM_ADDR(addr), &value, sizeof(value));
 }
+static void core_fill(uint16_t addr, uint16_t value, uint16_t size) {
+  shmem_fill(CORE_TO_SHMEM_ADDR(addr), value, size);
+}
+
+// Writes |size| bytes to VRAM at |vram_offset|, splitting the write where it
+// crosses into the next bank. Must be called between xmem_begin() and
+// xmem_end(), which select banks and VRAM access only when they change.
+static void vram_write(uint32_t vram_offset, const void* data, uint16_t size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  while (size > 0) {
+    uint32_t addr = XADDR_VRAM(vram_offset);
+    uint16_t chunk = size;
+    uint32_t span = xmem_get_span(addr, true);
+    if (span < chunk)
+      chunk = span;
+    xmem_write(addr, bytes, chunk);
+    bytes += chunk;
+    vram_offset += chunk;
+    size -= chunk;
+  }
+}
 
 // Convert text coordinates to a tilemap memory offset.
 static inline uint16_t get_text_addr(uint8_t x, uint8_t y) {
@@ -85,11 +108,7 @@ void display_init() {
 
   // Reset all sprites.
   // Sprite registers are in memory and aren't accessible by the reset signal.
-  uint16_t buf[NUM_SPRITE_REGS];
-  memset(buf, 0, sizeof(buf));
-  for (uint16_t sprite = 0; sprite < NUM_SPRITES; ++sprite) {
-    core_write_data(SPRITE_REG(sprite, 0), buf, sizeof(buf));
-  }
+  core_fill(SPRITE_BASE, 0, NUM_SPRITES * NUM_SPRITE_REGS * sizeof(uint16_t));
 }
 
 void display_bg_init(uint8_t layer, uint8_t palette) {
@@ -122,34 +141,21 @@ void display_bg_load_image(const char* filename,
   g_bg_params.vram_offset = g_vram_used;
   g_vram_used += size;
 
-  // Enable VRAM access.
-  core_write_word(REG_SYS_CTRL, (1 << REG_SYS_CTRL_VRAM_ACCESS));
-
-  // Point memory bank register to the proper bank in VRAM.
-  // This code assumes that everything up to this point is properly aligned.
-  uint16_t vram_bank_offset = GET_VRAM_BANK_OFFSET(g_bg_params.vram_offset);
-  uint16_t vram_bank = GET_VRAM_BANK(g_bg_params.vram_offset);
-  core_write_word(REG_MEM_BANK, vram_bank);
-
+  xmem_begin();
   uint16_t size_read = 0;
   for (uint32_t offset = 0; offset < size; offset += size_read) {
     size_read = file_read(handle, buf, sizeof(buf));
-    core_write_data(VRAM_BASE + vram_bank_offset, buf, size_read);
-    vram_bank_offset += size_read;
-    // Check for end of VRAM bank. Update to the next bank if necessary.
-    if (vram_bank_offset >= VRAM_BANK_SIZE) {
-      vram_bank_offset -= VRAM_BANK_SIZE;
-      ++vram_bank;
-      core_write_word(REG_MEM_BANK, vram_bank);
-    }
+    if (size_read == 0)
+      break;
+    vram_write(g_bg_params.vram_offset + offset, buf, size_read);
   }
+  xmem_end();
   file_close(handle);
 
-  // Disable VRAM access.
-  core_write_word(REG_SYS_CTRL, (0 << REG_SYS_CTRL_VRAM_ACCESS));
-
   // Now set up the image as a tilemap.
-  // Think of it as reassembling the tiles into the original image.
+  // Think of it as reassembling the tiles into the original image. xmem_end()
+  // restored the VRAM access bit, but the tilemap bank needs it to be off.
+  core_write_word(REG_SYS_CTRL, (0 << REG_SYS_CTRL_VRAM_ACCESS));
   core_write_word(REG_MEM_BANK, TILEMAP_BANK);
   uint16_t tile_index = 0;
   uint16_t* tilemap_buf = reinterpret_cast<uint16_t*>(buf);
@@ -218,26 +224,23 @@ void display_text_init(uint8_t layer, uint8_t palette) {
   uint8_t buf[FONT_CHAR_SIZE];
 
   // Load font.
-  core_write_word(REG_SYS_CTRL, (1 << REG_SYS_CTRL_VRAM_ACCESS));
-  core_write_word(REG_MEM_BANK, VRAM_BANK_BEGIN);
-  uint16_t offset = VRAM_BASE;
+  xmem_begin();
+  uint32_t offset = g_text_params.vram_offset;
   for (uint8_t ch = 0; ch < MAX_FONT_CHARS; ++ch) {
     // Load each character's bitmap individually.
     font_load_bitmap(ch, buf, WHITE_INDEX, BLACK_INDEX);
-    core_write_data(offset, buf, FONT_CHAR_SIZE);
+    vram_write(offset, buf, FONT_CHAR_SIZE);
     offset += FONT_CHAR_SIZE;
   }
-  core_write_word(REG_SYS_CTRL, (0 << REG_SYS_CTRL_VRAM_ACCESS));
+  xmem_end();
 
   // Set up palette.
   core_write_data(PALETTE(palette), kPaletteColors, sizeof(kPaletteColors));
 
-  // Clear tilemap of the text layer.
-  memset(buf, 0, sizeof(buf));
+  // Clear tilemap of the text layer, which needs VRAM access to be off.
+  core_write_word(REG_SYS_CTRL, (0 << REG_SYS_CTRL_VRAM_ACCESS));
   core_write_word(REG_MEM_BANK, TILEMAP_BANK);
-  for (uint16_t offset = 0; offset < TILEMAP_SIZE; offset += sizeof(buf)) {
-    core_write_data(g_text_params.tilemap_addr + offset, buf, sizeof(buf));
-  }
+  core_fill(g_text_params.tilemap_addr, 0, TILEMAP_SIZE);
 
   // Enable the tile layer.
   core_write_word(TILE_LAYER_REG(layer, TILE_CTRL_0),
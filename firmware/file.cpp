@@ -132,7 +132,7 @@ const char file_write_str0[] PROGMEM =
 uint16_t file_write(uint16_t handle, const void* src, uint16_t size) {
   FIL* file = (FIL*) handle;
   int index = get_handle_index(file);
-  if (index < 0 || file_handle_active[index])
+  if (index < 0 || !file_handle_active[index])
     return 0;
 
   UINT size_written;
@@ -123,15 +123,13 @@ static uint8_t read_status_reg() {
 }
 
 // Read data.
-static void read_data(uint32_t offset, char* buf, uint32_t size) {
+static void read_data(uint32_t offset, char* buf, uint16_t size) {
   start_command(COMMAND_READ_DATA);
   write_address(offset);
 
   // The file data bit order is reversed.
   spi_set_bit_order(SPI_LSB_FIRST);
-  for (; size > 0; --size, ++buf) {
-    *buf = spi_tx(0);
-  }
+  spi_read(buf, size);
   spi_set_bit_order(SPI_MSB_FIRST);
 
   end_command();
@@ -147,9 +145,7 @@ static void page_program(uint32_t offset, const char* buf, uint16_t size) {
 
   // The file data bit order is reversed.
   spi_set_bit_order(SPI_LSB_FIRST);
-  for (; size > 0; --size, ++buf) {
-    spi_tx(*buf);
-  }
+  spi_write(buf, size);
   spi_set_bit_order(SPI_MSB_FIRST);
 
   end_command();
@@ -187,6 +183,10 @@ void flash_init() {
   FLASH_DDR |= (1 << FLASH_SELECT_BIT);
 }
 
+void flash_read(uint32_t offset, void* buf, uint16_t size) {
+  read_data(offset, static_cast<char*>(buf), size);
+}
+
 uint16_t flash_reprogram(uint16_t handle) {
   // Determine file size.
   uint32_t data_size = file_size(handle);
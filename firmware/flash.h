@@ -35,6 +35,9 @@
 // Initializes flash interface.
 void flash_init();
 
+// Reads |size| bytes of flash data starting at |offset|, in file bit order.
+void flash_read(uint32_t offset, void* buf, uint16_t size);
+
 // Re-programs flash with data from a file handle.
 uint16_t flash_reprogram(uint16_t handle);
 
@@ -19,30 +19,69 @@
 
 #include <string.h>
 
+#include <avr/interrupt.h>
+
 #include "DuinoCube/rpc.h"
-#include "DuinoCube/rpc_file.h"
-#include "DuinoCube/rpc_mem.h"
-#include "DuinoCube/rpc_usb.h"
+#include "DuinoCube/rpc_batch.h"
+#include "DuinoCube/rpc_stats.h"
 
 #include "defines.h"
 #include "printf.h"
-#include "rpc_file.h"
-#include "rpc_mem.h"
-#include "rpc_usb.h"
+#include "rpc_core.h"
+#include "rpc_dispatch.h"
+#include "rpc_stats.h"
+#include "rpc_vm.h"
 #include "shmem.h"
 #include "spi.h"
+#include "timer.h"
 #include "usb.h"
 
 #include "rpc.h"
 
-// Reads the command code issued by the RPC client.
-static uint8_t read_client_command() {
-  uint8_t command_pin_value = (PINB >> RPC_COMMAND_BIT) & 1;
-  if (command_pin_value == RPC_CLIENT_NO_COMMAND)
-    return RPC_CMD_NONE;
-  uint8_t command;
-  shmem_read(RPC_COMMAND_ADDR, &command, sizeof(command));
-  return command;
+// Number of commands that have been latched but not yet completed. There is
+// one slot for each.
+static volatile uint8_t num_queued;
+// Set while the server is ready to latch another command from the RPC client,
+// i.e. while the server status is idle.
+static volatile bool ready;
+// Time at which the last command was latched, in microseconds.
+static volatile uint32_t command_time;
+// Number of commands completed, for the client to track submitted commands.
+// The command being executed has ticket get_current_ticket(). Both wrap around
+// at RPC_TICKET_PERIOD.
+static uint16_t num_completed;
+
+static uint16_t get_current_ticket() {
+  return (num_completed + 1) % RPC_TICKET_PERIOD;
+}
+
+// Clears the cancel word, once the cancel it holds has been acted on or has
+// become stale.
+static void clear_cancel_ticket() {
+  uint16_t cancel_ticket = RPC_NO_TICKET;
+  shmem_write(RPC_CANCEL_ADDR, &cancel_ticket, sizeof(cancel_ticket));
+}
+
+// Returns true if the RPC client is asserting the command pin.
+static bool client_command_issued() {
+  return ((PINB >> RPC_COMMAND_BIT) & 1) == RPC_CLIENT_COMMAND;
+}
+
+// Reads the command frame issued by the RPC client in |slot|.
+static void read_client_command(uint8_t slot, RPC_Frame* frame) {
+  shmem_read(RPC_FRAME_ADDR(slot), frame, sizeof(*frame));
+}
+
+// Input args of the command being executed, and where its output args go.
+static const uint8_t* exec_args;
+static uint16_t exec_out_addr;
+
+void rpc_read_args(void* args, uint8_t size) {
+  memcpy(args, exec_args, size);
+}
+
+void rpc_write_args(const void* args, uint8_t size) {
+  shmem_write(exec_out_addr, args, size);
 }
 
 // Write an RPC server status code for the RPC client to read.
@@ -60,92 +99,249 @@ static void set_server_status(uint8_t status) {
 const char rpc_hello_str0[] PROGMEM = "Hello world.";
 
 // Test function that writes a string to a buffer.
-static void rpc_hello(RPC_HelloArgs* args) {
+uint8_t rpc_hello() {
+  RPC_HelloArgs args;
+  rpc_read_args(&args.in, sizeof(args.in));
+
   char str[20];
   memset(str, 0, sizeof(str));
   for (size_t i = 0; i < sizeof(str) && pgm_read_byte(rpc_hello_str0[i]); ++i)
     str[i] = pgm_read_byte(rpc_hello_str0 + i);
-  shmem_write(args->in.buf_addr, str, sizeof(str));
+  shmem_write(args.in.buf_addr, str, sizeof(str));
+  // No outputs to write.
+  return RPC_STATUS_OK;
 }
 
 // Test function that inverts a buffer.
-static void rpc_invert(RPC_InvertArgs* args) {
+uint8_t rpc_invert() {
+  RPC_InvertArgs args;
+  rpc_read_args(&args.in, sizeof(args.in));
+
   char buf[256];
-  shmem_read(args->in.buf_addr, buf, args->in.size);
-  for (uint16_t offset = 0; offset < args->in.size; ++offset)
+  if (args.in.size > sizeof(buf))
+    return RPC_STATUS_INVALID_ARGS;
+  shmem_read(args.in.buf_addr, buf, args.in.size);
+  for (uint16_t offset = 0; offset < args.in.size; ++offset)
     buf[offset] = ~buf[offset];
-  shmem_write(args->in.buf_addr, buf, args->in.size);
+  shmem_write(args.in.buf_addr, buf, args.in.size);
+  rpc_stats_add_bytes(args.in.size);
+  // No outputs to write.
+  return RPC_STATUS_OK;
 }
 
-static void rpc_exec(uint8_t command) {
-  switch(command) {
-  case RPC_CMD_HELLO: {
-    RPC_HelloArgs hello;
-    shmem_read(RPC_INPUT_ARG_ADDR, &hello.in, sizeof(hello.in));
-    rpc_hello(&hello);
-    // No outputs to write.
-    break;
-  }
-  case RPC_CMD_INVERT: {
-    RPC_InvertArgs invert;
-    shmem_read(RPC_INPUT_ARG_ADDR, &invert.in, sizeof(invert.in));
-    rpc_invert(&invert);
-    // No outputs to write.
-    break;
-  }
-  case RPC_CMD_READ_CORE_ID: {
-    RPC_ReadCoreIDArgs args;
-    // TODO: add a macro to make it more clear that |SHARED_MEMORY_SIZE| is
-    // actually address 0 of the Core address space.
-    shmem_read(SHARED_MEMORY_SIZE, &args.out.id, sizeof(args.out.id));
-    shmem_write(RPC_OUTPUT_ARG_ADDR, &args.out, sizeof(args.out));
-    break;
+uint8_t rpc_read_core_id() {
+  RPC_ReadCoreIDArgs args;
+  // TODO: add a macro to make it more clear that |SHARED_MEMORY_SIZE| is
+  // actually address 0 of the Core address space.
+  shmem_read(SHARED_MEMORY_SIZE, &args.out.id, sizeof(args.out.id));
+  rpc_write_args(&args.out, sizeof(args.out));
+  return RPC_STATUS_OK;
+}
+
+static uint8_t rpc_exec(uint8_t command, const uint8_t* args,
+                        uint16_t out_addr);
+
+// Executes a list of commands in shared memory. Each command's outputs are
+// written directly into the list so that the client and later entries can read
+// them. Stops at the first command that does not succeed, and returns its
+// status.
+uint8_t rpc_batch() {
+  RPC_BatchArgs args;
+  rpc_read_args(&args.in, sizeof(args.in));
+
+  // Addresses and sizes of the output args of each entry, for resolving links.
+  uint16_t out_addrs[RPC_BATCH_MAX_ENTRIES];
+  uint8_t out_sizes[RPC_BATCH_MAX_ENTRIES];
+  uint8_t arg_buf[RPC_BATCH_MAX_ARG_SIZE];
+
+  uint8_t status = RPC_STATUS_OK;
+  uint16_t addr = args.in.list_addr;
+  uint16_t index;
+  for (index = 0;
+       index < args.in.num_entries && index < RPC_BATCH_MAX_ENTRIES;
+       ++index) {
+    // Check for cancellation in between commands.
+    if (index > 0 && rpc_yield()) {
+      status = RPC_STATUS_CANCELED;
+      break;
+    }
+
+    RPC_BatchEntry entry;
+    shmem_read(addr, &entry, sizeof(entry));
+    // Reject malformed entries, and do not allow batches to be nested.
+    if (entry.in_size > sizeof(arg_buf) || entry.out_size > sizeof(arg_buf) ||
+        entry.command == RPC_CMD_BATCH) {
+      status = RPC_STATUS_INVALID_ARGS;
+      break;
+    }
+    shmem_read(addr + sizeof(entry), arg_buf, entry.in_size);
+    out_addrs[index] = addr + sizeof(entry) + entry.in_size;
+    out_sizes[index] = entry.out_size;
+    addr = out_addrs[index] + entry.out_size;
+
+    if (entry.link_entry != RPC_BATCH_NO_LINK) {
+      // The linked value must lie within the earlier entry's output args and
+      // this entry's input args, both of which fit in |arg_buf|.
+      if (entry.link_entry >= index ||
+          entry.link_out_offset + RPC_BATCH_LINK_SIZE >
+              out_sizes[entry.link_entry] ||
+          entry.link_in_offset + RPC_BATCH_LINK_SIZE > entry.in_size) {
+        status = RPC_STATUS_INVALID_ARGS;
+        break;
+      }
+      uint16_t value;
+      shmem_read(out_addrs[entry.link_entry] + entry.link_out_offset,
+                 &value, sizeof(value));
+      // A zero value means the earlier command failed.
+      if (value == 0) {
+        status = RPC_STATUS_FAILED;
+        break;
+      }
+      memcpy(arg_buf + entry.link_in_offset, &value, sizeof(value));
+    }
+
+    status = rpc_exec(entry.command, arg_buf, out_addrs[index]);
+    if (status != RPC_STATUS_OK) {
+      // The command was executed, even if it did not succeed.
+      ++index;
+      break;
+    }
   }
-  case RPC_CMD_FILE_OPEN:
-    rpc_file_open();
-    break;
-  case RPC_CMD_FILE_CLOSE:
-    rpc_file_close();
-    break;
-  case RPC_CMD_FILE_READ:
-    rpc_file_read();
-    break;
-  case RPC_CMD_FILE_WRITE:
-    rpc_file_write();
-    break;
-  case RPC_CMD_FILE_SIZE:
-    rpc_file_size();
-    break;
-  case RPC_CMD_FILE_SEEK:
-    rpc_file_seek();
-    break;
+  args.out.num_executed = index;
 
-  case RPC_CMD_MEM_STAT:
-    rpc_mem_stat();
-    break;
-  case RPC_CMD_MEM_ALLOC:
-    rpc_mem_alloc();
-    break;
-  case RPC_CMD_MEM_FREE:
-    rpc_mem_free();
-    break;
+  rpc_write_args(&args.out, sizeof(args.out));
 
-  case RPC_CMD_USB_READ_JOYSTICK:
-    rpc_usb_read_joystick();
-    break;
+  return status;
+}
 
-  default:
-    // Handle unrecognized command.
-    break;
+// Executes |command| with input args |args|. The output args are written to
+// shared memory at |out_addr|. Returns an RPC_STATUS_* code.
+static uint8_t rpc_exec(uint8_t command, const uint8_t* args,
+                        uint16_t out_addr) {
+  uint32_t start_time = timer_get_us();
+
+  // Batched commands are executed from within a batch command, so restore the
+  // outer command's args when done.
+  const uint8_t* saved_args = exec_args;
+  uint16_t saved_out_addr = exec_out_addr;
+  exec_args = args;
+  exec_out_addr = out_addr;
+
+  RPC_Handler handler = rpc_get_handler(command);
+  uint8_t status = handler ? handler() : RPC_STATUS_INVALID_COMMAND;
+
+  exec_args = saved_args;
+  exec_out_addr = saved_out_addr;
+
+  // Commands in a batch are recorded individually. The batch command's own
+  // time includes theirs.
+  rpc_stats_update(command, timer_get_us() - start_time);
+
+  return status;
+}
+
+// Runs a command frame that the client has issued, unless the args did not fit
+// in it.
+static uint8_t rpc_exec_frame(const RPC_Frame* frame, uint16_t out_addr) {
+  if (frame->flags & RPC_FLAG_ARGS_TOO_LARGE)
+    return RPC_STATUS_INVALID_ARGS;
+  return rpc_exec(frame->command, frame->args, out_addr);
+}
+
+// Runs the command in the priority lane, if there is one.
+static void rpc_service_priority() {
+  RPC_Frame frame;
+  shmem_read(RPC_PRIORITY_FRAME_ADDR, &frame.command, sizeof(frame.command));
+  if (frame.command == RPC_CMD_NONE)
+    return;
+
+  shmem_read(RPC_PRIORITY_FRAME_ADDR, &frame, RPC_PRIORITY_FRAME_SIZE);
+  uint16_t status = RPC_STATUS_INVALID_COMMAND;
+  if (rpc_is_priority_command(frame.command))
+    status = rpc_exec_frame(&frame, RPC_PRIORITY_OUTPUT_ARG_ADDR);
+  shmem_write(RPC_PRIORITY_STATUS_ADDR, &status, sizeof(status));
+
+  // Let the client know that the command has completed.
+  frame.command = RPC_CMD_NONE;
+  shmem_write(RPC_PRIORITY_FRAME_ADDR, &frame.command, sizeof(frame.command));
+}
+
+bool rpc_yield() {
+  rpc_service_priority();
+  rpc_core_idle();
+
+  uint16_t cancel_ticket;
+  shmem_read(RPC_CANCEL_ADDR, &cancel_ticket, sizeof(cancel_ticket));
+  if (cancel_ticket != get_current_ticket())
+    return false;
+  clear_cancel_ticket();
+  return true;
+}
+
+// Tells the RPC client that it may issue another command, once it has released
+// the command pin from the last one and there is a free slot. Must be called
+// with interrupts disabled.
+static void update_ready_status() {
+  if (ready || client_command_issued() || num_queued >= RPC_NUM_SLOTS)
+    return;
+  ready = true;
+  set_server_status(RPC_SERVER_IDLE);
+}
+
+// Latches a command issued by the RPC client and acknowledges it right away,
+// even if the server is in the middle of idle work or another command. The
+// command frame is read later by the server loop, since the SPI bus may be in
+// use at this point. Must be called with interrupts disabled.
+static void latch_client_command() {
+  if (!client_command_issued()) {
+    update_ready_status();
+    return;
   }
+  if (!ready)
+    return;
+  ready = false;
+  ++num_queued;
+  command_time = timer_get_us();
+  set_server_status(RPC_SERVER_BUSY);
+}
+
+// Pin change interrupt for the RPC command pin.
+ISR(PCINT0_vect) {
+  latch_client_command();
+}
+
+// Posts the completed command count to the client's mailbox.
+static void update_mailbox() {
+  shmem_write(RPC_MAILBOX_ADDR, &num_completed, sizeof(num_completed));
 }
 
 void rpc_init() {
   DDRB |= (1 << RPC_STATUS_BIT);     // The RPC server status is an output.
   DDRB &= ~(1 << RPC_COMMAND_BIT);   // The RPC command status is an input.
 
+  num_completed = 0;
+  update_mailbox();
+
+  clear_cancel_ticket();
+
+  // Clear the priority lane.
+  uint8_t command = RPC_CMD_NONE;
+  shmem_write(RPC_PRIORITY_FRAME_ADDR, &command, sizeof(command));
+
   // Set server status to ready.
+  num_queued = 0;
+  ready = true;
   set_server_status(RPC_SERVER_IDLE);
+
+  // Get notified of RPC commands through the pin change interrupt.
+  PCMSK0 |= (1 << RPC_COMMAND_PCINT);
+  PCICR |= (1 << PCIE0);
+
+  // A command that was issued before the interrupt was enabled did not cause
+  // a pin change, so check for it here.
+  cli();
+  latch_client_command();
+  sei();
 }
 
 // Function to run when not executing any RPC commands.
@@ -153,43 +349,69 @@ static void rpc_idle() {
   // Poll USB.
   // TODO: Separate this from RPC.
   usb_update();
+
+  rpc_service_priority();
+
+  // Apply the pending write list at the start of vblank. It goes before the
+  // background script, since it has to be done before vblank ends.
+  rpc_core_idle();
+
+  // Run the background script, if it is due.
+  rpc_vm_idle();
 }
 
 const char rpc_server_loop_str0[] PROGMEM = "Received command code: 0x%02x\n";
 const char rpc_server_loop_str1[] PROGMEM = "Executing command.\n";
 const char rpc_server_loop_str2[] PROGMEM = "Done executing command.\n\n";
+const char rpc_server_loop_str3[] PROGMEM = "Command latency: %lu us\n";
 
 void rpc_server_loop() {
+  // Commands are latched in slot order.
+  uint8_t slot = 0;
   while (true) {
-    // Set RPC status to ready.
-    set_server_status(RPC_SERVER_IDLE);
-
-    // Read in RPC client status.
-    do {
+    // Do idle work until a command is latched. The client has already been
+    // acknowledged by the time |num_queued| is incremented.
+    while (num_queued == 0)
       rpc_idle();
-    } while (read_client_command() == RPC_CMD_NONE);
 
-    // Read the command and update the status register to indicate that the
-    // command was received.
-    uint8_t command = read_client_command();
-    set_server_status(RPC_SERVER_BUSY);
+    // Run any priority command before the next command from the slots.
+    rpc_service_priority();
+
+    // The command code and input args are read in one go.
+    RPC_Frame frame;
+    read_client_command(slot, &frame);
 
 #ifdef DEBUG
-    printf_P(rpc_server_loop_str0, command);
+    printf_P(rpc_server_loop_str0, frame.command);
+    printf_P(rpc_server_loop_str3, timer_get_us() - command_time);
 #endif
 
-    // Wait for MCU to clear the command register.
-    while(read_client_command() != RPC_CMD_NONE);
-
 #ifdef DEBUG
     printf_P(rpc_server_loop_str1);
 #endif
-    rpc_exec(command);
+    uint16_t status = rpc_exec_frame(&frame, RPC_OUTPUT_ARG_ADDR(slot));
 #ifdef DEBUG
     printf_P(rpc_server_loop_str2);
 #endif
+    shmem_write(RPC_STATUS_ADDR(slot), &status, sizeof(status));
+
+    // A cancel that arrived too late to be acted on must not stay around until
+    // the ticket comes up again.
+    uint16_t cancel_ticket;
+    shmem_read(RPC_CANCEL_ADDR, &cancel_ticket, sizeof(cancel_ticket));
+    if (cancel_ticket == get_current_ticket())
+      clear_cancel_ticket();
+
+    // Finish the RPC operation. Post the completion before freeing the slot,
+    // since the client may reuse the slot as soon as it sees the idle status.
+    // If the client has already issued the next command, it is run right away.
+    num_completed = get_current_ticket();
+    update_mailbox();
+    cli();
+    --num_queued;
+    update_ready_status();
+    sei();
 
-    // Finish the RPC operation.
-    set_server_status(RPC_SERVER_IDLE);
+    slot = (slot + 1) % RPC_NUM_SLOTS;
   }
 }
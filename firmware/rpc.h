@@ -28,4 +28,17 @@ void rpc_init();
 // Runs the RPC server loop forever.
 void rpc_server_loop();
 
+// Long commands call this in between segments. Runs the command in the
+// priority lane, if there is one, so that it is not held up, and applies the
+// pending Core write list if a vertical blank has started. Returns true if
+// the client has canceled the command being executed, in which case it should
+// stop and return RPC_STATUS_CANCELED.
+bool rpc_yield();
+
+// Copies the input args of the command being executed into |args|.
+void rpc_read_args(void* args, uint8_t size);
+
+// Writes the output args of the command being executed.
+void rpc_write_args(const void* args, uint8_t size);
+
 #endif  // __RPC_H__
@@ -0,0 +1,122 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube remote procedure call functions for the Core.
+
+#include "DuinoCube/core_defs.h"
+#include "DuinoCube/mem.h"
+#include "DuinoCube/rpc.h"
+#include "DuinoCube/rpc_core.h"
+
+#include "printf.h"
+#include "rpc.h"
+#include "shmem.h"
+
+#include "rpc_core.h"
+
+// The write list that is waiting for the next vertical blank.
+static uint16_t list_addr;
+static uint16_t list_size;
+static bool list_pending;
+// Number of write lists that have been applied.
+static uint16_t num_lists_applied;
+// Whether the Core was in vertical blank, for rpc_core_vblank_started().
+static bool in_vblank;
+
+uint8_t rpc_core_write_list() {
+  RPC_CoreWriteListArgs args;
+  rpc_read_args(&args.in, sizeof(args.in));
+
+  if (list_pending)
+    return RPC_STATUS_FAILED;
+  if ((uint32_t)args.in.list_addr + args.in.list_size > SHARED_MEMORY_SIZE)
+    return RPC_STATUS_INVALID_ARGS;
+
+  list_addr = args.in.list_addr;
+  list_size = args.in.list_size;
+  list_pending = true;
+
+  // Do not apply it in the middle of a vertical blank, which might end before
+  // the list has been applied. Wait for the next one.
+  in_vblank = true;
+
+  return RPC_STATUS_OK;
+}
+
+uint8_t rpc_core_write_list_status() {
+  RPC_CoreWriteListStatusArgs args;
+  args.out.pending = list_pending;
+  args.out.num_applied = num_lists_applied;
+
+  rpc_write_args(&args.out, sizeof(args.out));
+
+  return RPC_STATUS_OK;
+}
+
+const char rpc_core_str0[] PROGMEM =
+    "Invalid write list entry at 0x%04x: addr 0x%04x, size %u\n";
+
+// Copies the data of each entry of the pending write list to the Core. Stops at
+// the first entry that does not fit in the list or in the Core address space.
+static void apply_write_list() {
+  // A command that is in progress may depend on the selected memory bank and
+  // VRAM access, so restore them afterward. They are adjacent registers.
+  uint16_t saved_regs[2];
+  shmem_read(SHARED_MEMORY_SIZE + REG_SYS_CTRL, saved_regs, sizeof(saved_regs));
+  saved_regs[0] &= (1 << REG_SYS_CTRL_VRAM_ACCESS);
+
+  uint16_t addr = list_addr;
+  uint16_t end = list_addr + list_size;
+  while (end - addr >= sizeof(RPC_WriteListEntry)) {
+    RPC_WriteListEntry entry;
+    shmem_read(addr, &entry, sizeof(entry));
+    uint16_t data_addr = addr + sizeof(entry);
+    if (entry.size > end - data_addr ||
+        (uint32_t)entry.addr + entry.size > SHARED_MEMORY_SIZE) {
+#ifdef DEBUG
+      printf_P(rpc_core_str0, addr, entry.addr, entry.size);
+#endif
+      break;
+    }
+    shmem_move(SHARED_MEMORY_SIZE + entry.addr, data_addr, entry.size);
+    addr = data_addr + entry.size;
+  }
+
+  shmem_write(SHARED_MEMORY_SIZE + REG_SYS_CTRL,
+              saved_regs, sizeof(saved_regs));
+}
+
+bool rpc_core_vblank_started(bool* in_vblank) {
+  uint16_t output_status;
+  shmem_read(SHARED_MEMORY_SIZE + REG_OUTPUT_STATUS,
+             &output_status, sizeof(output_status));
+  bool was_in_vblank = *in_vblank;
+  *in_vblank = (output_status >> REG_VBLANK) & 1;
+  return *in_vblank && !was_in_vblank;
+}
+
+void rpc_core_idle() {
+  if (!list_pending)
+    return;
+
+  if (!rpc_core_vblank_started(&in_vblank))
+    return;
+
+  apply_write_list();
+  list_pending = false;
+  ++num_lists_applied;
+}
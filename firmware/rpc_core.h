@@ -0,0 +1,41 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube remote procedure call functions for the Core.
+
+#ifndef __RPC_CORE_H__
+#define __RPC_CORE_H__
+
+#include <stdint.h>
+
+uint8_t rpc_core_write_list();
+uint8_t rpc_core_write_list_status();
+
+// Detects the start of a vertical blank of the Core. |in_vblank| is the
+// caller's record of whether the Core was in vertical blank as of its last
+// check. Set it to true to wait for the next vertical blank rather than one
+// that is under way. Returns true if a vertical blank has started since the
+// last check.
+bool rpc_core_vblank_started(bool* in_vblank);
+
+// Applies the pending write list, if there is one and a vertical blank has just
+// started. Called when the RPC server is idle, and from rpc_yield() in between
+// the segments of long commands, so that a vertical blank is not missed while
+// they run.
+void rpc_core_idle();
+
+#endif  // __RPC_CORE_H__
@@ -0,0 +1,439 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// Generated by utils/rpcgen from DuinoCube/rpc_commands.txt.  Do not edit.
+
+#include <avr/pgmspace.h>
+#include <stddef.h>
+
+#include "DuinoCube/rpc.h"
+
+#include "rpc_dispatch.h"
+
+// Make sure that the command codes match rpc.h.
+typedef char rpc_check_HELLO[
+    (RPC_CMD_HELLO == 0x10) ? 1 : -1];
+typedef char rpc_check_INVERT[
+    (RPC_CMD_INVERT == 0x11) ? 1 : -1];
+typedef char rpc_check_READ_CORE_ID[
+    (RPC_CMD_READ_CORE_ID == 0x12) ? 1 : -1];
+typedef char rpc_check_FILE_OPEN[
+    (RPC_CMD_FILE_OPEN == 0x21) ? 1 : -1];
+typedef char rpc_check_FILE_CLOSE[
+    (RPC_CMD_FILE_CLOSE == 0x22) ? 1 : -1];
+typedef char rpc_check_FILE_READ[
+    (RPC_CMD_FILE_READ == 0x23) ? 1 : -1];
+typedef char rpc_check_FILE_WRITE[
+    (RPC_CMD_FILE_WRITE == 0x24) ? 1 : -1];
+typedef char rpc_check_FILE_SIZE[
+    (RPC_CMD_FILE_SIZE == 0x25) ? 1 : -1];
+typedef char rpc_check_FILE_SEEK[
+    (RPC_CMD_FILE_SEEK == 0x26) ? 1 : -1];
+typedef char rpc_check_FILE_WINDOW_MAP[
+    (RPC_CMD_FILE_WINDOW_MAP == 0x27) ? 1 : -1];
+typedef char rpc_check_FILE_WINDOW_UNMAP[
+    (RPC_CMD_FILE_WINDOW_UNMAP == 0x28) ? 1 : -1];
+typedef char rpc_check_FILE_WINDOW_TOUCH[
+    (RPC_CMD_FILE_WINDOW_TOUCH == 0x29) ? 1 : -1];
+typedef char rpc_check_SNAPSHOT[
+    (RPC_CMD_SNAPSHOT == 0x2a) ? 1 : -1];
+typedef char rpc_check_MEM_STAT[
+    (RPC_CMD_MEM_STAT == 0x30) ? 1 : -1];
+typedef char rpc_check_MEM_ALLOC[
+    (RPC_CMD_MEM_ALLOC == 0x31) ? 1 : -1];
+typedef char rpc_check_MEM_FREE[
+    (RPC_CMD_MEM_FREE == 0x32) ? 1 : -1];
+typedef char rpc_check_COPY[
+    (RPC_CMD_COPY == 0x33) ? 1 : -1];
+typedef char rpc_check_FILL[
+    (RPC_CMD_FILL == 0x34) ? 1 : -1];
+typedef char rpc_check_CRC[
+    (RPC_CMD_CRC == 0x3a) ? 1 : -1];
+typedef char rpc_check_MEM_ALLOC_HANDLE[
+    (RPC_CMD_MEM_ALLOC_HANDLE == 0x35) ? 1 : -1];
+typedef char rpc_check_MEM_FREE_HANDLE[
+    (RPC_CMD_MEM_FREE_HANDLE == 0x36) ? 1 : -1];
+typedef char rpc_check_MEM_LOCK[
+    (RPC_CMD_MEM_LOCK == 0x37) ? 1 : -1];
+typedef char rpc_check_MEM_UNLOCK[
+    (RPC_CMD_MEM_UNLOCK == 0x38) ? 1 : -1];
+typedef char rpc_check_MEM_COMPACT[
+    (RPC_CMD_MEM_COMPACT == 0x39) ? 1 : -1];
+typedef char rpc_check_USB_READ_JOYSTICK[
+    (RPC_CMD_USB_READ_JOYSTICK == 0x41) ? 1 : -1];
+typedef char rpc_check_BATCH[
+    (RPC_CMD_BATCH == 0x60) ? 1 : -1];
+typedef char rpc_check_STATS[
+    (RPC_CMD_STATS == 0x61) ? 1 : -1];
+typedef char rpc_check_VM_RUN[
+    (RPC_CMD_VM_RUN == 0x70) ? 1 : -1];
+typedef char rpc_check_VM_START[
+    (RPC_CMD_VM_START == 0x71) ? 1 : -1];
+typedef char rpc_check_VM_STOP[
+    (RPC_CMD_VM_STOP == 0x72) ? 1 : -1];
+typedef char rpc_check_VM_STATUS[
+    (RPC_CMD_VM_STATUS == 0x73) ? 1 : -1];
+typedef char rpc_check_CORE_WRITE_LIST[
+    (RPC_CMD_CORE_WRITE_LIST == 0x80) ? 1 : -1];
+typedef char rpc_check_CORE_WRITE_LIST_STATUS[
+    (RPC_CMD_CORE_WRITE_LIST_STATUS == 0x81) ? 1 : -1];
+
+// Command handlers.
+uint8_t rpc_hello();
+uint8_t rpc_invert();
+uint8_t rpc_read_core_id();
+uint8_t rpc_file_open();
+uint8_t rpc_file_close();
+uint8_t rpc_file_read();
+uint8_t rpc_file_write();
+uint8_t rpc_file_size();
+uint8_t rpc_file_seek();
+uint8_t rpc_file_window_map();
+uint8_t rpc_file_window_unmap();
+uint8_t rpc_file_window_touch();
+uint8_t rpc_snapshot();
+uint8_t rpc_mem_stat();
+uint8_t rpc_mem_alloc();
+uint8_t rpc_mem_free();
+uint8_t rpc_copy();
+uint8_t rpc_fill();
+uint8_t rpc_crc();
+uint8_t rpc_mem_alloc_handle();
+uint8_t rpc_mem_free_handle();
+uint8_t rpc_mem_lock();
+uint8_t rpc_mem_unlock();
+uint8_t rpc_mem_compact();
+uint8_t rpc_usb_read_joystick();
+uint8_t rpc_batch();
+uint8_t rpc_stats_read();
+uint8_t rpc_vm_run();
+uint8_t rpc_vm_start();
+uint8_t rpc_vm_stop();
+uint8_t rpc_vm_status();
+uint8_t rpc_core_write_list();
+uint8_t rpc_core_write_list_status();
+
+#define NUM_COMMAND_CODES  0x82
+
+// Handlers indexed by command code.
+static const RPC_Handler rpc_handlers[NUM_COMMAND_CODES] PROGMEM = {
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  rpc_hello,  // 0x10
+  rpc_invert,  // 0x11
+  rpc_read_core_id,  // 0x12
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  rpc_file_open,  // 0x21
+  rpc_file_close,  // 0x22
+  rpc_file_read,  // 0x23
+  rpc_file_write,  // 0x24
+  rpc_file_size,  // 0x25
+  rpc_file_seek,  // 0x26
+  rpc_file_window_map,  // 0x27
+  rpc_file_window_unmap,  // 0x28
+  rpc_file_window_touch,  // 0x29
+  rpc_snapshot,  // 0x2a
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  rpc_mem_stat,  // 0x30
+  rpc_mem_alloc,  // 0x31
+  rpc_mem_free,  // 0x32
+  rpc_copy,  // 0x33
+  rpc_fill,  // 0x34
+  rpc_mem_alloc_handle,  // 0x35
+  rpc_mem_free_handle,  // 0x36
+  rpc_mem_lock,  // 0x37
+  rpc_mem_unlock,  // 0x38
+  rpc_mem_compact,  // 0x39
+  rpc_crc,  // 0x3a
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  rpc_usb_read_joystick,  // 0x41
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  rpc_batch,  // 0x60
+  rpc_stats_read,  // 0x61
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  rpc_vm_run,  // 0x70
+  rpc_vm_start,  // 0x71
+  rpc_vm_stop,  // 0x72
+  rpc_vm_status,  // 0x73
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  rpc_core_write_list,  // 0x80
+  rpc_core_write_list_status,  // 0x81
+};
+
+// Index of each command code among the commands, in table order.
+static const uint8_t rpc_command_indices[NUM_COMMAND_CODES] PROGMEM = {
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  0,  // 0x10
+  1,  // 0x11
+  2,  // 0x12
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  3,  // 0x21
+  4,  // 0x22
+  5,  // 0x23
+  6,  // 0x24
+  7,  // 0x25
+  8,  // 0x26
+  9,  // 0x27
+  10,  // 0x28
+  11,  // 0x29
+  12,  // 0x2a
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  13,  // 0x30
+  14,  // 0x31
+  15,  // 0x32
+  16,  // 0x33
+  17,  // 0x34
+  19,  // 0x35
+  20,  // 0x36
+  21,  // 0x37
+  22,  // 0x38
+  23,  // 0x39
+  18,  // 0x3a
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  24,  // 0x41
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  25,  // 0x60
+  26,  // 0x61
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  27,  // 0x70
+  28,  // 0x71
+  29,  // 0x72
+  30,  // 0x73
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  RPC_NO_COMMAND_INDEX,
+  31,  // 0x80
+  32,  // 0x81
+};
+
+// Bitmap of commands that may be run from the priority lane.
+static const uint8_t
+    rpc_priority_commands[(NUM_COMMAND_CODES + 7) / 8] PROGMEM = {
+  0x00,
+  0x00,
+  0x04,
+  0x00,
+  0x00,
+  0x00,
+  0x81,
+  0x01,
+  0x02,
+  0x00,
+  0x00,
+  0x00,
+  0x00,
+  0x00,
+  0x0c,
+  0x00,
+  0x03,
+};
+
+RPC_Handler rpc_get_handler(uint8_t command) {
+  if (command >= NUM_COMMAND_CODES)
+    return NULL;
+  return (RPC_Handler) pgm_read_word(&rpc_handlers[command]);
+}
+
+uint8_t rpc_get_command_index(uint8_t command) {
+  if (command >= NUM_COMMAND_CODES)
+    return RPC_NO_COMMAND_INDEX;
+  return pgm_read_byte(&rpc_command_indices[command]);
+}
+
+bool rpc_is_priority_command(uint8_t command) {
+  if (command >= NUM_COMMAND_CODES)
+    return false;
+  return (pgm_read_byte(&rpc_priority_commands[command / 8]) >>
+          (command % 8)) & 1;
+}
@@ -0,0 +1,41 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube remote procedure call command dispatch. The dispatch table is
+// generated from DuinoCube/rpc_commands.txt by utils/rpcgen.
+
+#ifndef __RPC_DISPATCH_H__
+#define __RPC_DISPATCH_H__
+
+#include <stdint.h>
+
+// An RPC command handler. Returns an RPC_STATUS_* code.
+typedef uint8_t (*RPC_Handler)();
+
+// Returns the handler for |command|, or NULL if there is none.
+RPC_Handler rpc_get_handler(uint8_t command);
+
+// Returns the index of |command| among the RPC_NUM_COMMANDS commands, for
+// tables that have an entry per command, or RPC_NO_COMMAND_INDEX if there is
+// no such command.
+#define RPC_NO_COMMAND_INDEX  0xff
+uint8_t rpc_get_command_index(uint8_t command);
+
+// Returns true if |command| may be run from the priority lane.
+bool rpc_is_priority_command(uint8_t command);
+
+#endif  // __RPC_DISPATCH_H__
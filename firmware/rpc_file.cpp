@@ -18,11 +18,16 @@
 // DuinoCube remote procedure call functions for file system.
 
 #include <stdio.h>
+#include <string.h>
 
+#include "DuinoCube/file.h"
 #include "DuinoCube/rpc.h"
 
 #include "file.h"
+#include "rpc.h"
+#include "rpc_stats.h"
 #include "shmem.h"
+#include "snapshot.h"
 
 #include "rpc_file.h"
 
@@ -33,28 +38,34 @@
 // memory.
 #define FILE_BUFFER_SIZE        256
 
-void rpc_file_open() {
+uint8_t rpc_file_open() {
   RPC_FileOpenArgs args;
-  shmem_read(RPC_INPUT_ARG_ADDR, &args.in, sizeof(args.in));
+  rpc_read_args(&args.in, sizeof(args.in));
 
   char filename_buf[STRING_BUF_SIZE];
   shmem_read(args.in.filename_addr, filename_buf, STRING_BUF_SIZE);
 
   args.out.handle = (uint16_t) file_open(filename_buf, args.in.mode);
 
-  shmem_write(RPC_OUTPUT_ARG_ADDR, &args.out, sizeof(args.out));
+  rpc_write_args(&args.out, sizeof(args.out));
+
+  return args.out.handle ? RPC_STATUS_OK : RPC_STATUS_FAILED;
 }
 
-void rpc_file_close() {
+uint8_t rpc_file_close() {
   RPC_FileCloseArgs args;
-  shmem_read(RPC_INPUT_ARG_ADDR, &args.in, sizeof(args.in));
+  rpc_read_args(&args.in, sizeof(args.in));
 
   file_close(args.in.handle);
+
+  return RPC_STATUS_OK;
 }
 
-void rpc_file_read() {
+uint8_t rpc_file_read() {
   RPC_FileReadArgs args;
-  shmem_read(RPC_INPUT_ARG_ADDR, &args.in, sizeof(args.in));
+  rpc_read_args(&args.in, sizeof(args.in));
+
+  uint8_t status = RPC_STATUS_OK;
 
   // Since file access can only take place between local memory space and the
   // file, use a buffer as an intermediate between the file and shared memory.
@@ -80,15 +91,28 @@ void rpc_file_read() {
       total_size_read += size_just_read;
       break;
     }
+
+    // Let priority commands run in between segments, and stop here if the
+    // client has canceled the read.
+    if (rpc_yield()) {
+      total_size_read += size_just_read;
+      status = RPC_STATUS_CANCELED;
+      break;
+    }
   }
   args.out.size_read = total_size_read;
+  rpc_stats_add_bytes(total_size_read);
+
+  rpc_write_args(&args.out, sizeof(args.out));
 
-  shmem_write(RPC_OUTPUT_ARG_ADDR, &args.out, sizeof(args.out));
+  return status;
 }
 
-void rpc_file_write() {
+uint8_t rpc_file_write() {
   RPC_FileWriteArgs args;
-  shmem_read(RPC_INPUT_ARG_ADDR, &args.in, sizeof(args.in));
+  rpc_read_args(&args.in, sizeof(args.in));
+
+  uint8_t status = RPC_STATUS_OK;
 
   // Since file access can only take place between local memory space and the
   // file, use a buffer as an intermediate between the file and shared memory.
@@ -104,32 +128,208 @@ void rpc_file_write() {
     // Get the next chunk of data from shared memory and write it to file.
     shmem_read(args.in.src_addr + total_size_written, buffer, size_to_write);
     uint16_t size_just_written =
-        file_read(args.in.handle, buffer, size_to_write);
+        file_write(args.in.handle, buffer, size_to_write);
 
     // If writing |size_to_write| bytes to file failed, the file system may have
     // run out of space, so quit without having written |args.in.size| bytes.
     if (size_to_write != size_just_written) {
       total_size_written += size_just_written;
+      status = RPC_STATUS_FAILED;
+      break;
+    }
+
+    // Let priority commands run in between segments, and stop here if the
+    // client has canceled the write.
+    if (rpc_yield()) {
+      total_size_written += size_just_written;
+      status = RPC_STATUS_CANCELED;
       break;
     }
   }
   args.out.size_written = total_size_written;
+  rpc_stats_add_bytes(total_size_written);
+
+  rpc_write_args(&args.out, sizeof(args.out));
 
-  shmem_write(RPC_OUTPUT_ARG_ADDR, &args.out, sizeof(args.out));
+  return status;
 }
 
-void rpc_file_size() {
+uint8_t rpc_file_size() {
   RPC_FileSizeArgs args;
-  shmem_read(RPC_INPUT_ARG_ADDR, &args.in, sizeof(args.in));
+  rpc_read_args(&args.in, sizeof(args.in));
 
   args.out.size = file_size(args.in.handle);
 
-  shmem_write(RPC_OUTPUT_ARG_ADDR, &args.out, sizeof(args.out));
+  rpc_write_args(&args.out, sizeof(args.out));
+
+  return RPC_STATUS_OK;
 }
 
-void rpc_file_seek() {
+uint8_t rpc_file_seek() {
   RPC_FileSeekArgs args;
-  shmem_read(RPC_INPUT_ARG_ADDR, &args.in, sizeof(args.in));
+  rpc_read_args(&args.in, sizeof(args.in));
 
   file_seek(args.in.handle, args.in.offset);
+
+  return RPC_STATUS_OK;
+}
+
+// Value of |FileWindow::pages| for page slots that do not hold a page.
+#define NO_PAGE       0xffff
+
+// A file range that is mapped to pages in shared memory.
+struct FileWindow {
+  uint16_t handle;                          // File handle, or 0 if unused.
+  uint32_t offset;                          // Start of the range in the file.
+  uint16_t buf_addr;                        // Location of the page slots.
+  uint16_t page_size;
+  uint8_t num_pages;
+  uint16_t pages[FILE_WINDOW_MAX_PAGES];    // Page held by each slot.
+  uint8_t lru[FILE_WINDOW_MAX_PAGES];       // Slots, most recently used first.
+};
+
+static FileWindow file_windows[FILE_NUM_WINDOWS];
+
+// Returns the window for handle |window|, or NULL if it is not mapped.
+static FileWindow* get_file_window(uint16_t window) {
+  if (window == 0 || window > FILE_NUM_WINDOWS ||
+      !file_windows[window - 1].handle) {
+    return NULL;
+  }
+  return &file_windows[window - 1];
+}
+
+// Moves slot |slot| to the front of the LRU list of |window|.
+static void use_page_slot(FileWindow* window, uint8_t slot) {
+  uint8_t i = 0;
+  while (window->lru[i] != slot)
+    ++i;
+  for (; i > 0; --i)
+    window->lru[i] = window->lru[i - 1];
+  window->lru[0] = slot;
+}
+
+// Reads page |page| of |window| into slot |slot|. The part of the page that is
+// past the end of the file is zeroed. Returns an RPC status code.
+static uint8_t read_page(FileWindow* window, uint8_t slot, uint16_t page) {
+  file_seek(window->handle,
+            window->offset + (uint32_t)page * window->page_size);
+
+  uint8_t buffer[FILE_BUFFER_SIZE];
+  uint16_t addr = window->buf_addr + slot * window->page_size;
+  for (uint16_t offset = 0; offset < window->page_size;
+       offset += FILE_BUFFER_SIZE) {
+    uint16_t size_to_read = MIN(window->page_size - offset, FILE_BUFFER_SIZE);
+    uint16_t size_read = file_read(window->handle, buffer, size_to_read);
+    if (size_read < size_to_read)
+      memset(buffer + size_read, 0, size_to_read - size_read);
+    shmem_write(addr + offset, buffer, size_to_read);
+    rpc_stats_add_bytes(size_to_read);
+
+    if (offset + size_to_read < window->page_size && rpc_yield())
+      return RPC_STATUS_CANCELED;
+  }
+  return RPC_STATUS_OK;
+}
+
+uint8_t rpc_file_window_map() {
+  RPC_FileWindowMapArgs args;
+  rpc_read_args(&args.in, sizeof(args.in));
+
+  args.out.window = 0;
+  if (!args.in.handle || args.in.page_size == 0 || args.in.num_pages == 0 ||
+      args.in.num_pages > FILE_WINDOW_MAX_PAGES ||
+      args.in.buf_addr + (uint32_t)args.in.page_size * args.in.num_pages >
+          SHARED_MEMORY_SIZE) {
+    rpc_write_args(&args.out, sizeof(args.out));
+    return RPC_STATUS_INVALID_ARGS;
+  }
+
+  for (uint8_t i = 0; i < FILE_NUM_WINDOWS; ++i) {
+    FileWindow& window = file_windows[i];
+    if (window.handle)
+      continue;
+    window.handle = args.in.handle;
+    window.offset = args.in.offset;
+    window.buf_addr = args.in.buf_addr;
+    window.page_size = args.in.page_size;
+    window.num_pages = args.in.num_pages;
+    for (uint8_t slot = 0; slot < window.num_pages; ++slot) {
+      window.pages[slot] = NO_PAGE;
+      window.lru[slot] = slot;
+    }
+    args.out.window = i + 1;
+    break;
+  }
+  rpc_write_args(&args.out, sizeof(args.out));
+
+  return args.out.window ? RPC_STATUS_OK : RPC_STATUS_FAILED;
+}
+
+uint8_t rpc_file_window_unmap() {
+  RPC_FileWindowUnmapArgs args;
+  rpc_read_args(&args.in, sizeof(args.in));
+
+  FileWindow* window = get_file_window(args.in.window);
+  if (!window)
+    return RPC_STATUS_INVALID_ARGS;
+  window->handle = 0;
+
+  return RPC_STATUS_OK;
+}
+
+uint8_t rpc_file_window_touch() {
+  RPC_FileWindowTouchArgs args;
+  rpc_read_args(&args.in, sizeof(args.in));
+
+  args.out.addr = 0;
+  FileWindow* window = get_file_window(args.in.window);
+  if (!window || args.in.page == NO_PAGE) {
+    rpc_write_args(&args.out, sizeof(args.out));
+    return RPC_STATUS_INVALID_ARGS;
+  }
+
+  // Look for the page, and otherwise read it in place of the least recently
+  // used one.
+  uint8_t status = RPC_STATUS_OK;
+  uint8_t slot = 0;
+  while (slot < window->num_pages && window->pages[slot] != args.in.page)
+    ++slot;
+  if (slot == window->num_pages) {
+    slot = window->lru[window->num_pages - 1];
+    window->pages[slot] = NO_PAGE;
+    status = read_page(window, slot, args.in.page);
+    if (status == RPC_STATUS_OK)
+      window->pages[slot] = args.in.page;
+  }
+
+  if (status == RPC_STATUS_OK) {
+    use_page_slot(window, slot);
+    args.out.addr = window->buf_addr + slot * window->page_size;
+  }
+  rpc_write_args(&args.out, sizeof(args.out));
+
+  return status;
+}
+
+// Snapshots are saved with a smaller filename buffer than other commands, to
+// leave stack space for streaming the data.
+#define SNAPSHOT_FILENAME_SIZE   64
+
+uint8_t rpc_snapshot() {
+  RPC_SnapshotArgs args;
+  rpc_read_args(&args.in, sizeof(args.in));
+
+  char filename_buf[SNAPSHOT_FILENAME_SIZE];
+  shmem_read(args.in.filename_addr, filename_buf, sizeof(filename_buf));
+  filename_buf[sizeof(filename_buf) - 1] = '\0';
+
+  switch (snapshot_save(filename_buf, rpc_yield)) {
+  case SNAPSHOT_OK:
+    return RPC_STATUS_OK;
+  case SNAPSHOT_CANCELED:
+    return RPC_STATUS_CANCELED;
+  default:
+    return RPC_STATUS_FAILED;
+  }
 }
@@ -24,11 +24,19 @@
 
 #include "DuinoCube/rpc_file.h"
 
-void rpc_file_open();
-void rpc_file_close();
-void rpc_file_read();
-void rpc_file_write();
-void rpc_file_size();
-void rpc_file_seek();
+uint8_t rpc_file_open();
+uint8_t rpc_file_close();
+uint8_t rpc_file_read();
+uint8_t rpc_file_write();
+uint8_t rpc_file_size();
+uint8_t rpc_file_seek();
+
+// Demand-paged file windows. See File::Window in DuinoCube/file.h.
+uint8_t rpc_file_window_map();
+uint8_t rpc_file_window_unmap();
+uint8_t rpc_file_window_touch();
+
+// Saves a snapshot of the Core and shared memory. See DuinoCube/snapshot.h.
+uint8_t rpc_snapshot();
 
 #endif  // __RPC_FILE_H__
@@ -18,30 +18,297 @@
 // DuinoCube remote procedure call functions for memory allocation.
 
 #include "DuinoCube/mem.h"
+#include "DuinoCube/rpc.h"
 #include "DuinoCube/rpc_mem.h"
 
+#include "crc32.h"
+#include "printf.h"
+#include "rpc.h"
+#include "rpc_stats.h"
 #include "shmem.h"
+#include "xmem.h"
 
 #include "rpc_mem.h"
 
-void rpc_mem_stat() {
+uint8_t rpc_mem_stat() {
   RPC_MemStatArgs args;
-  shmem_stat(&args.out.total_free_size, &args.out.largest_free_size);
-  shmem_write(RPC_OUTPUT_ARG_ADDR, &args.out, sizeof(args.out));
+  ShmemHeapStats stats;
+  shmem_stat(&stats);
+  args.out.total_free_size = stats.total_free_size;
+  args.out.largest_free_size = stats.largest_free_size;
+  args.out.num_free_regions = stats.num_free_regions;
+  args.out.slab_size = stats.slab_size;
+  args.out.slab_free_size = stats.slab_free_size;
+  args.out.high_water_size = stats.high_water_size;
+  args.out.fragmentation = 0;
+  if (stats.total_free_size > 0) {
+    args.out.fragmentation =
+        100 - (uint32_t)stats.largest_free_size * 100 / stats.total_free_size;
+  }
+  rpc_write_args(&args.out, sizeof(args.out));
+
+  return RPC_STATUS_OK;
 }
 
-void rpc_mem_alloc() {
+uint8_t rpc_mem_alloc() {
   RPC_MemAllocArgs args;
-  shmem_read(RPC_INPUT_ARG_ADDR, &args.in, sizeof(args.in));
+  rpc_read_args(&args.in, sizeof(args.in));
 
   args.out.addr = shmem_alloc(args.in.size);
 
-  shmem_write(RPC_OUTPUT_ARG_ADDR, &args.out, sizeof(args.out));
+  rpc_write_args(&args.out, sizeof(args.out));
+
+  return args.out.addr ? RPC_STATUS_OK : RPC_STATUS_FAILED;
 }
 
-void rpc_mem_free() {
+const char rpc_mem_free_str0[] PROGMEM =
+    "Not an allocated shared memory address: 0x%04x\n";
+
+uint8_t rpc_mem_free() {
   RPC_MemFreeArgs args;
-  shmem_read(RPC_INPUT_ARG_ADDR, &args.in, sizeof(args.in));
+  rpc_read_args(&args.in, sizeof(args.in));
+
+  if (!shmem_free(args.in.addr)) {
+#ifdef DEBUG
+    printf_P(rpc_mem_free_str0, args.in.addr);
+#endif
+    return RPC_STATUS_INVALID_ARGS;
+  }
+
+  return RPC_STATUS_OK;
+}
+
+uint8_t rpc_mem_alloc_handle() {
+  RPC_MemAllocHandleArgs args;
+  rpc_read_args(&args.in, sizeof(args.in));
+
+  args.out.handle = shmem_alloc_handle(args.in.size);
+
+  rpc_write_args(&args.out, sizeof(args.out));
+
+  return args.out.handle ? RPC_STATUS_OK : RPC_STATUS_FAILED;
+}
+
+const char rpc_mem_handle_str0[] PROGMEM =
+    "Not an allocated shared memory handle: %u\n";
+
+uint8_t rpc_mem_free_handle() {
+  RPC_MemFreeHandleArgs args;
+  rpc_read_args(&args.in, sizeof(args.in));
+
+  if (!shmem_free_handle(args.in.handle)) {
+#ifdef DEBUG
+    printf_P(rpc_mem_handle_str0, args.in.handle);
+#endif
+    return RPC_STATUS_INVALID_ARGS;
+  }
+
+  return RPC_STATUS_OK;
+}
+
+uint8_t rpc_mem_lock() {
+  RPC_MemLockArgs args;
+  rpc_read_args(&args.in, sizeof(args.in));
+
+  args.out.addr = shmem_lock(args.in.handle);
+
+  rpc_write_args(&args.out, sizeof(args.out));
+
+  return args.out.addr ? RPC_STATUS_OK : RPC_STATUS_INVALID_ARGS;
+}
+
+uint8_t rpc_mem_unlock() {
+  RPC_MemUnlockArgs args;
+  rpc_read_args(&args.in, sizeof(args.in));
+
+  return shmem_unlock(args.in.handle) ? RPC_STATUS_OK
+                                      : RPC_STATUS_INVALID_ARGS;
+}
+
+uint8_t rpc_mem_compact() {
+  RPC_MemCompactArgs args;
+
+  shmem_compact();
+
+  ShmemHeapStats stats;
+  shmem_stat(&stats);
+  args.out.largest_free_size = stats.largest_free_size;
+  rpc_write_args(&args.out, sizeof(args.out));
+
+  return RPC_STATUS_OK;
+}
+
+// Size of the buffer through which copy and fill data is streamed.
+#define XMEM_BUFFER_SIZE      64
+// Number of bytes streamed between checks for priority commands and cancels.
+#define XMEM_YIELD_SIZE      512
+
+const char rpc_xmem_str0[] PROGMEM =
+    "Invalid extended address range: 0x%06lx, size 0x%06lx\n";
+
+// Returns true if all of |size| bytes starting at |addr| can be accessed.
+static bool check_range(uint32_t addr, uint32_t size, bool for_write) {
+  while (size > 0) {
+    uint32_t span = xmem_get_span(addr, for_write);
+    if (span == 0) {
+#ifdef DEBUG
+      printf_P(rpc_xmem_str0, addr, size);
+#endif
+      return false;
+    }
+    if (span >= size)
+      break;
+    addr += span;
+    size -= span;
+  }
+  return true;
+}
+
+// Lets priority commands run once every XMEM_YIELD_SIZE bytes, with the
+// client's view of the Core restored. Returns true if the client has canceled
+// the command.
+static bool yield_after(uint16_t size, uint16_t* size_since_yield) {
+  *size_since_yield += size;
+  if (*size_since_yield < XMEM_YIELD_SIZE)
+    return false;
+  *size_since_yield = 0;
+
+  xmem_end();
+  bool canceled = rpc_yield();
+  xmem_begin();
+  return canceled;
+}
+
+// Returns the size of the next chunk to stream, which does not cross a region
+// or bank boundary on either side.
+static uint16_t get_chunk_size(uint32_t remaining, uint32_t dst_span,
+                               uint32_t src_span) {
+  uint32_t size = XMEM_BUFFER_SIZE;
+  if (remaining < size)
+    size = remaining;
+  if (dst_span < size)
+    size = dst_span;
+  if (src_span < size)
+    size = src_span;
+  return size;
+}
+
+uint8_t rpc_copy() {
+  RPC_CopyArgs args;
+  rpc_read_args(&args.in, sizeof(args.in));
+
+  uint32_t dst = args.in.dst_addr;
+  uint32_t src = args.in.src_addr;
+  uint32_t remaining = args.in.size;
+
+  if (!check_range(src, remaining, false) || !check_range(dst, remaining, true))
+    return RPC_STATUS_INVALID_ARGS;
+  // The copy runs forward, so it would overwrite its own source data if the
+  // destination starts within it.
+  if (dst > src && dst - src < remaining)
+    return RPC_STATUS_INVALID_ARGS;
+
+  uint8_t status = RPC_STATUS_OK;
+  uint8_t buf[XMEM_BUFFER_SIZE];
+  uint16_t size_since_yield = 0;
+  xmem_begin();
+  while (remaining > 0) {
+    uint16_t size = get_chunk_size(remaining, xmem_get_span(dst, true),
+                                   xmem_get_span(src, false));
+    xmem_read(src, buf, size);
+    xmem_write(dst, buf, size);
+    rpc_stats_add_bytes(size);
+    src += size;
+    dst += size;
+    remaining -= size;
+
+    if (remaining > 0 && yield_after(size, &size_since_yield)) {
+      status = RPC_STATUS_CANCELED;
+      break;
+    }
+  }
+  xmem_end();
+
+  return status;
+}
+
+uint8_t rpc_fill() {
+  RPC_FillArgs args;
+  rpc_read_args(&args.in, sizeof(args.in));
+
+  uint32_t dst = args.in.dst_addr;
+  uint32_t remaining = args.in.size;
+
+  if (!check_range(dst, remaining, true))
+    return RPC_STATUS_INVALID_ARGS;
+
+  // The pattern is generated on the fly, so each chunk goes out as one SPI
+  // transaction of up to XMEM_YIELD_SIZE bytes rather than being copied from a
+  // buffer.
+  uint8_t status = RPC_STATUS_OK;
+  uint16_t value = args.in.value;
+  uint16_t size_since_yield = 0;
+  xmem_begin();
+  while (remaining > 0) {
+    uint32_t size = XMEM_YIELD_SIZE;
+    if (remaining < size)
+      size = remaining;
+    uint32_t span = xmem_get_span(dst, true);
+    if (span < size)
+      size = span;
+    xmem_fill(dst, value, size);
+    rpc_stats_add_bytes(size);
+    // An odd-sized chunk leaves the next one starting on the pattern's high
+    // byte.
+    if (size & 1)
+      value = (value >> 8) | (value << 8);
+    dst += size;
+    remaining -= size;
+
+    if (remaining > 0 && yield_after(size, &size_since_yield)) {
+      status = RPC_STATUS_CANCELED;
+      break;
+    }
+  }
+  xmem_end();
+
+  return status;
+}
+
+uint8_t rpc_crc() {
+  RPC_CrcArgs args;
+  rpc_read_args(&args.in, sizeof(args.in));
+
+  uint32_t addr = args.in.addr;
+  uint32_t remaining = args.in.size;
+
+  if (!check_range(addr, remaining, false))
+    return RPC_STATUS_INVALID_ARGS;
+
+  // Ranges may span several VRAM banks, which xmem switches between as needed.
+  uint8_t status = RPC_STATUS_OK;
+  uint32_t crc = CRC32_INIT;
+  uint8_t buf[XMEM_BUFFER_SIZE];
+  uint16_t size_since_yield = 0;
+  xmem_begin();
+  while (remaining > 0) {
+    uint16_t size =
+        get_chunk_size(remaining, XMEM_BUFFER_SIZE, xmem_get_span(addr, false));
+    xmem_read(addr, buf, size);
+    crc = crc32_update(crc, buf, size);
+    rpc_stats_add_bytes(size);
+    addr += size;
+    remaining -= size;
+
+    if (remaining > 0 && yield_after(size, &size_since_yield)) {
+      status = RPC_STATUS_CANCELED;
+      break;
+    }
+  }
+  xmem_end();
+
+  args.out.crc = crc;
+  rpc_write_args(&args.out, sizeof(args.out));
 
-  shmem_free(args.in.addr);
+  return status;
 }
@@ -24,8 +24,18 @@
 
 #include "DuinoCube/rpc_mem.h"
 
-void rpc_mem_stat();
-void rpc_mem_alloc();
-void rpc_mem_free();
+uint8_t rpc_mem_stat();
+uint8_t rpc_mem_alloc();
+uint8_t rpc_mem_free();
+uint8_t rpc_mem_alloc_handle();
+uint8_t rpc_mem_free_handle();
+uint8_t rpc_mem_lock();
+uint8_t rpc_mem_unlock();
+uint8_t rpc_mem_compact();
+
+// Copy, fill and CRC in the extended address space of xaddr.h.
+uint8_t rpc_copy();
+uint8_t rpc_fill();
+uint8_t rpc_crc();
 
 #endif  // __RPC_MEM_H__
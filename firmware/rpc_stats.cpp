@@ -0,0 +1,124 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube remote procedure call statistics.
+
+#include <string.h>
+
+#include "DuinoCube/mem.h"
+#include "DuinoCube/rpc.h"
+
+#include "rpc.h"
+#include "rpc_dispatch.h"
+#include "shmem.h"
+
+#include "rpc_stats.h"
+
+// Stats of each command, or of each command group by default. The command code
+// is filled in when the stats are read, which saves RAM.
+struct StatsCounters {
+  uint16_t count;
+  uint32_t total_time;
+  uint32_t max_time;
+  uint32_t num_bytes;
+};
+#ifdef RPC_STATS_PER_COMMAND
+#define NUM_STATS_COUNTERS      RPC_NUM_COMMANDS
+#else
+#define NUM_STATS_COUNTERS      RPC_STATS_NUM_GROUPS
+#endif
+static StatsCounters stats_counters[NUM_STATS_COUNTERS];
+
+// Returns the index into |stats_counters| for |command|, or
+// RPC_NO_COMMAND_INDEX if it is not a valid command.
+static uint8_t get_counters_index(uint8_t command) {
+  uint8_t index = rpc_get_command_index(command);
+#ifndef RPC_STATS_PER_COMMAND
+  if (index != RPC_NO_COMMAND_INDEX) {
+    index = command >> 4;
+    if (index >= NUM_STATS_COUNTERS)
+      index = RPC_NO_COMMAND_INDEX;
+  }
+#endif
+  return index;
+}
+
+// Bytes moved by the command currently being executed.
+static uint16_t pending_num_bytes;
+
+void rpc_stats_update(uint8_t command, uint32_t time_us) {
+  uint16_t num_bytes = pending_num_bytes;
+  pending_num_bytes = 0;
+
+  // Invalid command codes are not recorded.
+  uint8_t index = get_counters_index(command);
+  if (index == RPC_NO_COMMAND_INDEX)
+    return;
+
+  StatsCounters* counters = &stats_counters[index];
+  ++counters->count;
+  counters->total_time += time_us;
+  if (time_us > counters->max_time)
+    counters->max_time = time_us;
+  counters->num_bytes += num_bytes;
+}
+
+void rpc_stats_add_bytes(uint16_t num_bytes) {
+  pending_num_bytes += num_bytes;
+}
+
+uint8_t rpc_stats_read() {
+  RPC_StatsArgs args;
+  rpc_read_args(&args.in, sizeof(args.in));
+
+  // Write an entry for each command or group that has been executed, in order
+  // of command code.
+  uint16_t num_entries = 0;
+  uint8_t last_index = RPC_NO_COMMAND_INDEX;
+  for (uint16_t command = 0; command < 0x100; ++command) {
+    // The commands of a group share their counters, which are written once.
+    uint8_t index = get_counters_index(command);
+    if (index == RPC_NO_COMMAND_INDEX || index == last_index ||
+        stats_counters[index].count == 0) {
+      continue;
+    }
+    last_index = index;
+
+    const StatsCounters& counters = stats_counters[index];
+    RPC_StatsEntry entry;
+#ifdef RPC_STATS_PER_COMMAND
+    entry.command = command;
+#else
+    entry.command = RPC_STATS_GROUP_FLAG | (command & 0xf0);
+#endif
+    entry.count = counters.count;
+    entry.total_time = counters.total_time;
+    entry.max_time = counters.max_time;
+    entry.num_bytes = counters.num_bytes;
+    shmem_write(args.in.buf_addr + num_entries * sizeof(entry), &entry,
+                sizeof(entry));
+    ++num_entries;
+  }
+  args.out.num_entries = num_entries;
+
+  if (args.in.reset)
+    memset(stats_counters, 0, sizeof(stats_counters));
+
+  rpc_write_args(&args.out, sizeof(args.out));
+
+  return RPC_STATUS_OK;
+}
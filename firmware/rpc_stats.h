@@ -0,0 +1,37 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube remote procedure call statistics.
+
+#ifndef __RPC_STATS_H__
+#define __RPC_STATS_H__
+
+#include <stdint.h>
+
+#include "DuinoCube/rpc_stats.h"
+
+// Records an execution of |command| that took |time_us| microseconds. Any
+// bytes reported with rpc_stats_add_bytes() since the last update are counted
+// toward this command.
+void rpc_stats_update(uint8_t command, uint32_t time_us);
+
+// Reports bytes of data moved by the command that is being executed.
+void rpc_stats_add_bytes(uint16_t num_bytes);
+
+uint8_t rpc_stats_read();
+
+#endif  // __RPC_STATS_H__
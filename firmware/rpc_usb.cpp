@@ -20,12 +20,13 @@
 #include "DuinoCube/rpc.h"
 #include "DuinoCube/rpc_usb.h"
 
+#include "rpc.h"
 #include "shmem.h"
 #include "usb.h"
 
 #include "rpc_usb.h"
 
-void rpc_usb_read_joystick() {
+uint8_t rpc_usb_read_joystick() {
   USB_JoystickState state;
   usb_read_joystick(&state);
 
@@ -34,5 +35,7 @@ void rpc_usb_read_joystick() {
   args.out.x = state.x;
   args.out.y = state.y;
 
-  shmem_write(RPC_OUTPUT_ARG_ADDR, &args.out, sizeof(args.out));
+  rpc_write_args(&args.out, sizeof(args.out));
+
+  return RPC_STATUS_OK;
 }
@@ -20,6 +20,6 @@
 #ifndef __RPC_USB_H__
 #define __RPC_USB_H__
 
-void rpc_usb_read_joystick();
+uint8_t rpc_usb_read_joystick();
 
 #endif  // __RPC_USB_H__
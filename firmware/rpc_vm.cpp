@@ -0,0 +1,112 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube remote procedure call functions for the script VM.
+
+#include "DuinoCube/mem.h"
+#include "DuinoCube/rpc.h"
+#include "DuinoCube/vm_defs.h"
+
+#include "rpc.h"
+#include "rpc_core.h"
+#include "vm.h"
+
+#include "rpc_vm.h"
+
+// The background script, and how it is run.
+static VM_Script vm_script;
+static uint8_t vm_mode = VM_MODE_STOPPED;
+// Number of times the background script has run since it was started.
+static uint16_t vm_num_runs;
+// Outcome of the last run of the background script.
+static VM_Result vm_result;
+// Whether the Core was in vertical blank, for rpc_core_vblank_started().
+static bool vm_in_vblank;
+
+uint8_t rpc_vm_run() {
+  RPC_VmRunArgs args;
+  rpc_read_args(&args.in, sizeof(args.in));
+
+  VM_Script script;
+  script.code_addr = args.in.code_addr;
+  script.code_size = args.in.code_size;
+  script.data_addr = args.in.data_addr;
+  script.max_steps = args.in.max_steps;
+
+  VM_Result result;
+  bool ok = vm_run(&script, &result);
+  args.out.error = result.error;
+  args.out.pc = result.pc;
+  args.out.num_steps = result.num_steps;
+
+  rpc_write_args(&args.out, sizeof(args.out));
+
+  return ok ? RPC_STATUS_OK : RPC_STATUS_FAILED;
+}
+
+uint8_t rpc_vm_start() {
+  RPC_VmStartArgs args;
+  rpc_read_args(&args.in, sizeof(args.in));
+
+  if (args.in.mode != VM_MODE_IDLE && args.in.mode != VM_MODE_VBLANK)
+    return RPC_STATUS_INVALID_ARGS;
+
+  vm_script.code_addr = args.in.code_addr;
+  vm_script.code_size = args.in.code_size;
+  vm_script.data_addr = args.in.data_addr;
+  vm_script.max_steps = args.in.max_steps;
+  vm_mode = args.in.mode;
+  vm_num_runs = 0;
+  vm_result.error = VM_ERROR_NONE;
+  vm_result.pc = 0;
+  vm_result.num_steps = 0;
+
+  // Do not run in the middle of a vertical blank. Wait for the next one.
+  vm_in_vblank = true;
+
+  return RPC_STATUS_OK;
+}
+
+uint8_t rpc_vm_stop() {
+  vm_mode = VM_MODE_STOPPED;
+  return RPC_STATUS_OK;
+}
+
+uint8_t rpc_vm_status() {
+  RPC_VmStatusArgs args;
+  args.out.mode = vm_mode;
+  args.out.num_runs = vm_num_runs;
+  args.out.error = vm_result.error;
+  args.out.pc = vm_result.pc;
+
+  rpc_write_args(&args.out, sizeof(args.out));
+
+  return RPC_STATUS_OK;
+}
+
+void rpc_vm_idle() {
+  if (vm_mode == VM_MODE_STOPPED)
+    return;
+
+  if (vm_mode == VM_MODE_VBLANK && !rpc_core_vblank_started(&vm_in_vblank))
+    return;
+
+  ++vm_num_runs;
+  // A script that fails would most likely fail again, so stop it.
+  if (!vm_run(&vm_script, &vm_result))
+    vm_mode = VM_MODE_STOPPED;
+}
@@ -0,0 +1,34 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube remote procedure call functions for the script VM.
+
+#ifndef __RPC_VM_H__
+#define __RPC_VM_H__
+
+#include <stdint.h>
+
+uint8_t rpc_vm_run();
+uint8_t rpc_vm_start();
+uint8_t rpc_vm_stop();
+uint8_t rpc_vm_status();
+
+// Runs the background script, if one has been started and it is due to run.
+// Called when the RPC server is idle.
+void rpc_vm_idle();
+
+#endif  // __RPC_VM_H__
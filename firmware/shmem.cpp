@@ -17,7 +17,7 @@
 
 // DuinoCube shared memory functions.
 
-#include <string.h>
+#include <stddef.h>
 
 #include "DuinoCube/mem.h"
 
@@ -34,19 +34,6 @@
 // operation.
 #define CORE_WRITE_BIT_MASK      0x80
 
-// Record of a block on the shared memory heap.
-struct HeapBlock {
-  // If |num_blocks_in_region| == 0, it means the is not the first block in a
-  // contiguous allocated or free region.  Only the first block in a same-status
-  // region will have this field set to the total number of blocks in that
-  // region.
-  uint8_t num_blocks_in_region:7;
-  uint8_t is_allocated:1;   // 0 = Free block, 1 = Allocated block.
-};
-
-#define NUM_HEAP_BLOCKS (SHARED_MEMORY_HEAP_SIZE / SHARED_MEMORY_BLOCK_SIZE)
-static HeapBlock heap_blocks[NUM_HEAP_BLOCKS];
-
 const char shmem_init_str0[] PROGMEM =
     "Shared memory heap initialized with %u bytes.\n";
 
@@ -56,9 +43,7 @@ void shmem_init() {
   spi_clear_ss(SELECT_CORE_BIT);
   DDRC |= (1 << SELECT_RAM_BIT) | (1 << SELECT_CORE_BIT);
 
-  // Initialize the heap.
-  memset(heap_blocks, 0, sizeof(heap_blocks));
-  heap_blocks[0].num_blocks_in_region = NUM_HEAP_BLOCKS;
+  shmem_heap_init();
 #ifdef DEBUG
   printf_P(shmem_init_str0, SHARED_MEMORY_HEAP_SIZE);
 #endif
@@ -69,9 +54,8 @@ void shmem_read(uint16_t addr, void* data, uint16_t len) {
   if (addr < SHARED_MEMORY_SIZE) {
     spi_set_ss(SELECT_RAM_BIT);
 
-    spi_tx(RAM_READ);
-    spi_tx(addr >> 8);
-    spi_tx((uint8_t) addr);
+    uint8_t header[] = { RAM_READ, (uint8_t)(addr >> 8), (uint8_t) addr };
+    spi_write(header, sizeof(header));
     spi_read(buf, len);
 
     spi_clear_ss(SELECT_RAM_BIT);
@@ -79,157 +63,150 @@ void shmem_read(uint16_t addr, void* data, uint16_t len) {
     spi_set_ss(SELECT_CORE_BIT);
 
     addr -= SHARED_MEMORY_SIZE;
-    spi_tx(addr >> 8);
-    spi_tx((uint8_t) addr);
+    uint8_t header[] = { (uint8_t)(addr >> 8), (uint8_t) addr };
+    spi_write(header, sizeof(header));
     spi_read(buf, len);
 
     spi_clear_ss(SELECT_CORE_BIT);
   }
 }
 
-void shmem_write(uint16_t addr, const void* data, uint16_t len) {
-  const char* buf = (const char*)data;
-
+// Selects the device that |addr| is on, and sends the header of a write to
+// |addr|. The data follows, and then end_write().
+static void begin_write(uint16_t addr) {
   if (addr < SHARED_MEMORY_SIZE) {
     // Writing to generic shared memory.
     spi_set_ss(SELECT_RAM_BIT);
 
-    spi_tx(RAM_WRITE);
-    spi_tx(addr >> 8);
-    spi_tx((uint8_t) addr);
-    spi_write(buf, len);
-    spi_clear_ss(SELECT_RAM_BIT);
+    uint8_t header[] = { RAM_WRITE, (uint8_t)(addr >> 8), (uint8_t) addr };
+    spi_write(header, sizeof(header));
   } else {
     // Writing to core memory space.
     spi_set_ss(SELECT_CORE_BIT);
     addr = (addr - SHARED_MEMORY_SIZE);
 
-    spi_tx((addr >> 8) | CORE_WRITE_BIT_MASK);
-    spi_tx((uint8_t) addr);
-    spi_write(buf, len);
-    spi_clear_ss(SELECT_CORE_BIT);
+    uint8_t header[] = {
+      (uint8_t)((addr >> 8) | CORE_WRITE_BIT_MASK), (uint8_t) addr
+    };
+    spi_write(header, sizeof(header));
   }
 }
 
-void shmem_stat(uint16_t* total_free_size, uint16_t* largest_free_size) {
-  uint16_t num_free_blocks = 0;
-  uint16_t largest_free_region_num_blocks = 0;
-  uint16_t current_free_region_num_blocks = 0;
-  for (uint16_t i = 0;
-       i < NUM_HEAP_BLOCKS && heap_blocks[i].num_blocks_in_region > 0;
-       i += heap_blocks[i].num_blocks_in_region) {
-    const HeapBlock& block = heap_blocks[i];
-    if (!block.is_allocated) {
-      // Count the number of free blocks.
-      num_free_blocks += block.num_blocks_in_region;
-      current_free_region_num_blocks += block.num_blocks_in_region;
-      // Save the current region size if it is the largest so far.
-      if (current_free_region_num_blocks > largest_free_region_num_blocks)
-        largest_free_region_num_blocks = current_free_region_num_blocks;
-      continue;
-    }
-    // When the iteration encounters an allocated block, reset the current
-    // region counter.
-    current_free_region_num_blocks = 0;
-  }
+static void end_write(uint16_t addr) {
+  spi_clear_ss((addr < SHARED_MEMORY_SIZE) ? SELECT_RAM_BIT : SELECT_CORE_BIT);
+}
 
-  if (total_free_size)
-    *total_free_size = num_free_blocks * SHARED_MEMORY_BLOCK_SIZE;
-  if (largest_free_size) {
-    *largest_free_size =
-        largest_free_region_num_blocks * SHARED_MEMORY_BLOCK_SIZE;
-  }
+void shmem_write(uint16_t addr, const void* data, uint16_t len) {
+  begin_write(addr);
+  spi_write(data, len);
+  end_write(addr);
 }
 
-uint16_t shmem_alloc(uint16_t size) {
-  if (size == 0)
-    return (uint16_t) NULL;
-  uint16_t i;
-  uint16_t num_blocks_to_alloc =
-      (size + SHARED_MEMORY_BLOCK_SIZE - 1)/ SHARED_MEMORY_BLOCK_SIZE;
-  for (i = 0;
-       i < NUM_HEAP_BLOCKS && heap_blocks[i].num_blocks_in_region > 0;
-       i += heap_blocks[i].num_blocks_in_region) {
-    const HeapBlock& block = heap_blocks[i];
-    // Skip blocks that are not free or are too small.
-    // This will return the first block that fits.  It may not be the smallest
-    // block that fits.
-    if (!block.is_allocated &&
-        block.num_blocks_in_region >= num_blocks_to_alloc) {
-      break;
-    }
-  }
+void shmem_fill(uint16_t addr, uint16_t value, uint16_t len) {
+  begin_write(addr);
+  spi_fill(value, len);
+  end_write(addr);
+}
 
-  // Return NULL if no free region was found.  The heap should not start at 0.
-  if (i == NUM_HEAP_BLOCKS)
-    return (uint16_t) NULL;
-  // When a block has been found, mark it as allocated, along with subsequent
-  // blocks in the allocated region.
-  if (heap_blocks[i].num_blocks_in_region > num_blocks_to_alloc) {
-    // Mark extra unallocated blocks at the end if there are any.
-    heap_blocks[i + num_blocks_to_alloc].num_blocks_in_region =
-        heap_blocks[i].num_blocks_in_region - num_blocks_to_alloc;
+// Size of the buffer through which data is moved in shared memory.
+#define MOVE_BUFFER_SIZE    64
+
+void shmem_move(uint16_t dst, uint16_t src, uint16_t len) {
+  // Moving forward never overwrites source data before it has been read, as
+  // long as |dst| is below |src| or the regions do not overlap.
+  char buf[MOVE_BUFFER_SIZE];
+  while (len > 0) {
+    uint16_t size = (len < sizeof(buf)) ? len : sizeof(buf);
+    shmem_read(src, buf, size);
+    shmem_write(dst, buf, size);
+    src += size;
+    dst += size;
+    len -= size;
   }
-  heap_blocks[i].num_blocks_in_region = num_blocks_to_alloc;
-  for (uint16_t j = i; j < i + num_blocks_to_alloc; ++j)
-    heap_blocks[j].is_allocated = true;
-  return i * SHARED_MEMORY_BLOCK_SIZE + SHARED_MEMORY_HEAP_START;
 }
 
-const char shmem_free_str0[] PROGMEM = "%s: Invalid address: 0x%04x\n";
-const char shmem_free_str1[] PROGMEM =
-    "%s: Not an allocated head block: 0x%04x\n";
+// Returns the number of bytes in the ring buffer described by |header|.
+static uint16_t get_ring_read_size(const RingBufferHeader& header) {
+  return (header.head >= header.tail) ?
+      (header.head - header.tail) : (header.size - header.tail + header.head);
+}
 
-void shmem_free(uint16_t addr) {
-  // Do not attempt to free a non-aligned address.
-  // Do not attempt to free a non-heap address.
-  if (addr % SHARED_MEMORY_BLOCK_SIZE != 0 ||
-      addr < SHARED_MEMORY_HEAP_START) {
-#ifdef DEBUG
-    printf_P(shmem_free_str0, __func__, addr);
-#endif
-    return;
-  }
-  uint16_t block_index =
-      (addr - SHARED_MEMORY_HEAP_START)/ SHARED_MEMORY_BLOCK_SIZE;
-  // Make sure the given address actually points to the start of an allocated
-  // region in the heap.
-  if (!heap_blocks[block_index].is_allocated) {
-#ifdef DEBUG
-    printf_P(shmem_free_str1, __func__, addr);
-#endif
-    return;
-  }
-  uint16_t num_blocks = heap_blocks[block_index].num_blocks_in_region;
-  // Clear the allocated flags.
-  memset(heap_blocks + block_index, 0, num_blocks * sizeof(*heap_blocks));
-  heap_blocks[block_index].num_blocks_in_region = num_blocks;
-
-  // If the next block is also free, merge the two blocks.
-  if (block_index + num_blocks < NUM_HEAP_BLOCKS &&
-      !heap_blocks[block_index + num_blocks].is_allocated) {
-    heap_blocks[block_index].num_blocks_in_region +=
-        heap_blocks[block_index + num_blocks].num_blocks_in_region;
-    heap_blocks[block_index + num_blocks].num_blocks_in_region = 0;
-  }
+// Returns the number of bytes that can be added to the ring buffer described by
+// |header|. One byte is always left unused, so that a full buffer is not
+// mistaken for an empty one.
+static uint16_t get_ring_write_size(const RingBufferHeader& header) {
+  return header.size - 1 - get_ring_read_size(header);
+}
 
-  // If the previous block is also free, merge the two blocks.
-  if (block_index == 0)   // This means there's no previous block.
-    return;
-  // This means the previous block is not free.
-  if (heap_blocks[block_index - 1].is_allocated)
-    return;
-  for (uint16_t i = block_index - 1; true; --i) {
-    if (heap_blocks[i].num_blocks_in_region == 0) {
-      if (i > 0)
-        continue;
-      break;
-    }
-    // There must be a previous block whose head is heap_blocks[i] if this code
-    // is reached.
-    heap_blocks[i].num_blocks_in_region +=
-        heap_blocks[block_index].num_blocks_in_region;
-    heap_blocks[block_index].num_blocks_in_region = 0;
-    break;
-  }
+void shmem_ring_init(uint16_t addr, uint16_t size) {
+  RingBufferHeader header;
+  header.head = 0;
+  header.tail = 0;
+  header.size = size;
+  shmem_write(addr, &header, sizeof(header));
+}
+
+uint16_t shmem_ring_get_write_size(uint16_t addr) {
+  RingBufferHeader header;
+  shmem_read(addr, &header, sizeof(header));
+  return get_ring_write_size(header);
+}
+
+uint16_t shmem_ring_get_read_size(uint16_t addr) {
+  RingBufferHeader header;
+  shmem_read(addr, &header, sizeof(header));
+  return get_ring_read_size(header);
+}
+
+uint16_t shmem_ring_write(uint16_t addr, const void* data, uint16_t len) {
+  RingBufferHeader header;
+  shmem_read(addr, &header, sizeof(header));
+  uint16_t room = get_ring_write_size(header);
+  if (len > room)
+    len = room;
+  if (len == 0)
+    return 0;
+
+  // The data may wrap around the end.
+  uint16_t data_addr = addr + RING_BUFFER_HEADER_SIZE;
+  uint16_t first_len = header.size - header.head;
+  if (first_len > len)
+    first_len = len;
+  shmem_write(data_addr + header.head, data, first_len);
+  if (len > first_len)
+    shmem_write(data_addr, (const char*)data + first_len, len - first_len);
+
+  // Publish the data only once it has been written.
+  header.head += len;
+  if (header.head >= header.size)
+    header.head -= header.size;
+  shmem_write(addr + offsetof(RingBufferHeader, head), &header.head,
+              sizeof(header.head));
+  return len;
+}
+
+uint16_t shmem_ring_read(uint16_t addr, void* data, uint16_t len) {
+  RingBufferHeader header;
+  shmem_read(addr, &header, sizeof(header));
+  uint16_t available = get_ring_read_size(header);
+  if (len > available)
+    len = available;
+  if (len == 0)
+    return 0;
+
+  uint16_t data_addr = addr + RING_BUFFER_HEADER_SIZE;
+  uint16_t first_len = header.size - header.tail;
+  if (first_len > len)
+    first_len = len;
+  shmem_read(data_addr + header.tail, data, first_len);
+  if (len > first_len)
+    shmem_read(data_addr, (char*)data + first_len, len - first_len);
+
+  // Free up the space only once the data has been read.
+  header.tail += len;
+  if (header.tail >= header.size)
+    header.tail -= header.size;
+  shmem_write(addr + offsetof(RingBufferHeader, tail), &header.tail,
+              sizeof(header.tail));
+  return len;
 }
@@ -29,9 +29,54 @@ void shmem_init();
 void shmem_read(uint16_t addr, void* data, uint16_t len);
 void shmem_write(uint16_t addr, const void* data, uint16_t len);
 
-// Shared memory allocation functions.
-void shmem_stat(uint16_t* total_free_size, uint16_t* largest_free_size);
+// Fills |len| bytes at |addr| with the 16-bit pattern |value| in a single SPI
+// transaction. Like shmem_write(), |addr| can be in shared memory or Core
+// space, but the range must not cross between them.
+void shmem_fill(uint16_t addr, uint16_t value, uint16_t len);
+
+// Stats about the shared memory heap.
+struct ShmemHeapStats {
+  uint16_t total_free_size;     // Number of bytes free, including free objects
+                                // in slabs.
+  uint16_t largest_free_size;   // Size in bytes of the largest free region.
+  uint16_t num_free_regions;    // Number of separate free regions.
+  uint16_t slab_size;           // Number of bytes used by slabs.
+  uint16_t slab_free_size;      // Number of bytes free in slabs.
+  uint16_t high_water_size;     // Most bytes that have been allocated at once.
+};
+
+// Shared memory allocation functions, in shmem_heap.cpp. Returns false if
+// |addr| is not an allocated address.
+void shmem_heap_init();
+void shmem_stat(ShmemHeapStats* stats);
 uint16_t shmem_alloc(uint16_t size);
-void shmem_free(uint16_t addr);
+bool shmem_free(uint16_t addr);
+
+// Relocatable allocation functions, in shmem_heap.cpp. A relocatable region is
+// referred to by a nonzero handle, and may be moved when the heap is compacted
+// unless it is locked. shmem_lock() returns its current address, or NULL if
+// |handle| is invalid. Locks nest. The other functions return 0 or false if
+// they fail.
+uint16_t shmem_alloc_handle(uint16_t size);
+bool shmem_free_handle(uint16_t handle);
+uint16_t shmem_lock(uint16_t handle);
+bool shmem_unlock(uint16_t handle);
+void shmem_compact();
+
+// Copies |len| bytes within the coprocessor's view of shared memory and the
+// Core, from |src| to |dst|. The regions may only overlap if |dst| is below
+// |src|, as in heap compaction.
+void shmem_move(uint16_t dst, uint16_t src, uint16_t len);
+
+// Coprocessor side of ring buffers in shared memory. See RingBufferHeader in
+// DuinoCube/mem.h. shmem_ring_init() sets up an empty ring buffer at |addr|
+// with |size| bytes of data, for when the coprocessor owns the ring buffer.
+// The write and read functions move as many bytes as they can, up to |len|,
+// and return the number of bytes moved.
+void shmem_ring_init(uint16_t addr, uint16_t size);
+uint16_t shmem_ring_write(uint16_t addr, const void* data, uint16_t len);
+uint16_t shmem_ring_read(uint16_t addr, void* data, uint16_t len);
+uint16_t shmem_ring_get_write_size(uint16_t addr);
+uint16_t shmem_ring_get_read_size(uint16_t addr);
 
 #endif  // __SHMEM_H__
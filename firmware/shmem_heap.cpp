@@ -0,0 +1,444 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube shared memory heap.
+//
+// Allocations of up to SHARED_MEMORY_SLAB_MAX_SIZE bytes are rounded up to a
+// power of two size class and carved from slabs. Each slab is one heap block
+// that holds objects of one size class. Larger allocations take a contiguous
+// region of whole blocks, chosen by best fit.
+//
+// Regions allocated through a handle are relocatable. They are not used
+// directly by address, but are locked to get their current address. When an
+// allocation does not fit, the heap is compacted by moving unlocked handle
+// regions down into the free space below them.
+//
+// The heap records are kept in coprocessor RAM and shared memory itself is
+// only accessed through shmem_move(), so this file can also be built on Linux
+// by utils/membench.
+
+#include <string.h>
+
+#include "DuinoCube/mem.h"
+
+#include "shmem.h"
+
+// Record of a block on the shared memory heap.
+struct HeapBlock {
+  // If |num_blocks_in_region| == 0, it means the is not the first block in a
+  // contiguous allocated or free region.  Only the first block in a same-status
+  // region will have this field set to the total number of blocks in that
+  // region.  The last block of a free region also has it set, so that a region
+  // being freed can be merged with the free region before it right away.
+  uint8_t num_blocks_in_region:7;
+  uint8_t is_allocated:1;   // 0 = Free block, 1 = Allocated block.
+};
+
+#define NUM_HEAP_BLOCKS (SHARED_MEMORY_HEAP_SIZE / SHARED_MEMORY_BLOCK_SIZE)
+static HeapBlock heap_blocks[NUM_HEAP_BLOCKS];
+
+// Max number of slabs. Once they are all in use, small allocations that do not
+// fit in an existing slab take a whole block.
+#define NUM_SLABS               32
+// Value of |Slab::block| for unused slab records.
+#define NO_SLAB               0xff
+// log2 of SHARED_MEMORY_SLAB_MIN_SIZE.
+#define SLAB_MIN_SIZE_SHIFT      4
+
+// Record of a slab. There are at most 16 objects per slab.
+struct Slab {
+  uint8_t block;            // Index of the heap block, or NO_SLAB.
+  uint8_t size_shift;       // log2 of the object size.
+  uint16_t used_mask;       // One bit per object, set if allocated.
+};
+
+static Slab slabs[NUM_SLABS];
+
+// Max number of relocatable regions.
+#define NUM_HANDLES             32
+// Value of |Handle::block| for unused handle records.
+#define NO_HANDLE             0xff
+
+// Record of a relocatable region. Handle values are the index of the record
+// plus one, so that 0 is never a valid handle.
+struct Handle {
+  uint8_t block;            // Index of the first heap block, or NO_HANDLE.
+  uint8_t lock_count;       // The region is not moved while this is nonzero.
+};
+
+static Handle handles[NUM_HANDLES];
+
+// Number of bytes allocated, counting slab objects at their size class, and
+// the most that has been allocated since the heap was initialized.
+static uint16_t allocated_size;
+static uint16_t high_water_size;
+
+static void add_allocated_size(uint16_t size) {
+  allocated_size += size;
+  if (allocated_size > high_water_size)
+    high_water_size = allocated_size;
+}
+
+static uint16_t get_block_addr(uint8_t index) {
+  return index * SHARED_MEMORY_BLOCK_SIZE + SHARED_MEMORY_HEAP_START;
+}
+
+// Marks |num_blocks| blocks starting at |index| as one region.
+static void set_region(uint8_t index, uint8_t num_blocks, bool is_allocated) {
+  memset(heap_blocks + index, 0, num_blocks * sizeof(*heap_blocks));
+  heap_blocks[index].num_blocks_in_region = num_blocks;
+  if (is_allocated) {
+    for (uint8_t i = index; i < index + num_blocks; ++i)
+      heap_blocks[i].is_allocated = true;
+  } else {
+    heap_blocks[index + num_blocks - 1].num_blocks_in_region = num_blocks;
+  }
+}
+
+// Allocates a region of |num_blocks| blocks. Returns the index of the first
+// block, or NUM_HEAP_BLOCKS if there is no free region that is large enough.
+static uint8_t alloc_blocks(uint16_t num_blocks) {
+  if (num_blocks == 0 || num_blocks > NUM_HEAP_BLOCKS)
+    return NUM_HEAP_BLOCKS;
+
+  // Use the smallest free region that fits, so that large regions are kept
+  // for large allocations.
+  uint8_t best = NUM_HEAP_BLOCKS;
+  for (uint8_t i = 0;
+       i < NUM_HEAP_BLOCKS && heap_blocks[i].num_blocks_in_region > 0;
+       i += heap_blocks[i].num_blocks_in_region) {
+    const HeapBlock& block = heap_blocks[i];
+    if (block.is_allocated || block.num_blocks_in_region < num_blocks)
+      continue;
+    if (best == NUM_HEAP_BLOCKS ||
+        block.num_blocks_in_region < heap_blocks[best].num_blocks_in_region) {
+      best = i;
+      if (block.num_blocks_in_region == num_blocks)
+        break;
+    }
+  }
+  if (best == NUM_HEAP_BLOCKS)
+    return NUM_HEAP_BLOCKS;
+
+  // Keep the rest of the region free.
+  uint8_t region_size = heap_blocks[best].num_blocks_in_region;
+  set_region(best, num_blocks, true);
+  if (region_size > num_blocks)
+    set_region(best + num_blocks, region_size - num_blocks, false);
+  return best;
+}
+
+// Frees the region starting at block |index|, and merges it with the free
+// regions on either side.
+static void free_blocks(uint8_t index) {
+  uint8_t start = index;
+  uint8_t num_blocks = heap_blocks[index].num_blocks_in_region;
+
+  uint8_t next = index + num_blocks;
+  if (next < NUM_HEAP_BLOCKS && !heap_blocks[next].is_allocated)
+    num_blocks += heap_blocks[next].num_blocks_in_region;
+
+  // The block before this one is the last block of the previous region.
+  if (index > 0 && !heap_blocks[index - 1].is_allocated) {
+    uint8_t prev_size = heap_blocks[index - 1].num_blocks_in_region;
+    start -= prev_size;
+    num_blocks += prev_size;
+  }
+
+  set_region(start, num_blocks, false);
+}
+
+// Returns the handle record of the region that starts at block |index|, or
+// NULL if it is not relocatable.
+static Handle* find_handle(uint8_t index) {
+  for (uint8_t i = 0; i < NUM_HANDLES; ++i) {
+    if (handles[i].block == index)
+      return &handles[i];
+  }
+  return NULL;
+}
+
+// Returns the record of |handle|, or NULL if it is not an allocated handle.
+static Handle* get_handle(uint16_t handle) {
+  if (handle == 0 || handle > NUM_HANDLES ||
+      handles[handle - 1].block == NO_HANDLE) {
+    return NULL;
+  }
+  return &handles[handle - 1];
+}
+
+// Moves unlocked relocatable regions down into the free regions below them, so
+// that free space collects into larger regions. Returns true if any region was
+// moved.
+static bool compact() {
+  bool moved = false;
+  uint8_t i = 0;
+  while (i < NUM_HEAP_BLOCKS) {
+    uint8_t num_blocks = heap_blocks[i].num_blocks_in_region;
+    if (heap_blocks[i].is_allocated) {
+      i += num_blocks;
+      continue;
+    }
+
+    // Free regions are always merged, so the next region is allocated.
+    uint8_t next = i + num_blocks;
+    if (next >= NUM_HEAP_BLOCKS)
+      break;
+    uint8_t next_num_blocks = heap_blocks[next].num_blocks_in_region;
+    Handle* handle = find_handle(next);
+    if (!handle || handle->lock_count > 0) {
+      i = next + next_num_blocks;
+      continue;
+    }
+
+    // Swap the region with the free space before it, and merge the free space
+    // with the region after it, if that is free too.
+    shmem_move(get_block_addr(i), get_block_addr(next),
+               next_num_blocks * SHARED_MEMORY_BLOCK_SIZE);
+    handle->block = i;
+    set_region(i, next_num_blocks, true);
+
+    uint8_t free_start = i + next_num_blocks;
+    uint8_t free_end = next + next_num_blocks;
+    if (free_end < NUM_HEAP_BLOCKS && !heap_blocks[free_end].is_allocated)
+      free_end += heap_blocks[free_end].num_blocks_in_region;
+    set_region(free_start, free_end - free_start, false);
+
+    i = free_start;
+    moved = true;
+  }
+  return moved;
+}
+
+// Returns a mask with one bit set for each object in a slab.
+static uint16_t get_slab_full_mask(uint8_t size_shift) {
+  uint8_t num_objects = SHARED_MEMORY_BLOCK_SIZE >> size_shift;
+  return (num_objects >= 16) ? 0xffff : ((1 << num_objects) - 1);
+}
+
+// Allocates an object of |size| bytes from a slab. Returns NULL if there is no
+// slab with room, and a new slab could not be set up.
+static uint16_t alloc_from_slab(uint16_t size) {
+  uint8_t size_shift = SLAB_MIN_SIZE_SHIFT;
+  while ((1 << size_shift) < size)
+    ++size_shift;
+  uint16_t full_mask = get_slab_full_mask(size_shift);
+
+  Slab* slab = NULL;
+  Slab* unused_slab = NULL;
+  for (uint8_t i = 0; i < NUM_SLABS && !slab; ++i) {
+    if (slabs[i].block == NO_SLAB) {
+      if (!unused_slab)
+        unused_slab = &slabs[i];
+    } else if (slabs[i].size_shift == size_shift &&
+               slabs[i].used_mask != full_mask) {
+      slab = &slabs[i];
+    }
+  }
+
+  if (!slab) {
+    if (!unused_slab)
+      return (uint16_t) NULL;
+    uint8_t block = alloc_blocks(1);
+    if (block == NUM_HEAP_BLOCKS && compact())
+      block = alloc_blocks(1);
+    if (block == NUM_HEAP_BLOCKS)
+      return (uint16_t) NULL;
+    slab = unused_slab;
+    slab->block = block;
+    slab->size_shift = size_shift;
+    slab->used_mask = 0;
+  }
+
+  uint8_t object = 0;
+  while (slab->used_mask & (1 << object))
+    ++object;
+  slab->used_mask |= (1 << object);
+  add_allocated_size(1 << size_shift);
+  return get_block_addr(slab->block) + (object << size_shift);
+}
+
+// Returns the slab that uses block |index|, or NULL if it is not a slab.
+static Slab* find_slab(uint8_t index) {
+  for (uint8_t i = 0; i < NUM_SLABS; ++i) {
+    if (slabs[i].block == index)
+      return &slabs[i];
+  }
+  return NULL;
+}
+
+// Allocates a region of |size| bytes, compacting the heap if there is no free
+// region that is large enough. Returns NUM_HEAP_BLOCKS if it does not fit.
+static uint8_t alloc_region(uint16_t size) {
+  uint16_t num_blocks =
+      (size + SHARED_MEMORY_BLOCK_SIZE - 1) / SHARED_MEMORY_BLOCK_SIZE;
+  uint8_t index = alloc_blocks(num_blocks);
+  if (index == NUM_HEAP_BLOCKS && compact())
+    index = alloc_blocks(num_blocks);
+  if (index != NUM_HEAP_BLOCKS)
+    add_allocated_size(num_blocks * SHARED_MEMORY_BLOCK_SIZE);
+  return index;
+}
+
+// Frees the region starting at block |index|.
+static void free_region(uint8_t index) {
+  allocated_size -=
+      heap_blocks[index].num_blocks_in_region * SHARED_MEMORY_BLOCK_SIZE;
+  free_blocks(index);
+}
+
+void shmem_heap_init() {
+  set_region(0, NUM_HEAP_BLOCKS, false);
+  for (uint8_t i = 0; i < NUM_SLABS; ++i)
+    slabs[i].block = NO_SLAB;
+  for (uint8_t i = 0; i < NUM_HANDLES; ++i)
+    handles[i].block = NO_HANDLE;
+  allocated_size = 0;
+  high_water_size = 0;
+}
+
+void shmem_stat(ShmemHeapStats* stats) {
+  memset(stats, 0, sizeof(*stats));
+
+  uint16_t num_free_blocks = 0;
+  uint8_t largest_free_region_num_blocks = 0;
+  for (uint8_t i = 0;
+       i < NUM_HEAP_BLOCKS && heap_blocks[i].num_blocks_in_region > 0;
+       i += heap_blocks[i].num_blocks_in_region) {
+    const HeapBlock& block = heap_blocks[i];
+    if (block.is_allocated)
+      continue;
+    num_free_blocks += block.num_blocks_in_region;
+    ++stats->num_free_regions;
+    if (block.num_blocks_in_region > largest_free_region_num_blocks)
+      largest_free_region_num_blocks = block.num_blocks_in_region;
+  }
+
+  for (uint8_t i = 0; i < NUM_SLABS; ++i) {
+    const Slab& slab = slabs[i];
+    if (slab.block == NO_SLAB)
+      continue;
+    stats->slab_size += SHARED_MEMORY_BLOCK_SIZE;
+    uint16_t free_mask = ~slab.used_mask & get_slab_full_mask(slab.size_shift);
+    for (; free_mask; free_mask >>= 1) {
+      if (free_mask & 1)
+        stats->slab_free_size += (1 << slab.size_shift);
+    }
+  }
+
+  stats->total_free_size =
+      num_free_blocks * SHARED_MEMORY_BLOCK_SIZE + stats->slab_free_size;
+  stats->largest_free_size =
+      largest_free_region_num_blocks * SHARED_MEMORY_BLOCK_SIZE;
+  stats->high_water_size = high_water_size;
+}
+
+uint16_t shmem_alloc(uint16_t size) {
+  if (size == 0)
+    return (uint16_t) NULL;
+
+  if (size <= SHARED_MEMORY_SLAB_MAX_SIZE) {
+    uint16_t addr = alloc_from_slab(size);
+    if (addr)
+      return addr;
+  }
+
+  uint8_t index = alloc_region(size);
+  // The heap should not start at 0, so NULL means that the allocation failed.
+  if (index == NUM_HEAP_BLOCKS)
+    return (uint16_t) NULL;
+  return get_block_addr(index);
+}
+
+bool shmem_free(uint16_t addr) {
+  // Do not attempt to free a non-heap address.
+  if (addr < SHARED_MEMORY_HEAP_START || addr >= SHARED_MEMORY_SIZE)
+    return false;
+  uint8_t index = (addr - SHARED_MEMORY_HEAP_START) / SHARED_MEMORY_BLOCK_SIZE;
+  uint16_t offset = (addr - SHARED_MEMORY_HEAP_START) % SHARED_MEMORY_BLOCK_SIZE;
+
+  Slab* slab = find_slab(index);
+  if (slab) {
+    uint16_t object_bit = 1 << (offset >> slab->size_shift);
+    // Make sure that the address is an allocated object in the slab.
+    if (offset % (1 << slab->size_shift) != 0 ||
+        !(slab->used_mask & object_bit)) {
+      return false;
+    }
+    slab->used_mask &= ~object_bit;
+    allocated_size -= (1 << slab->size_shift);
+    // Return the block to the heap once the slab is empty.
+    if (slab->used_mask == 0) {
+      slab->block = NO_SLAB;
+      free_blocks(index);
+    }
+    return true;
+  }
+
+  // Make sure the given address actually points to the start of an allocated
+  // region in the heap, which is not owned by a handle.
+  if (offset != 0 || !heap_blocks[index].is_allocated ||
+      heap_blocks[index].num_blocks_in_region == 0 || find_handle(index)) {
+    return false;
+  }
+  free_region(index);
+  return true;
+}
+
+uint16_t shmem_alloc_handle(uint16_t size) {
+  if (size == 0)
+    return 0;
+
+  Handle* handle = find_handle(NO_HANDLE);
+  if (!handle)
+    return 0;
+  uint8_t index = alloc_region(size);
+  if (index == NUM_HEAP_BLOCKS)
+    return 0;
+  handle->block = index;
+  handle->lock_count = 0;
+  return handle - handles + 1;
+}
+
+bool shmem_free_handle(uint16_t handle) {
+  Handle* record = get_handle(handle);
+  if (!record)
+    return false;
+  free_region(record->block);
+  record->block = NO_HANDLE;
+  return true;
+}
+
+uint16_t shmem_lock(uint16_t handle) {
+  Handle* record = get_handle(handle);
+  if (!record)
+    return (uint16_t) NULL;
+  ++record->lock_count;
+  return get_block_addr(record->block);
+}
+
+bool shmem_unlock(uint16_t handle) {
+  Handle* record = get_handle(handle);
+  if (!record || record->lock_count == 0)
+    return false;
+  --record->lock_count;
+  return true;
+}
+
+void shmem_compact() {
+  compact();
+}
@@ -0,0 +1,132 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// Saves the state of the Core and shared memory to a file.
+
+#include <avr/pgmspace.h>
+
+#include "DuinoCube/mem.h"
+#include "DuinoCube/snapshot.h"
+#include "DuinoCube/xaddr.h"
+#include "FatFS/ff.h"
+
+#include "crc32.h"
+#include "file.h"
+#include "xmem.h"
+
+#include "snapshot.h"
+
+// Size of the buffer through which data is streamed to the file. A multiple of
+// the 512-byte SD card sector size divides into it evenly.
+#define SNAPSHOT_BUFFER_SIZE    128
+// Number of bytes saved between calls to the yield function.
+#define SNAPSHOT_YIELD_SIZE    4096
+
+// Sections in the order in which they are saved. The Core registers are saved
+// before the banks, so that they are saved before any bank is selected.
+static const uint32_t section_addrs[SNAPSHOT_NUM_SECTIONS] PROGMEM = {
+  XADDR_SHMEM(0),
+  XADDR_CORE(0),
+  XADDR_TILEMAP(0),
+};
+static const uint32_t section_sizes[SNAPSHOT_NUM_SECTIONS] PROGMEM = {
+  SHARED_MEMORY_SIZE,
+  XADDR_CORE_SIZE,
+  SNAPSHOT_BANKS_SIZE,
+};
+
+// Writes |size| bytes to |handle|. Returns false if they were not all written.
+static bool write_data(uint16_t handle, const void* data, uint16_t size) {
+  return file_write(handle, data, size) == size;
+}
+
+// Streams the data of |section| to |handle|, and computes its CRC.
+static uint8_t save_section(uint16_t handle, SnapshotSection* section,
+                            bool (*yield)()) {
+  uint8_t buf[SNAPSHOT_BUFFER_SIZE];
+  uint32_t addr = section->addr;
+  uint32_t remaining = section->size;
+  uint16_t size_since_yield = 0;
+  uint8_t result = SNAPSHOT_OK;
+
+  section->crc = CRC32_INIT;
+  xmem_begin();
+  while (remaining > 0) {
+    // Chunks never cross a bank boundary, since the banks are a multiple of the
+    // buffer size.
+    uint16_t size = (remaining < sizeof(buf)) ? remaining : sizeof(buf);
+    xmem_read(addr, buf, size);
+    section->crc = crc32_update(section->crc, buf, size);
+    if (!write_data(handle, buf, size)) {
+      result = SNAPSHOT_FILE_ERROR;
+      break;
+    }
+    addr += size;
+    remaining -= size;
+
+    size_since_yield += size;
+    if (yield && remaining > 0 && size_since_yield >= SNAPSHOT_YIELD_SIZE) {
+      size_since_yield = 0;
+      xmem_end();
+      bool canceled = yield();
+      xmem_begin();
+      if (canceled) {
+        result = SNAPSHOT_CANCELED;
+        break;
+      }
+    }
+  }
+  xmem_end();
+
+  return result;
+}
+
+uint8_t snapshot_save(const char* filename, bool (*yield)()) {
+  uint16_t handle = file_open(filename, FA_WRITE | FA_CREATE_ALWAYS);
+  if (!handle)
+    return SNAPSHOT_FILE_ERROR;
+
+  SnapshotHeader header;
+  header.magic = SNAPSHOT_MAGIC;
+  header.version = SNAPSHOT_VERSION;
+  header.num_sections = SNAPSHOT_NUM_SECTIONS;
+
+  SnapshotSection sections[SNAPSHOT_NUM_SECTIONS];
+  for (uint8_t i = 0; i < SNAPSHOT_NUM_SECTIONS; ++i) {
+    sections[i].addr = pgm_read_dword(&section_addrs[i]);
+    sections[i].size = pgm_read_dword(&section_sizes[i]);
+    sections[i].crc = 0;
+  }
+
+  // The section table is written again once the CRCs are known.
+  uint8_t result = SNAPSHOT_OK;
+  if (!write_data(handle, &header, sizeof(header)) ||
+      !write_data(handle, sections, sizeof(sections))) {
+    result = SNAPSHOT_FILE_ERROR;
+  }
+  for (uint8_t i = 0; result == SNAPSHOT_OK && i < SNAPSHOT_NUM_SECTIONS; ++i)
+    result = save_section(handle, &sections[i], yield);
+
+  if (result == SNAPSHOT_OK) {
+    file_seek(handle, sizeof(header));
+    if (!write_data(handle, sections, sizeof(sections)))
+      result = SNAPSHOT_FILE_ERROR;
+  }
+  file_close(handle);
+
+  return result;
+}
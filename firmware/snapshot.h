@@ -0,0 +1,38 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// Saves the state of the Core and shared memory to a file. See
+// DuinoCube/snapshot.h for the file format.
+
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <stdint.h>
+
+// Results of snapshot_save().
+enum {
+  SNAPSHOT_OK,
+  SNAPSHOT_FILE_ERROR,          // The file could not be created or written.
+  SNAPSHOT_CANCELED,            // |yield| asked for the snapshot to stop.
+};
+
+// Saves a snapshot to |filename|, replacing any existing file. If |yield| is
+// not NULL, it is called regularly while saving, with the client's view of the
+// Core restored, and saving stops if it returns true. Returns SNAPSHOT_*.
+uint8_t snapshot_save(const char* filename, bool (*yield)());
+
+#endif  // __SNAPSHOT_H__
@@ -58,21 +58,55 @@ uint8_t spi_tx(uint8_t value) {
   return SPDR;
 }
 
+// The burst functions below keep the next byte ready in a register, so that it
+// is loaded into SPDR as soon as SPIF is set, instead of once the loop has come
+// back around. At F_CPU / 2, a byte takes 16 cycles to shift out, which is
+// enough to hide the rest of the loop, so there is nothing to gain from
+// unrolling it.
+
 void spi_write(const void* data, uint16_t size) {
+  if (size == 0)
+    return;
   const uint8_t* buf = reinterpret_cast<const uint8_t*>(data);
-  for (uint16_t i = 0; i < size; ++i) {
-    SPDR = *buf++;
+  SPDR = *buf++;
+  while (--size > 0) {
+    uint8_t value = *buf++;
     while(!(SPSR & (1 << SPIF)));
+    SPDR = value;
   }
+  while(!(SPSR & (1 << SPIF)));
 }
 
 void spi_read(void* data, uint16_t size) {
+  if (size == 0)
+    return;
   uint8_t* buf = reinterpret_cast<uint8_t*>(data);
-  for (uint16_t i = 0; i < size; ++i) {
+  SPDR = 0;
+  while (--size > 0) {
+    // The received byte must be read out before the next one has been shifted
+    // in, so start the next byte right after reading it.
+    while(!(SPSR & (1 << SPIF)));
+    uint8_t value = SPDR;
     SPDR = 0;
+    *buf++ = value;
+  }
+  while(!(SPSR & (1 << SPIF)));
+  *buf = SPDR;
+}
+
+void spi_fill(uint16_t value, uint16_t size) {
+  if (size == 0)
+    return;
+  uint8_t bytes[] = { (uint8_t) value, (uint8_t)(value >> 8) };
+  uint8_t index = 0;
+  SPDR = bytes[0];
+  while (--size > 0) {
+    index ^= 1;
+    uint8_t byte = bytes[index];
     while(!(SPSR & (1 << SPIF)));
-    *buf++ = SPDR;
+    SPDR = byte;
   }
+  while(!(SPSR & (1 << SPIF)));
 }
 
 void spi_set_ss(uint8_t bit) {
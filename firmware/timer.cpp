@@ -26,7 +26,11 @@
 
 #include "timer.h"
 
-static uint16_t ms_counter;
+// Timer 1 counts this many ticks per millisecond.
+#define TIMER1_TICKS_PER_MS    2500
+
+// Kept at 32 bits so that the microsecond count wraps around at 2^32.
+static uint32_t ms_counter;
 
 static uint8_t interrupts_enabled = 0;
 
@@ -40,8 +44,9 @@ void timer_init() {
   TCCR1B |= (1 << WGM12);               // Configure Timer 1 for CTC mode.
   TCCR1B |= (1 << CS11);                // speed = F_CPU / 8.
   TIMSK1 |= (1 << OCIE1A);              // Enable CTC interrupt.
-  OCR1A   = 2500;        // Set CTC compare value to trigger at 1 kHz given
-                         // a 20-MHz clock with prescaler of 8 (= 2.5 MHz).
+  OCR1A   = TIMER1_TICKS_PER_MS;   // Set CTC compare value to trigger at
+                                   // 1 kHz given a 20-MHz clock with
+                                   // prescaler of 8 (= 2.5 MHz).
 
   timer_reset();
 
@@ -73,7 +78,7 @@ uint16_t timer_get_ms() {
     reenable_interrupts = 1;
   }
 
-  uint16_t count = ms_counter;
+  uint16_t count = (uint16_t) ms_counter;
 
   if (reenable_interrupts) {
     interrupts_enabled = 1;
@@ -83,6 +88,25 @@ uint16_t timer_get_ms() {
   return count;
 }
 
+uint32_t timer_get_us() {
+  // Save the interrupt state rather than using |interrupts_enabled|, so that
+  // this works from within interrupt handlers too.
+  uint8_t sreg = SREG;
+  cli();
+
+  uint32_t count = ms_counter;
+  uint16_t ticks = TCNT1;
+  // If the counter has wrapped but its interrupt has not been handled yet, the
+  // millisecond count is one behind.
+  if ((TIFR1 & (1 << OCF1A)) && ticks < TIMER1_TICKS_PER_MS / 2)
+    ++count;
+
+  SREG = sreg;
+
+  // There are 2.5 ticks per microsecond. Keep the conversion in 16 bits.
+  return count * 1000 + ticks * 2 / 5;
+}
+
 // Interrupt handler for FatFS.
 ISR(TIMER0_COMPA_vect) {
   disk_timerproc();
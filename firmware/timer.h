@@ -31,4 +31,9 @@ void timer_reset();
 // Return the number of milliseconds since the last reset.
 uint16_t timer_get_ms();
 
+// Return the number of microseconds since the last reset. Wraps around at 2^32,
+// so intervals can be computed with unsigned subtraction. Safe to call from
+// interrupt handlers.
+uint32_t timer_get_us();
+
 #endif
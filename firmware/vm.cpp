@@ -0,0 +1,194 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube script VM.
+
+#include <string.h>
+
+#include "DuinoCube/mem.h"
+#include "DuinoCube/vm_defs.h"
+
+#include "shmem.h"
+
+#include "vm.h"
+
+// Instructions are read from shared memory in blocks of this many bytes, so
+// that straight-line code and short loops do not need a read per instruction.
+#define VM_FETCH_SIZE    32
+
+// Returns true if |size| bytes at |addr| are within the shared memory space,
+// or equivalently within the part of the Core address space that is visible to
+// the coprocessor.
+static bool is_valid_addr(uint16_t addr, uint8_t size) {
+  return addr <= SHARED_MEMORY_SIZE - size;
+}
+
+bool vm_run(const VM_Script* script, VM_Result* result) {
+  uint16_t regs[VM_NUM_REGS];
+  memset(regs, 0, sizeof(regs));
+  regs[1] = script->data_addr;
+
+  uint16_t max_steps =
+      script->max_steps ? script->max_steps : VM_DEFAULT_MAX_STEPS;
+
+  // Block of instructions that was last read from shared memory.
+  uint8_t code[VM_FETCH_SIZE];
+  uint16_t code_start = 0;
+  uint16_t code_len = 0;
+
+  result->error = VM_ERROR_NONE;
+  result->pc = 0;
+  result->num_steps = 0;
+
+  uint16_t pc = 0;
+  bool running = true;
+  while (running) {
+    if (pc % VM_INSTR_SIZE != 0 || pc >= script->code_size ||
+        script->code_size - pc < VM_INSTR_SIZE) {
+      result->error = VM_ERROR_BAD_JUMP;
+      break;
+    }
+    if (result->num_steps == max_steps) {
+      result->error = VM_ERROR_STEP_LIMIT;
+      break;
+    }
+
+    // Fetch the block containing the instruction, if it is not already here.
+    // If |pc| is before |code_start|, the difference wraps around.
+    if ((uint16_t)(pc - code_start) >= code_len) {
+      code_start = pc - pc % VM_FETCH_SIZE;
+      code_len = script->code_size - code_start;
+      if (code_len > VM_FETCH_SIZE)
+        code_len = VM_FETCH_SIZE;
+      shmem_read(script->code_addr + code_start, code, code_len);
+    }
+    const uint8_t* instr = code + (pc - code_start);
+
+    uint8_t op = instr[0];
+    uint8_t rd = instr[1] >> 4;
+    uint8_t rs = instr[1] & 0x0f;
+    uint16_t imm = instr[2] | (instr[3] << 8);
+
+    result->pc = pc;
+    // Register fields have room for more registers than there are.
+    if (rd >= VM_NUM_REGS || rs >= VM_NUM_REGS) {
+      result->error = VM_ERROR_INVALID_OP;
+      break;
+    }
+    uint16_t b = regs[rs] + imm;
+
+    ++result->num_steps;
+    pc += VM_INSTR_SIZE;
+
+    uint8_t byte;
+    switch (op) {
+    case VM_OP_END:
+      running = false;
+      break;
+
+    case VM_OP_MOV:
+      regs[rd] = b;
+      break;
+    case VM_OP_ADD:
+      regs[rd] += b;
+      break;
+    case VM_OP_SUB:
+      regs[rd] -= b;
+      break;
+    case VM_OP_MUL:
+      regs[rd] *= b;
+      break;
+    case VM_OP_AND:
+      regs[rd] &= b;
+      break;
+    case VM_OP_OR:
+      regs[rd] |= b;
+      break;
+    case VM_OP_XOR:
+      regs[rd] ^= b;
+      break;
+    case VM_OP_SHL:
+      regs[rd] = (b < 16) ? (regs[rd] << b) : 0;
+      break;
+    case VM_OP_SHR:
+      regs[rd] = (b < 16) ? (regs[rd] >> b) : 0;
+      break;
+    case VM_OP_SLT:
+      regs[rd] = ((int16_t)regs[rd] < (int16_t)b) ? 1 : 0;
+      break;
+
+    case VM_OP_LD:
+    case VM_OP_ST:
+    case VM_OP_CLD:
+    case VM_OP_CST:
+      if (!is_valid_addr(b, sizeof(regs[rd]))) {
+        result->error = VM_ERROR_BAD_ADDRESS;
+        running = false;
+        break;
+      }
+      // The Core address space starts at the end of shared memory.
+      if (op == VM_OP_CLD || op == VM_OP_CST)
+        b += SHARED_MEMORY_SIZE;
+      if (op == VM_OP_LD || op == VM_OP_CLD)
+        shmem_read(b, &regs[rd], sizeof(regs[rd]));
+      else
+        shmem_write(b, &regs[rd], sizeof(regs[rd]));
+      break;
+    case VM_OP_LDB:
+    case VM_OP_STB:
+      if (!is_valid_addr(b, sizeof(byte))) {
+        result->error = VM_ERROR_BAD_ADDRESS;
+        running = false;
+        break;
+      }
+      if (op == VM_OP_LDB) {
+        shmem_read(b, &byte, sizeof(byte));
+        regs[rd] = byte;
+      } else {
+        byte = regs[rd];
+        shmem_write(b, &byte, sizeof(byte));
+      }
+      break;
+
+    case VM_OP_JMP:
+      pc = b;
+      break;
+    case VM_OP_JZ:
+      if (regs[rd] == 0)
+        pc = imm;
+      break;
+    case VM_OP_JNZ:
+      if (regs[rd] != 0)
+        pc = imm;
+      break;
+    case VM_OP_DJNZ:
+      if (--regs[rd] != 0)
+        pc = imm;
+      break;
+
+    default:
+      result->error = VM_ERROR_INVALID_OP;
+      running = false;
+      break;
+    }
+
+    // r0 always reads as zero.
+    regs[0] = 0;
+  }
+
+  return result->error == VM_ERROR_NONE;
+}
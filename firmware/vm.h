@@ -0,0 +1,49 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube script VM, for running bytecode scripts from shared memory. See
+// DuinoCube/vm_defs.h for the instruction set.
+//
+// The interpreter only accesses memory through shmem_read() and shmem_write(),
+// so that it can also be built on Linux by utils/vmrun.
+
+#ifndef __VM_H__
+#define __VM_H__
+
+#include <stdint.h>
+
+// Where a script is and how to run it.
+struct VM_Script {
+  uint16_t code_addr;     // Shared memory address of the bytecode.
+  uint16_t code_size;     // Size of the bytecode in bytes.
+  uint16_t data_addr;     // Initial value of r1.
+  uint16_t max_steps;     // Max number of instructions to run, or 0 for
+                          // VM_DEFAULT_MAX_STEPS.
+};
+
+// Outcome of running a script.
+struct VM_Result {
+  uint16_t error;         // VM_ERROR_* code.
+  uint16_t pc;            // Offset of the last instruction that was run.
+  uint16_t num_steps;     // Number of instructions that were run.
+};
+
+// Runs |script| from the beginning until it ends or fails. Returns true if it
+// ended without an error.
+bool vm_run(const VM_Script* script, VM_Result* result);
+
+#endif  // __VM_H__
@@ -0,0 +1,129 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube extended address space access.
+
+#include "DuinoCube/core_defs.h"
+#include "DuinoCube/mem.h"
+#include "DuinoCube/xaddr.h"
+
+#include "flash.h"
+#include "shmem.h"
+
+#include "xmem.h"
+
+// Core memory bank and VRAM access state that is currently set, and what it
+// was before xmem_begin().
+static uint16_t mem_bank;
+static uint16_t sys_ctrl;
+static uint16_t saved_mem_bank;
+static uint16_t saved_sys_ctrl;
+
+// The flash select pin is only driven once the flash is accessed, so that it
+// does not interfere with the FPGA loading its configuration at power up.
+static bool flash_ready;
+
+static uint16_t core_read_word(uint16_t addr) {
+  uint16_t value;
+  shmem_read(SHARED_MEMORY_SIZE + addr, &value, sizeof(value));
+  return value;
+}
+
+static void core_write_word(uint16_t addr, uint16_t value) {
+  shmem_write(SHARED_MEMORY_SIZE + addr, &value, sizeof(value));
+}
+
+// Maps Core memory bank |bank| to VRAM_BASE. VRAM banks also need VRAM access
+// to be enabled, while the tile map bank needs it to be disabled.
+static void select_bank(uint16_t bank) {
+  uint16_t new_sys_ctrl = (bank >= VRAM_BANK_BEGIN) ?
+      (1 << REG_SYS_CTRL_VRAM_ACCESS) : (0 << REG_SYS_CTRL_VRAM_ACCESS);
+  if (new_sys_ctrl != sys_ctrl) {
+    sys_ctrl = new_sys_ctrl;
+    core_write_word(REG_SYS_CTRL, sys_ctrl);
+  }
+  if (bank != mem_bank) {
+    mem_bank = bank;
+    core_write_word(REG_MEM_BANK, mem_bank);
+  }
+}
+
+void xmem_begin() {
+  // Only the VRAM access bit is saved. Writing back the other bits, such as
+  // the reset bit, would have side effects.
+  saved_sys_ctrl =
+      core_read_word(REG_SYS_CTRL) & (1 << REG_SYS_CTRL_VRAM_ACCESS);
+  saved_mem_bank = core_read_word(REG_MEM_BANK);
+  sys_ctrl = saved_sys_ctrl;
+  mem_bank = saved_mem_bank;
+}
+
+void xmem_end() {
+  if (sys_ctrl != saved_sys_ctrl)
+    core_write_word(REG_SYS_CTRL, saved_sys_ctrl);
+  if (mem_bank != saved_mem_bank)
+    core_write_word(REG_MEM_BANK, saved_mem_bank);
+}
+
+uint32_t xmem_get_span(uint32_t addr, bool for_write) {
+  if (addr < XADDR_SHMEM_BASE + SHARED_MEMORY_SIZE)
+    return XADDR_SHMEM_BASE + SHARED_MEMORY_SIZE - addr;
+  if (addr >= XADDR_CORE_BASE && addr < XADDR_CORE_BASE + XADDR_CORE_SIZE)
+    return XADDR_CORE_BASE + XADDR_CORE_SIZE - addr;
+  if (addr >= XADDR_BANK(XADDR_BANK_FIRST, 0) &&
+      addr < XADDR_BANK(XADDR_BANK_END, 0)) {
+    return XADDR_BANK_SIZE - (addr - XADDR_BANK_BASE) % XADDR_BANK_SIZE;
+  }
+  if (!for_write && addr >= XADDR_FLASH_BASE &&
+      addr < XADDR_FLASH_BASE + XADDR_FLASH_SIZE) {
+    return XADDR_FLASH_BASE + XADDR_FLASH_SIZE - addr;
+  }
+  return 0;
+}
+
+// Returns the shared memory address through which |addr| is accessed, and
+// selects its memory bank if necessary. Must not be called for flash
+// addresses.
+static uint16_t map_addr(uint32_t addr) {
+  if (addr < XADDR_SHMEM_BASE + SHARED_MEMORY_SIZE)
+    return addr - XADDR_SHMEM_BASE;
+  if (addr < XADDR_CORE_BASE + XADDR_CORE_SIZE)
+    return SHARED_MEMORY_SIZE + (addr - XADDR_CORE_BASE);
+  select_bank((addr - XADDR_BANK_BASE) / XADDR_BANK_SIZE);
+  return SHARED_MEMORY_SIZE + VRAM_BASE +
+         (addr - XADDR_BANK_BASE) % XADDR_BANK_SIZE;
+}
+
+void xmem_read(uint32_t addr, void* data, uint16_t size) {
+  if (addr >= XADDR_FLASH_BASE) {
+    if (!flash_ready) {
+      flash_init();
+      flash_ready = true;
+    }
+    flash_read(addr - XADDR_FLASH_BASE, data, size);
+    return;
+  }
+  shmem_read(map_addr(addr), data, size);
+}
+
+void xmem_write(uint32_t addr, const void* data, uint16_t size) {
+  shmem_write(map_addr(addr), data, size);
+}
+
+void xmem_fill(uint32_t addr, uint16_t value, uint16_t size) {
+  shmem_fill(map_addr(addr), value, size);
+}
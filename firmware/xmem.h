@@ -0,0 +1,46 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// DuinoCube extended address space access. See DuinoCube/xaddr.h for the
+// address map.
+
+#ifndef __XMEM_H__
+#define __XMEM_H__
+
+#include <stdint.h>
+
+// Saves the Core memory bank and VRAM access state before a series of
+// accesses, and restores them afterwards, so that the client does not see
+// them change.
+void xmem_begin();
+void xmem_end();
+
+// Returns the number of bytes that can be accessed in one go starting at
+// |addr|, i.e. up to the end of its region or memory bank. Returns 0 if |addr|
+// is not a valid address, or if |for_write| is set and it cannot be written.
+uint32_t xmem_get_span(uint32_t addr, bool for_write);
+
+// Reads or writes |size| bytes at |addr|. The range must be within the span of
+// |addr|.
+void xmem_read(uint32_t addr, void* data, uint16_t size);
+void xmem_write(uint32_t addr, const void* data, uint16_t size);
+
+// Fills |size| bytes at |addr| with the 16-bit pattern |value|, low byte
+// first. The range must be within the span of |addr|.
+void xmem_fill(uint32_t addr, uint16_t value, uint16_t size);
+
+#endif  // __XMEM_H__
@@ -0,0 +1,127 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// Computes the CRC-32 of asset files, or of ranges within them, the same way
+// that RPC_CMD_CRC does on the coprocessor.  Compare the output against
+// DuinoCube::Mem::crc() to check that a file was loaded correctly.
+//
+// Build:
+//   g++ -O2 -o crc32 utils/crc32.cpp
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace {
+
+// Reflected CRC-32 polynomial 0x04c11db7, as used by zlib and the firmware.
+const uint32_t kPolynomial = 0xedb88320;
+
+uint32_t g_table[256];
+
+void InitTable() {
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; ++bit)
+      crc = (crc & 1) ? (crc >> 1) ^ kPolynomial : crc >> 1;
+    g_table[i] = crc;
+  }
+}
+
+// Returns the CRC of |size| bytes of |fp| from |offset|, or of the rest of the
+// file if |size| is negative. Returns false if the range is not in the file.
+bool ComputeCRC(FILE* fp, long offset, long size, uint32_t* crc) {
+  if (fseek(fp, offset, SEEK_SET) != 0)
+    return false;
+
+  uint32_t value = ~0U;
+  uint8_t buf[4096];
+  while (size != 0) {
+    size_t size_to_read = sizeof(buf);
+    if (size > 0 && (size_t)size < size_to_read)
+      size_to_read = size;
+    size_t size_read = fread(buf, 1, size_to_read, fp);
+    if (size_read == 0)
+      break;
+    for (size_t i = 0; i < size_read; ++i)
+      value = (value >> 8) ^ g_table[(value ^ buf[i]) & 0xff];
+    if (size > 0)
+      size -= size_read;
+  }
+  *crc = ~value;
+  return size <= 0;
+}
+
+void PrintUsage() {
+  printf("Usage:\n");
+  printf("  crc32 [options] [file] ...\n");
+  printf("Options:\n");
+  printf("  -o offset       Start of the range in each file (default 0).\n");
+  printf("  -n size         Size of the range (default: the rest of the "
+         "file).\n");
+  printf("\n");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  long offset = 0;
+  long size = -1;
+
+  int c;
+  while ((c = getopt(argc, argv, "o:n:")) != -1) {
+    switch (c) {
+    case 'o':
+      offset = strtol(optarg, NULL, 0);
+      break;
+    case 'n':
+      size = strtol(optarg, NULL, 0);
+      break;
+    default:
+      PrintUsage();
+      return 1;
+    }
+  }
+  if (optind >= argc) {
+    PrintUsage();
+    return 0;
+  }
+
+  InitTable();
+
+  int result = 0;
+  for (int i = optind; i < argc; ++i) {
+    FILE* fp = fopen(argv[i], "rb");
+    if (!fp) {
+      fprintf(stderr, "Could not open %s.\n", argv[i]);
+      result = 1;
+      continue;
+    }
+
+    uint32_t crc;
+    if (ComputeCRC(fp, offset, size, &crc)) {
+      printf("0x%08x  %s\n", crc, argv[i]);
+    } else {
+      fprintf(stderr, "%s is too small for the range.\n", argv[i]);
+      result = 1;
+    }
+    fclose(fp);
+  }
+
+  return result;
+}
@@ -0,0 +1,483 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// Benchmark for the DuinoCube shared memory heap, firmware/shmem_heap.cpp.
+// Replays allocation traces against the heap and reports how many allocations
+// fit, how well the heap is used, and the time per operation on the host.
+// Shared memory is simulated, so that the contents of relocatable allocations
+// can be checked after the heap has been compacted.
+//
+// Build from the top of the repo:
+//   g++ -O2 -I. -o membench utils/membench.cpp firmware/shmem_heap.cpp
+//
+// Trace format, one operation per line:
+//   a <id> <size>    Allocate |size| bytes, and refer to it as |id| later.
+//   h <id> <size>    Allocate |size| relocatable bytes through a handle.
+//   f <id>           Free allocation |id|.
+// Anything after a '#' is a comment.  Without a trace file, a set of built-in
+// synthetic traces is run.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "DuinoCube/mem.h"
+
+#include "firmware/shmem.h"
+
+namespace {
+
+struct Operation {
+  char type;      // 'a', 'h' or 'f', as in the trace format.
+  int id;
+  uint16_t size;
+};
+
+struct Trace {
+  std::string name;
+  std::vector<Operation> ops;
+};
+
+// Number of times each trace is replayed for timing.
+const int kNumTimingRuns = 200;
+
+// Simple deterministic random number generator, so that the synthetic traces
+// are the same on every host.
+uint32_t g_random_state = 1;
+uint32_t Random(uint32_t range) {
+  g_random_state = g_random_state * 1103515245 + 12345;
+  return ((g_random_state >> 16) & 0x7fff) % range;
+}
+
+void AddAlloc(Trace* trace, int id, uint16_t size) {
+  Operation op = { 'a', id, size };
+  trace->ops.push_back(op);
+}
+
+void AddHandleAlloc(Trace* trace, int id, uint16_t size) {
+  Operation op = { 'h', id, size };
+  trace->ops.push_back(op);
+}
+
+void AddFree(Trace* trace, int id) {
+  Operation op = { 'f', id, 0 };
+  trace->ops.push_back(op);
+}
+
+// Many small objects with random lifetimes, e.g. per-object state.
+Trace MakeSmallTrace() {
+  Trace trace;
+  trace.name = "small";
+  std::vector<int> live;
+  int next_id = 0;
+  for (int i = 0; i < 2000; ++i) {
+    if (live.size() < 40 || (live.size() < 200 && Random(3) != 0)) {
+      AddAlloc(&trace, next_id, 4 + Random(60));
+      live.push_back(next_id++);
+    } else {
+      int index = Random(live.size());
+      AddFree(&trace, live[index]);
+      live.erase(live.begin() + index);
+    }
+  }
+  for (size_t i = 0; i < live.size(); ++i)
+    AddFree(&trace, live[i]);
+  return trace;
+}
+
+// A mix of small buffers and large ones such as images and tile maps.
+Trace MakeMixedTrace() {
+  Trace trace;
+  trace.name = "mixed";
+  std::vector<int> live;
+  int next_id = 0;
+  for (int i = 0; i < 2000; ++i) {
+    if (live.size() < 10 || (live.size() < 80 && Random(2) == 0)) {
+      uint16_t size = Random(4) == 0 ? 256 + Random(2048) : 8 + Random(200);
+      AddAlloc(&trace, next_id, size);
+      live.push_back(next_id++);
+    } else {
+      int index = Random(live.size());
+      AddFree(&trace, live[index]);
+      live.erase(live.begin() + index);
+    }
+  }
+  for (size_t i = 0; i < live.size(); ++i)
+    AddFree(&trace, live[i]);
+  return trace;
+}
+
+// Levels that each load a few large buffers and many small ones, and free
+// everything at the end.
+Trace MakeLevelTrace() {
+  Trace trace;
+  trace.name = "level";
+  int next_id = 0;
+  for (int level = 0; level < 20; ++level) {
+    int first_id = next_id;
+    for (int i = 0; i < 4; ++i)
+      AddAlloc(&trace, next_id++, 1024 + Random(3072));
+    for (int i = 0; i < 60; ++i)
+      AddAlloc(&trace, next_id++, 6 + Random(40));
+    for (int id = first_id; id < next_id; ++id)
+      AddFree(&trace, id);
+  }
+  return trace;
+}
+
+// A long session of levels whose large buffers vary in size. Each level loads
+// its buffers before the previous level's are freed, and keeps a few small
+// objects, which are never moved. With |use_handles|, the large buffers are
+// relocatable.
+Trace MakeSessionTrace(bool use_handles) {
+  Trace trace;
+  trace.name = use_handles ? "session-handles" : "session";
+  uint32_t random_state = g_random_state;
+  g_random_state = 1;
+  int next_id = 0;
+  std::vector<int> prev_level;
+  for (int level = 0; level < 40; ++level) {
+    std::vector<int> this_level;
+    for (int i = 0; i < 3; ++i) {
+      uint16_t size = 1024 + Random(5120);
+      if (use_handles)
+        AddHandleAlloc(&trace, next_id, size);
+      else
+        AddAlloc(&trace, next_id, size);
+      this_level.push_back(next_id++);
+    }
+    for (int i = 0; i < 4; ++i) {
+      AddAlloc(&trace, next_id, 16 + Random(100));
+      this_level.push_back(next_id++);
+    }
+    for (size_t i = 0; i < prev_level.size(); ++i)
+      AddFree(&trace, prev_level[i]);
+    prev_level = this_level;
+  }
+  for (size_t i = 0; i < prev_level.size(); ++i)
+    AddFree(&trace, prev_level[i]);
+  g_random_state = random_state;
+  return trace;
+}
+
+// Reads a trace file.  Returns false and prints an error if it is malformed.
+bool ReadTrace(const char* filename, Trace* trace) {
+  FILE* fp = fopen(filename, "r");
+  if (!fp) {
+    fprintf(stderr, "Could not open %s.\n", filename);
+    return false;
+  }
+  trace->name = filename;
+
+  char line[256];
+  int line_number = 0;
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), fp)) {
+    ++line_number;
+    char* comment_start = strchr(line, '#');
+    if (comment_start)
+      *comment_start = '\0';
+
+    char op;
+    int id;
+    unsigned int size;
+    int num_fields = sscanf(line, " %c %d %u", &op, &id, &size);
+    if (num_fields <= 0)
+      continue;
+    if (op == 'a' && num_fields == 3 && size <= 0xffff) {
+      AddAlloc(trace, id, size);
+    } else if (op == 'h' && num_fields == 3 && size <= 0xffff) {
+      AddHandleAlloc(trace, id, size);
+    } else if (op == 'f' && num_fields >= 2) {
+      AddFree(trace, id);
+    } else {
+      fprintf(stderr, "%s:%d: invalid operation.\n", filename, line_number);
+      ok = false;
+    }
+  }
+  fclose(fp);
+  return ok;
+}
+
+void PrintTrace(const Trace& trace) {
+  for (size_t i = 0; i < trace.ops.size(); ++i) {
+    const Operation& op = trace.ops[i];
+    if (op.type == 'f')
+      printf("f %d\n", op.id);
+    else
+      printf("%c %d %u\n", op.type, op.id, op.size);
+  }
+}
+
+double GetTimeNs() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+// Simulated shared memory, and the number of bytes moved by compaction.
+std::vector<uint8_t> g_memory(SHARED_MEMORY_SIZE);
+uint32_t g_num_bytes_moved = 0;
+
+// A live allocation.
+struct Allocation {
+  bool is_handle;
+  uint16_t addr_or_handle;
+  uint16_t size;
+};
+
+// Returns the byte that fills allocation |id|.
+uint8_t GetPattern(int id) {
+  return id * 31 + 7;
+}
+
+// Allocates for |op|. Returns false if it did not fit.
+bool Allocate(const Operation& op, Allocation* alloc) {
+  alloc->is_handle = (op.type == 'h');
+  alloc->size = op.size;
+  if (alloc->is_handle)
+    alloc->addr_or_handle = shmem_alloc_handle(op.size);
+  else
+    alloc->addr_or_handle = shmem_alloc(op.size);
+  return alloc->addr_or_handle != 0;
+}
+
+void Free(const Allocation& alloc) {
+  if (alloc.is_handle)
+    shmem_free_handle(alloc.addr_or_handle);
+  else
+    shmem_free(alloc.addr_or_handle);
+}
+
+// Replays |trace| once, and checks that live allocations never overlap, and
+// that their contents survive compaction.  Prints the results.  Returns false
+// if the heap misbehaved.
+bool Evaluate(const Trace& trace) {
+  shmem_heap_init();
+  g_num_bytes_moved = 0;
+
+  std::map<int, Allocation> live;
+  int num_allocs = 0;
+  int num_failed = 0;
+  uint32_t live_size = 0;
+  uint32_t peak_live_size = 0;
+  // Fraction of the used heap memory that holds live data, when the amount of
+  // live data peaks.
+  double peak_use = 1.0;
+  uint16_t peak_fragmentation = 0;
+
+  for (size_t i = 0; i < trace.ops.size(); ++i) {
+    const Operation& op = trace.ops[i];
+    if (op.type != 'f') {
+      ++num_allocs;
+      Allocation alloc;
+      if (!Allocate(op, &alloc)) {
+        ++num_failed;
+        continue;
+      }
+      uint16_t addr = alloc.addr_or_handle;
+      if (alloc.is_handle)
+        addr = shmem_lock(alloc.addr_or_handle);
+      if (addr < SHARED_MEMORY_HEAP_START ||
+          addr + op.size > SHARED_MEMORY_SIZE) {
+        printf("%s: op %zu: address 0x%04x is outside of the heap.\n",
+               trace.name.c_str(), i, addr);
+        return false;
+      }
+      // An allocation that overlaps a live one clobbers its contents, which is
+      // caught when that one is freed.
+      memset(&g_memory[addr], GetPattern(op.id), op.size);
+      if (alloc.is_handle)
+        shmem_unlock(alloc.addr_or_handle);
+      live[op.id] = alloc;
+      live_size += op.size;
+    } else {
+      std::map<int, Allocation>::iterator iter = live.find(op.id);
+      // Allocations that failed are not freed.
+      if (iter == live.end())
+        continue;
+      const Allocation& alloc = iter->second;
+      uint16_t addr = alloc.addr_or_handle;
+      if (alloc.is_handle)
+        addr = shmem_lock(alloc.addr_or_handle);
+      for (uint32_t a = addr; a < addr + alloc.size; ++a) {
+        if (g_memory[a] != GetPattern(op.id)) {
+          printf("%s: op %zu: contents of allocation %d at 0x%04x were "
+                 "overwritten.\n", trace.name.c_str(), i, op.id, a);
+          return false;
+        }
+      }
+      if (alloc.is_handle) {
+        if (!shmem_unlock(alloc.addr_or_handle) ||
+            !shmem_free_handle(alloc.addr_or_handle)) {
+          printf("%s: op %zu: could not free handle %u.\n",
+                 trace.name.c_str(), i, alloc.addr_or_handle);
+          return false;
+        }
+      } else if (!shmem_free(addr)) {
+        printf("%s: op %zu: could not free 0x%04x.\n",
+               trace.name.c_str(), i, addr);
+        return false;
+      }
+      live_size -= alloc.size;
+      live.erase(iter);
+    }
+
+    ShmemHeapStats stats;
+    shmem_stat(&stats);
+    uint16_t used_size = SHARED_MEMORY_HEAP_SIZE - stats.total_free_size;
+    if (live_size > peak_live_size) {
+      peak_live_size = live_size;
+      peak_use = (double)live_size / used_size;
+    }
+    if (stats.total_free_size > 0) {
+      uint16_t fragmentation = 100 -
+          (uint32_t)stats.largest_free_size * 100 / stats.total_free_size;
+      if (fragmentation > peak_fragmentation)
+        peak_fragmentation = fragmentation;
+    }
+  }
+
+  ShmemHeapStats stats;
+  shmem_stat(&stats);
+  if (live.empty() && stats.total_free_size != SHARED_MEMORY_HEAP_SIZE) {
+    printf("%s: %u bytes were not returned to the heap.\n", trace.name.c_str(),
+           SHARED_MEMORY_HEAP_SIZE - stats.total_free_size);
+    return false;
+  }
+
+  printf("%s: %zu ops, %d allocs, fit rate %.1f%%, peak live %u bytes, "
+         "use at peak %.1f%%, peak fragmentation %u%%, high water %u bytes, "
+         "%u bytes moved\n",
+         trace.name.c_str(), trace.ops.size(), num_allocs,
+         num_allocs ? 100.0 * (num_allocs - num_failed) / num_allocs : 100.0,
+         peak_live_size, 100.0 * peak_use, peak_fragmentation,
+         stats.high_water_size, g_num_bytes_moved);
+  return true;
+}
+
+// Replays |trace| repeatedly and prints the average time per operation,
+// including any compaction.
+void Time(const Trace& trace) {
+  std::map<int, Allocation> allocs;
+  double alloc_time = 0;
+  double free_time = 0;
+  int num_allocs = 0;
+  int num_frees = 0;
+  for (int run = 0; run < kNumTimingRuns; ++run) {
+    shmem_heap_init();
+    allocs.clear();
+    for (size_t i = 0; i < trace.ops.size(); ++i) {
+      const Operation& op = trace.ops[i];
+      if (op.type != 'f') {
+        Allocation alloc;
+        double start = GetTimeNs();
+        bool ok = Allocate(op, &alloc);
+        alloc_time += GetTimeNs() - start;
+        ++num_allocs;
+        if (ok)
+          allocs[op.id] = alloc;
+      } else {
+        std::map<int, Allocation>::iterator iter = allocs.find(op.id);
+        if (iter == allocs.end())
+          continue;
+        double start = GetTimeNs();
+        Free(iter->second);
+        free_time += GetTimeNs() - start;
+        ++num_frees;
+        allocs.erase(iter);
+      }
+    }
+  }
+  printf("%s: %.0f ns per alloc, %.0f ns per free (host time)\n",
+         trace.name.c_str(),
+         num_allocs ? alloc_time / num_allocs : 0.0,
+         num_frees ? free_time / num_frees : 0.0);
+}
+
+void PrintUsage() {
+  printf("Usage:\n");
+  printf("  membench [trace files]\n");
+  printf("  membench -g [small|mixed|level|session|session-handles] > "
+         "[trace file]\n");
+  printf("The first form replays the given traces, or the built-in traces if "
+         "none are\n");
+  printf("given.  The second form writes out a built-in trace.\n");
+  printf("\n");
+}
+
+}  // namespace
+
+// Stands in for the firmware's shmem_move(), in firmware/shmem.cpp.
+void shmem_move(uint16_t dst, uint16_t src, uint16_t len) {
+  memmove(&g_memory[dst], &g_memory[src], len);
+  g_num_bytes_moved += len;
+}
+
+int main(int argc, char* argv[]) {
+  std::vector<Trace> traces;
+  traces.push_back(MakeSmallTrace());
+  traces.push_back(MakeMixedTrace());
+  traces.push_back(MakeLevelTrace());
+  traces.push_back(MakeSessionTrace(false));
+  traces.push_back(MakeSessionTrace(true));
+
+  int c;
+  while ((c = getopt(argc, argv, "g:h")) != -1) {
+    switch (c) {
+    case 'g':
+      for (size_t i = 0; i < traces.size(); ++i) {
+        if (traces[i].name == optarg) {
+          PrintTrace(traces[i]);
+          return 0;
+        }
+      }
+      PrintUsage();
+      return 1;
+    default:
+      PrintUsage();
+      return 1;
+    }
+  }
+
+  if (optind < argc) {
+    traces.clear();
+    for (int i = optind; i < argc; ++i) {
+      Trace trace;
+      if (!ReadTrace(argv[i], &trace))
+        return 1;
+      traces.push_back(trace);
+    }
+  }
+
+  bool ok = true;
+  for (size_t i = 0; i < traces.size(); ++i) {
+    if (!Evaluate(traces[i])) {
+      ok = false;
+      continue;
+    }
+    Time(traces[i]);
+  }
+  return ok ? 0 : 1;
+}
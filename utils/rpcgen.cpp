@@ -0,0 +1,425 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// Generates RPC arg structs, client stubs and the firmware command dispatch
+// table from the RPC command table, DuinoCube/rpc_commands.txt.  See that file
+// for the table format.
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// One arg field of a command.
+struct Field {
+  std::string type;
+  std::string name;
+  std::string comment;
+};
+
+// One command from the table.
+struct Command {
+  std::string name;           // e.g. FILE_OPEN for RPC_CMD_FILE_OPEN.
+  int code;
+  std::string struct_name;    // e.g. FileOpen for RPC_FileOpenArgs.
+  std::string handler;
+  bool priority;
+  bool generated;
+  std::vector<Field> in;
+  std::vector<Field> out;
+};
+
+const char kLicense[] =
+  "// Copyright (C) 2014 Simon Que\n"
+  "//\n"
+  "// This file is part of DuinoCube.\n"
+  "//\n"
+  "// DuinoCube is free software: you can redistribute it and/or modify\n"
+  "// it under the terms of the GNU Lesser General Public License as "
+  "published by\n"
+  "// the Free Software Foundation, either version 3 of the License, or\n"
+  "// (at your option) any later version.\n"
+  "//\n"
+  "// DuinoCube is distributed in the hope that it will be useful,\n"
+  "// but WITHOUT ANY WARRANTY; without even the implied warranty of\n"
+  "// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the\n"
+  "// GNU Lesser General Public License for more details.\n"
+  "//\n"
+  "// You should have received a copy of the GNU Lesser General Public "
+  "License\n"
+  "// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.\n"
+  "\n"
+  "// Generated by utils/rpcgen from DuinoCube/rpc_commands.txt.  "
+  "Do not edit.\n"
+  "\n";
+
+// Command codes are one byte.
+const int kMaxCommandCode = 0xff;
+
+bool IsValidType(const std::string& type) {
+  const char* const kTypes[] = {
+    "uint8_t", "uint16_t", "uint32_t", "int8_t", "int16_t", "int32_t",
+  };
+  for (size_t i = 0; i < sizeof(kTypes) / sizeof(kTypes[0]); ++i) {
+    if (type == kTypes[i])
+      return true;
+  }
+  return false;
+}
+
+// Reads the command table.  Returns false and prints an error if it is
+// malformed.
+bool ReadTable(const char* filename, std::vector<Command>* commands) {
+  FILE* fp = fopen(filename, "r");
+  if (!fp) {
+    fprintf(stderr, "Could not open %s.\n", filename);
+    return false;
+  }
+
+  char line_buf[256];
+  int line_number = 0;
+  bool ok = true;
+  while (ok && fgets(line_buf, sizeof(line_buf), fp)) {
+    ++line_number;
+
+    // Anything after a '#' is a comment.
+    std::string comment;
+    char* comment_start = strchr(line_buf, '#');
+    if (comment_start) {
+      *comment_start = '\0';
+      std::istringstream comment_stream(comment_start + 1);
+      std::getline(comment_stream >> std::ws, comment);
+    }
+
+    std::istringstream line(line_buf);
+    std::string keyword;
+    if (!(line >> keyword))
+      continue;
+
+    if (keyword == "command") {
+      Command command;
+      std::string code;
+      line >> command.name >> code >> command.struct_name >> command.handler;
+      command.code = strtol(code.c_str(), NULL, 0);
+      command.priority = false;
+      command.generated = false;
+      std::string flag;
+      while (line >> flag) {
+        if (flag == "priority") {
+          command.priority = true;
+        } else if (flag == "gen") {
+          command.generated = true;
+        } else {
+          fprintf(stderr, "%s:%d: unknown flag %s.\n",
+                  filename, line_number, flag.c_str());
+          ok = false;
+        }
+      }
+      if (command.handler.empty() ||
+          command.code <= 0 || command.code > kMaxCommandCode) {
+        fprintf(stderr, "%s:%d: invalid command.\n", filename, line_number);
+        ok = false;
+      }
+      for (size_t i = 0; i < commands->size(); ++i) {
+        if ((*commands)[i].code == command.code) {
+          fprintf(stderr, "%s:%d: duplicate code 0x%02x.\n",
+                  filename, line_number, command.code);
+          ok = false;
+        }
+      }
+      commands->push_back(command);
+    } else if (keyword == "in" || keyword == "out") {
+      Field field;
+      line >> field.type >> field.name;
+      field.comment = comment;
+      if (commands->empty() || !commands->back().generated ||
+          !IsValidType(field.type) || field.name.empty()) {
+        fprintf(stderr, "%s:%d: invalid field.\n", filename, line_number);
+        ok = false;
+        continue;
+      }
+      if (keyword == "in")
+        commands->back().in.push_back(field);
+      else
+        commands->back().out.push_back(field);
+    } else {
+      fprintf(stderr, "%s:%d: unknown keyword %s.\n",
+              filename, line_number, keyword.c_str());
+      ok = false;
+    }
+  }
+  fclose(fp);
+
+  return ok;
+}
+
+// Prints one packed struct of arg fields.
+void PrintFields(const char* name, const std::vector<Field>& fields) {
+  printf("  struct {\n");
+  for (size_t i = 0; i < fields.size(); ++i) {
+    std::string declaration = fields[i].type + " " + fields[i].name + ";";
+    if (fields[i].comment.empty())
+      printf("    %s\n", declaration.c_str());
+    else
+      printf("    %-27s // %s\n",
+             declaration.c_str(), fields[i].comment.c_str());
+  }
+  printf("  } __attribute__((packed)) %s;\n", name);
+}
+
+void PrintStructs(const std::vector<Command>& commands) {
+  printf("%s", kLicense);
+  printf("#ifndef __DUINOCUBE_RPC_GENERATED_H__\n");
+  printf("#define __DUINOCUBE_RPC_GENERATED_H__\n\n");
+  printf("#include <stdint.h>\n\n");
+  printf("// Number of RPC commands, generated or not.\n");
+  printf("#define RPC_NUM_COMMANDS  %d\n", (int) commands.size());
+
+  for (size_t i = 0; i < commands.size(); ++i) {
+    const Command& command = commands[i];
+    if (!command.generated)
+      continue;
+    printf("\n// For RPC_CMD_%s.\n", command.name.c_str());
+    printf("typedef struct {\n");
+    if (command.in.empty())
+      printf("  // No inputs.\n");
+    else
+      PrintFields("in", command.in);
+    if (command.out.empty())
+      printf("  // No outputs.\n");
+    else
+      PrintFields("out", command.out);
+    printf("} RPC_%sArgs;\n", command.struct_name.c_str());
+  }
+
+  printf("\n#endif  // __DUINOCUBE_RPC_GENERATED_H__\n");
+}
+
+void PrintStubs(const std::vector<Command>& commands) {
+  printf("%s", kLicense);
+  printf("#ifndef __DUINOCUBE_RPC_STUBS_H__\n");
+  printf("#define __DUINOCUBE_RPC_STUBS_H__\n\n");
+  printf("#include <stddef.h>\n");
+  printf("#include <stdint.h>\n\n");
+  printf("#include \"rpc.h\"\n\n");
+  printf("namespace DuinoCube {\n\n");
+  printf("// Each stub executes its command with the given input args, "
+         "stores the output\n");
+  printf("// args through the given pointers and returns an RPC_STATUS_* "
+         "code.\n");
+  printf("namespace RPCStubs {\n");
+
+  for (size_t i = 0; i < commands.size(); ++i) {
+    const Command& command = commands[i];
+    if (!command.generated)
+      continue;
+
+    // The stub is named after the struct, in lower camel case.
+    std::string stub_name = command.struct_name;
+    stub_name[0] = tolower(stub_name[0]);
+
+    printf("\n// RPC_CMD_%s.\n", command.name.c_str());
+    // Wrap the parameter list to fit in 80 columns.
+    std::vector<std::string> params;
+    for (size_t j = 0; j < command.in.size(); ++j)
+      params.push_back(command.in[j].type + " " + command.in[j].name);
+    for (size_t j = 0; j < command.out.size(); ++j)
+      params.push_back(command.out[j].type + "* " + command.out[j].name);
+    std::string line = "inline uint16_t " + stub_name + "(";
+    const size_t indent = line.size();
+    for (size_t j = 0; j < params.size(); ++j) {
+      std::string param = params[j] + (j + 1 < params.size() ? "," : ") {");
+      if (j > 0 && line.size() + 1 + param.size() > 80) {
+        printf("%s\n", line.c_str());
+        line = std::string(indent, ' ') + param;
+      } else {
+        line += (j > 0 ? " " : "") + param;
+      }
+    }
+    if (params.empty())
+      line += ") {";
+    printf("%s\n", line.c_str());
+    if (!command.in.empty() || !command.out.empty())
+      printf("  RPC_%sArgs args;\n", command.struct_name.c_str());
+    for (size_t j = 0; j < command.in.size(); ++j) {
+      printf("  args.in.%s = %s;\n",
+             command.in[j].name.c_str(), command.in[j].name.c_str());
+    }
+    printf("  uint16_t status = RPC::exec(RPC_CMD_%s,\n", command.name.c_str());
+    if (command.in.empty())
+      printf("                              NULL, 0,\n");
+    else
+      printf("                              &args.in, sizeof(args.in),\n");
+    if (command.out.empty())
+      printf("                              NULL, 0);\n");
+    else
+      printf("                              &args.out, sizeof(args.out));\n");
+    for (size_t j = 0; j < command.out.size(); ++j) {
+      printf("  *%s = args.out.%s;\n",
+             command.out[j].name.c_str(), command.out[j].name.c_str());
+    }
+    printf("  return status;\n");
+    printf("}\n");
+  }
+
+  printf("\n}  // namespace RPCStubs\n\n");
+  printf("}  // namespace DuinoCube\n\n");
+  printf("#endif  // __DUINOCUBE_RPC_STUBS_H__\n");
+}
+
+void PrintDispatch(const std::vector<Command>& commands) {
+  int num_codes = 0;
+  for (size_t i = 0; i < commands.size(); ++i) {
+    if (commands[i].code >= num_codes)
+      num_codes = commands[i].code + 1;
+  }
+
+  printf("%s", kLicense);
+  printf("#include <avr/pgmspace.h>\n");
+  printf("#include <stddef.h>\n\n");
+  printf("#include \"DuinoCube/rpc.h\"\n\n");
+  printf("#include \"rpc_dispatch.h\"\n\n");
+
+  printf("// Make sure that the command codes match rpc.h.\n");
+  for (size_t i = 0; i < commands.size(); ++i) {
+    printf("typedef char rpc_check_%s[\n", commands[i].name.c_str());
+    printf("    (RPC_CMD_%s == 0x%02x) ? 1 : -1];\n",
+           commands[i].name.c_str(), commands[i].code);
+  }
+
+  printf("\n// Command handlers.\n");
+  for (size_t i = 0; i < commands.size(); ++i)
+    printf("uint8_t %s();\n", commands[i].handler.c_str());
+
+  printf("\n#define NUM_COMMAND_CODES  0x%02x\n\n", num_codes);
+
+  // Look up the handler and flags of each code.
+  std::vector<const Command*> commands_by_code(num_codes, NULL);
+  for (size_t i = 0; i < commands.size(); ++i)
+    commands_by_code[commands[i].code] = &commands[i];
+
+  printf("// Handlers indexed by command code.\n");
+  printf("static const RPC_Handler rpc_handlers[NUM_COMMAND_CODES] PROGMEM = "
+         "{\n");
+  for (int code = 0; code < num_codes; ++code) {
+    const Command* command = commands_by_code[code];
+    if (command)
+      printf("  %s,  // 0x%02x\n", command->handler.c_str(), code);
+    else
+      printf("  NULL,\n");
+  }
+  printf("};\n\n");
+
+  printf("// Index of each command code among the commands, in table order.\n");
+  printf("static const uint8_t rpc_command_indices[NUM_COMMAND_CODES] PROGMEM "
+         "= {\n");
+  for (int code = 0; code < num_codes; ++code) {
+    const Command* command = commands_by_code[code];
+    if (command)
+      printf("  %d,  // 0x%02x\n", (int) (command - &commands[0]), code);
+    else
+      printf("  RPC_NO_COMMAND_INDEX,\n");
+  }
+  printf("};\n\n");
+
+  printf("// Bitmap of commands that may be run from the priority lane.\n");
+  printf("static const uint8_t\n"
+         "    rpc_priority_commands[(NUM_COMMAND_CODES + 7) / 8] PROGMEM "
+         "= {\n");
+  for (int code = 0; code < num_codes; code += 8) {
+    uint8_t bits = 0;
+    for (int bit = 0; bit < 8 && code + bit < num_codes; ++bit) {
+      const Command* command = commands_by_code[code + bit];
+      if (command && command->priority)
+        bits |= (1 << bit);
+    }
+    printf("  0x%02x,\n", bits);
+  }
+  printf("};\n\n");
+
+  printf("RPC_Handler rpc_get_handler(uint8_t command) {\n");
+  printf("  if (command >= NUM_COMMAND_CODES)\n");
+  printf("    return NULL;\n");
+  printf("  return (RPC_Handler) pgm_read_word(&rpc_handlers[command]);\n");
+  printf("}\n\n");
+  printf("uint8_t rpc_get_command_index(uint8_t command) {\n");
+  printf("  if (command >= NUM_COMMAND_CODES)\n");
+  printf("    return RPC_NO_COMMAND_INDEX;\n");
+  printf("  return pgm_read_byte(&rpc_command_indices[command]);\n");
+  printf("}\n\n");
+  printf("bool rpc_is_priority_command(uint8_t command) {\n");
+  printf("  if (command >= NUM_COMMAND_CODES)\n");
+  printf("    return false;\n");
+  printf("  return (pgm_read_byte(&rpc_priority_commands[command / 8]) >>\n");
+  printf("          (command %% 8)) & 1;\n");
+  printf("}\n");
+}
+
+void PrintUsage() {
+  printf("Usage:\n");
+  printf("  rpcgen -t [output type] [command table] > [output file]\n");
+  printf("Output types:\n");
+  printf("  structs  Packed arg structs, for DuinoCube/rpc_generated.h.\n");
+  printf("  stubs    Client stubs, for DuinoCube/rpc_stubs.h.\n");
+  printf("  dispatch Command dispatch table, for firmware/rpc_dispatch.cpp.\n");
+  printf("\n");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string type;
+  int c;
+  while ((c = getopt(argc, argv, "t:")) != -1) {
+    switch (c) {
+    case 't':
+      type = optarg;
+      break;
+    default:
+      PrintUsage();
+      return 1;
+    }
+  }
+  if (optind >= argc || type.empty()) {
+    PrintUsage();
+    return 0;
+  }
+
+  std::vector<Command> commands;
+  if (!ReadTable(argv[optind], &commands))
+    return 1;
+
+  if (type == "structs") {
+    PrintStructs(commands);
+  } else if (type == "stubs") {
+    PrintStubs(commands);
+  } else if (type == "dispatch") {
+    PrintDispatch(commands);
+  } else {
+    PrintUsage();
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,431 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// Assembles DuinoCube coprocessor VM scripts.  See DuinoCube/vm_defs.h for the
+// instruction set.
+//
+// Source format, one statement per line:
+//   label:                  Defines a label at the current offset.
+//   .equ NAME value         Defines a constant.
+//   mov rd, B               Arithmetic and logic: mov add sub mul and or xor
+//                           shl shr slt.
+//   ld rd, [B]              Memory access: ld ldb st stb cld cst.
+//   jmp B                   Jump to B.
+//   jz rd, target           Conditional jumps: jz jnz djnz.
+//   end                     End the run.
+// B is a register, a value, or a register plus or minus values, e.g. r2,
+// 0x1000 or r1+OBJ_X-2.  Values are numbers, labels or constants.  Anything
+// after a ';' is a comment.
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "DuinoCube/vm_defs.h"
+
+namespace {
+
+// Operand formats.
+enum Format {
+  kNoOperands,        // end
+  kRegOperand,        // op rd, B
+  kRegMemory,         // op rd, [B]
+  kOperand,           // op B
+  kRegTarget,         // op rd, target
+};
+
+struct Mnemonic {
+  const char* name;
+  uint8_t opcode;
+  Format format;
+};
+
+const Mnemonic kMnemonics[] = {
+  { "end",  VM_OP_END,  kNoOperands },
+  { "mov",  VM_OP_MOV,  kRegOperand },
+  { "add",  VM_OP_ADD,  kRegOperand },
+  { "sub",  VM_OP_SUB,  kRegOperand },
+  { "mul",  VM_OP_MUL,  kRegOperand },
+  { "and",  VM_OP_AND,  kRegOperand },
+  { "or",   VM_OP_OR,   kRegOperand },
+  { "xor",  VM_OP_XOR,  kRegOperand },
+  { "shl",  VM_OP_SHL,  kRegOperand },
+  { "shr",  VM_OP_SHR,  kRegOperand },
+  { "slt",  VM_OP_SLT,  kRegOperand },
+  { "ld",   VM_OP_LD,   kRegMemory },
+  { "ldb",  VM_OP_LDB,  kRegMemory },
+  { "st",   VM_OP_ST,   kRegMemory },
+  { "stb",  VM_OP_STB,  kRegMemory },
+  { "cld",  VM_OP_CLD,  kRegMemory },
+  { "cst",  VM_OP_CST,  kRegMemory },
+  { "jmp",  VM_OP_JMP,  kOperand },
+  { "jz",   VM_OP_JZ,   kRegTarget },
+  { "jnz",  VM_OP_JNZ,  kRegTarget },
+  { "djnz", VM_OP_DJNZ, kRegTarget },
+};
+
+const Mnemonic* FindMnemonic(const std::string& name) {
+  for (size_t i = 0; i < sizeof(kMnemonics) / sizeof(kMnemonics[0]); ++i) {
+    if (name == kMnemonics[i].name)
+      return &kMnemonics[i];
+  }
+  return NULL;
+}
+
+// Labels and constants.
+typedef std::map<std::string, int> SymbolTable;
+
+// Parses a register name, e.g. "r3".  Returns -1 if |text| is not one.
+int ParseRegister(const std::string& text) {
+  if (text.size() != 2 || tolower(text[0]) != 'r' || !isdigit(text[1]))
+    return -1;
+  int reg = text[1] - '0';
+  return (reg < VM_NUM_REGS) ? reg : -1;
+}
+
+bool IsSymbolName(const std::string& text) {
+  if (text.empty() || !(isalpha(text[0]) || text[0] == '_'))
+    return false;
+  for (size_t i = 1; i < text.size(); ++i) {
+    if (!isalnum(text[i]) && text[i] != '_')
+      return false;
+  }
+  return true;
+}
+
+// Parses an operand of the form [reg][+-value...].  Stores the register in
+// |reg| (r0 if there is none) and the sum of the values in |value|.  If
+// |symbols| is NULL, all symbols are taken to be zero, for the first pass.
+// Returns false if the operand is malformed.
+bool ParseOperand(const std::string& text, const SymbolTable* symbols,
+                  int* reg, int* value, std::string* error) {
+  *reg = 0;
+  *value = 0;
+  bool has_reg = false;
+  size_t pos = 0;
+  bool first = true;
+  while (pos < text.size() || first) {
+    int sign = 1;
+    if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+      sign = (text[pos] == '-') ? -1 : 1;
+      ++pos;
+    } else if (!first) {
+      *error = "expected '+' or '-' in operand";
+      return false;
+    }
+    first = false;
+
+    size_t end = text.find_first_of("+-", pos);
+    std::string term =
+        text.substr(pos, end == std::string::npos ? std::string::npos
+                                                  : end - pos);
+    pos = (end == std::string::npos) ? text.size() : end;
+    if (term.empty()) {
+      *error = "missing value in operand";
+      return false;
+    }
+
+    int term_reg = ParseRegister(term);
+    if (term_reg >= 0) {
+      if (has_reg || sign < 0) {
+        *error = "only one register may be added in an operand";
+        return false;
+      }
+      has_reg = true;
+      *reg = term_reg;
+    } else if (isdigit(term[0])) {
+      char* num_end;
+      long num = strtol(term.c_str(), &num_end, 0);
+      if (*num_end != '\0') {
+        *error = "invalid number " + term;
+        return false;
+      }
+      *value += sign * num;
+    } else if (IsSymbolName(term)) {
+      if (symbols) {
+        SymbolTable::const_iterator iter = symbols->find(term);
+        if (iter == symbols->end()) {
+          *error = "undefined symbol " + term;
+          return false;
+        }
+        *value += sign * iter->second;
+      }
+    } else {
+      *error = "invalid operand " + term;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Parses an operand that must be a register.
+bool ParseRegOperand(const std::string& text, int* reg, std::string* error) {
+  *reg = ParseRegister(text);
+  if (*reg < 0) {
+    *error = "expected a register instead of " + text;
+    return false;
+  }
+  return true;
+}
+
+// Splits |text| at commas, and removes all whitespace.
+std::vector<std::string> SplitOperands(const std::string& text) {
+  std::vector<std::string> operands;
+  std::string operand;
+  bool empty = true;
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (text[i] == ',') {
+      operands.push_back(operand);
+      operand.clear();
+    } else if (!isspace(text[i])) {
+      operand += text[i];
+      empty = false;
+    }
+  }
+  if (!empty)
+    operands.push_back(operand);
+  return operands;
+}
+
+// Assembles one instruction.  If |symbols| is NULL, only checks the syntax.
+bool AssembleInstruction(const Mnemonic& mnemonic,
+                         const std::vector<std::string>& operands,
+                         const SymbolTable* symbols, uint8_t* instr,
+                         std::string* error) {
+  static const size_t kNumOperands[] = { 0, 2, 2, 1, 2 };
+  if (operands.size() != kNumOperands[mnemonic.format]) {
+    *error = std::string("wrong number of operands for ") + mnemonic.name;
+    return false;
+  }
+
+  int rd = 0;
+  int rs = 0;
+  int imm = 0;
+  switch (mnemonic.format) {
+  case kNoOperands:
+    break;
+  case kRegOperand:
+    if (!ParseRegOperand(operands[0], &rd, error) ||
+        !ParseOperand(operands[1], symbols, &rs, &imm, error)) {
+      return false;
+    }
+    break;
+  case kRegMemory: {
+    const std::string& address = operands[1];
+    if (address.size() < 2 || address[0] != '[' ||
+        address[address.size() - 1] != ']') {
+      *error = "expected a memory operand in brackets";
+      return false;
+    }
+    if (!ParseRegOperand(operands[0], &rd, error) ||
+        !ParseOperand(address.substr(1, address.size() - 2), symbols,
+                      &rs, &imm, error)) {
+      return false;
+    }
+    break;
+  }
+  case kOperand:
+    if (!ParseOperand(operands[0], symbols, &rs, &imm, error))
+      return false;
+    break;
+  case kRegTarget:
+    if (!ParseRegOperand(operands[0], &rd, error) ||
+        !ParseOperand(operands[1], symbols, &rs, &imm, error)) {
+      return false;
+    }
+    if (rs != 0) {
+      *error = "jump target cannot contain a register";
+      return false;
+    }
+    break;
+  }
+
+  if (imm < -0x8000 || imm > 0xffff) {
+    *error = "value out of range";
+    return false;
+  }
+  instr[0] = mnemonic.opcode;
+  instr[1] = (rd << 4) | rs;
+  instr[2] = imm & 0xff;
+  instr[3] = (imm >> 8) & 0xff;
+  return true;
+}
+
+// Assembles a source file in two passes.  The first pass defines the labels,
+// and the second one generates the code.  Returns false and prints an error if
+// the source is malformed.
+bool Assemble(const char* filename, std::vector<uint8_t>* code) {
+  FILE* fp = fopen(filename, "r");
+  if (!fp) {
+    fprintf(stderr, "Could not open %s.\n", filename);
+    return false;
+  }
+
+  SymbolTable symbols;
+  bool ok = true;
+  for (int pass = 0; ok && pass < 2; ++pass) {
+    rewind(fp);
+    code->clear();
+
+    char line_buf[256];
+    int line_number = 0;
+    while (ok && fgets(line_buf, sizeof(line_buf), fp)) {
+      ++line_number;
+      std::string error;
+
+      // Anything after a ';' is a comment.
+      char* comment_start = strchr(line_buf, ';');
+      if (comment_start)
+        *comment_start = '\0';
+      std::string line(line_buf);
+
+      // Labels.
+      size_t colon = line.find(':');
+      if (colon != std::string::npos) {
+        std::vector<std::string> label = SplitOperands(line.substr(0, colon));
+        if (label.size() != 1 || !IsSymbolName(label[0])) {
+          error = "invalid label";
+        } else if (pass == 0) {
+          if (symbols.count(label[0]))
+            error = "duplicate symbol " + label[0];
+          symbols[label[0]] = code->size();
+        }
+        line = line.substr(colon + 1);
+      }
+
+      // The first word is the mnemonic or directive.
+      size_t start = line.find_first_not_of(" \t\r\n");
+      std::string word;
+      std::string rest;
+      if (error.empty() && start != std::string::npos) {
+        size_t end = line.find_first_of(" \t\r\n", start);
+        word = line.substr(start, end == std::string::npos ? std::string::npos
+                                                           : end - start);
+        if (end != std::string::npos)
+          rest = line.substr(end);
+      }
+
+      if (!error.empty() || word.empty()) {
+        // Nothing more to do.
+      } else if (word == ".equ") {
+        // Constants are defined in the first pass, in order.
+        size_t name_start = rest.find_first_not_of(" \t");
+        size_t name_end = rest.find_first_of(" \t", name_start);
+        std::string name = (name_start == std::string::npos) ? "" :
+            rest.substr(name_start, name_end == std::string::npos ?
+                                    std::string::npos : name_end - name_start);
+        std::vector<std::string> value_text;
+        if (name_end != std::string::npos)
+          value_text = SplitOperands(rest.substr(name_end));
+        int reg;
+        int value;
+        if (!IsSymbolName(name) || value_text.size() != 1) {
+          error = "expected .equ NAME value";
+        } else if (pass == 0) {
+          if (symbols.count(name)) {
+            error = "duplicate symbol " + name;
+          } else if (ParseOperand(value_text[0], &symbols, &reg, &value,
+                                  &error)) {
+            if (reg != 0)
+              error = "constant cannot contain a register";
+            symbols[name] = value;
+          }
+        }
+      } else {
+        const Mnemonic* mnemonic = FindMnemonic(word);
+        uint8_t instr[VM_INSTR_SIZE];
+        if (!mnemonic) {
+          error = "unknown instruction " + word;
+        } else if (AssembleInstruction(*mnemonic, SplitOperands(rest),
+                                       pass == 0 ? NULL : &symbols,
+                                       instr, &error)) {
+          code->insert(code->end(), instr, instr + VM_INSTR_SIZE);
+        }
+      }
+
+      if (!error.empty()) {
+        fprintf(stderr, "%s:%d: %s.\n", filename, line_number, error.c_str());
+        ok = false;
+      }
+    }
+  }
+  fclose(fp);
+
+  if (ok && code->size() > 0xffff) {
+    fprintf(stderr, "%s: script is too large.\n", filename);
+    ok = false;
+  }
+  return ok;
+}
+
+// Prints the code as a C array, for embedding in a sketch.
+void PrintArray(const char* name, const std::vector<uint8_t>& code) {
+  printf("const uint8_t %s[] = {\n", name);
+  for (size_t i = 0; i < code.size(); i += VM_INSTR_SIZE) {
+    printf("  0x%02x, 0x%02x, 0x%02x, 0x%02x,\n",
+           code[i], code[i + 1], code[i + 2], code[i + 3]);
+  }
+  printf("};\n");
+}
+
+void PrintUsage() {
+  printf("Usage:\n");
+  printf("  vmasm [source file] > [output file]\n");
+  printf("  vmasm -c [array name] [source file] > [output file]\n");
+  printf("The first form writes the raw bytecode.  The second form writes it "
+         "as a C array.\n");
+  printf("\n");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const char* array_name = NULL;
+  int c;
+  while ((c = getopt(argc, argv, "c:")) != -1) {
+    switch (c) {
+    case 'c':
+      array_name = optarg;
+      break;
+    default:
+      PrintUsage();
+      return 1;
+    }
+  }
+  if (optind >= argc) {
+    PrintUsage();
+    return 0;
+  }
+
+  std::vector<uint8_t> code;
+  if (!Assemble(argv[optind], &code))
+    return 1;
+
+  if (array_name)
+    PrintArray(array_name, code);
+  else
+    fwrite(&code[0], 1, code.size(), stdout);
+
+  return 0;
+}
@@ -0,0 +1,204 @@
+// Copyright (C) 2014 Simon Que
+//
+// This file is part of DuinoCube.
+//
+// DuinoCube is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// DuinoCube is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with DuinoCube.  If not, see <http://www.gnu.org/licenses/>.
+
+// Reference interpreter for DuinoCube coprocessor VM scripts.  Runs a script
+// with the same interpreter as the firmware, firmware/vm.cpp, against a
+// simulated shared memory and Core address space, so that scripts can be
+// tested without the hardware.
+//
+// Build from the top of the repo:
+//   g++ -I. -o vmrun utils/vmrun.cpp firmware/vm.cpp
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "DuinoCube/mem.h"
+#include "DuinoCube/vm_defs.h"
+
+#include "firmware/shmem.h"
+#include "firmware/vm.h"
+
+namespace {
+
+// Shared memory, followed by the part of the Core address space that the
+// coprocessor can see.
+uint8_t g_memory[SHARED_MEMORY_SIZE * 2];
+
+// Print each write to the Core.
+bool g_trace_core_writes = false;
+
+// A range of memory to be printed after the script has run.
+struct DumpRange {
+  uint16_t addr;
+  uint16_t size;
+};
+
+const char* const kErrorNames[] = {
+  "none", "invalid instruction", "bad jump", "bad address", "step limit",
+};
+
+// Loads |filename| into memory at |addr|.  Returns the number of bytes that
+// were loaded, or -1 on error.
+int LoadFile(const char* filename, uint16_t addr) {
+  FILE* fp = fopen(filename, "rb");
+  if (!fp) {
+    fprintf(stderr, "Could not open %s.\n", filename);
+    return -1;
+  }
+  int size = fread(g_memory + addr, 1, sizeof(g_memory) - addr, fp);
+  fclose(fp);
+  return size;
+}
+
+void DumpMemory(const DumpRange& range) {
+  for (uint32_t offset = 0; offset < range.size; offset += 16) {
+    printf("%04x:", range.addr + offset);
+    for (uint32_t i = offset; i < offset + 16 && i < range.size; ++i)
+      printf(" %02x", g_memory[(range.addr + i) % sizeof(g_memory)]);
+    printf("\n");
+  }
+}
+
+void PrintUsage() {
+  printf("Usage:\n");
+  printf("  vmrun [options] [script file]\n");
+  printf("Options:\n");
+  printf("  -a addr         Shared memory address of the script "
+         "(default 0x%x).\n", SHARED_MEMORY_HEAP_START);
+  printf("  -d addr         Data address, the initial value of r1.\n");
+  printf("  -l file@addr    Load a file into memory first.  Core addresses "
+         "start at 0x%x.\n", SHARED_MEMORY_SIZE);
+  printf("  -n runs         Number of times to run the script (default 1).\n");
+  printf("  -s steps        Max instructions per run (default %d).\n",
+         VM_DEFAULT_MAX_STEPS);
+  printf("  -x addr:size    Print memory after running.\n");
+  printf("  -v              Print each write to the Core.\n");
+  printf("\n");
+}
+
+}  // namespace
+
+// Shared memory functions used by the interpreter.
+void shmem_read(uint16_t addr, void* data, uint16_t len) {
+  for (uint16_t i = 0; i < len; ++i)
+    ((uint8_t*)data)[i] = g_memory[(addr + i) % sizeof(g_memory)];
+}
+
+void shmem_write(uint16_t addr, const void* data, uint16_t len) {
+  for (uint16_t i = 0; i < len; ++i)
+    g_memory[(addr + i) % sizeof(g_memory)] = ((const uint8_t*)data)[i];
+
+  if (g_trace_core_writes && addr >= SHARED_MEMORY_SIZE) {
+    printf("  Core[0x%04x] =", addr - SHARED_MEMORY_SIZE);
+    for (uint16_t i = 0; i < len; ++i)
+      printf(" %02x", ((const uint8_t*)data)[i]);
+    printf("\n");
+  }
+}
+
+int main(int argc, char* argv[]) {
+  VM_Script script;
+  script.code_addr = SHARED_MEMORY_HEAP_START;
+  script.data_addr = 0;
+  script.max_steps = 0;
+  int num_runs = 1;
+  std::vector<DumpRange> dumps;
+
+  int c;
+  while ((c = getopt(argc, argv, "a:d:l:n:s:x:v")) != -1) {
+    switch (c) {
+    case 'a':
+      script.code_addr = strtoul(optarg, NULL, 0);
+      break;
+    case 'd':
+      script.data_addr = strtoul(optarg, NULL, 0);
+      break;
+    case 'l': {
+      std::string arg(optarg);
+      size_t at = arg.rfind('@');
+      if (at == std::string::npos) {
+        PrintUsage();
+        return 1;
+      }
+      uint32_t addr = strtoul(arg.c_str() + at + 1, NULL, 0);
+      if (addr >= sizeof(g_memory) ||
+          LoadFile(arg.substr(0, at).c_str(), addr) < 0) {
+        return 1;
+      }
+      break;
+    }
+    case 'n':
+      num_runs = atoi(optarg);
+      break;
+    case 's':
+      script.max_steps = strtoul(optarg, NULL, 0);
+      break;
+    case 'x': {
+      DumpRange range;
+      char* size_str;
+      range.addr = strtoul(optarg, &size_str, 0);
+      if (*size_str != ':') {
+        PrintUsage();
+        return 1;
+      }
+      range.size = strtoul(size_str + 1, NULL, 0);
+      dumps.push_back(range);
+      break;
+    }
+    case 'v':
+      g_trace_core_writes = true;
+      break;
+    default:
+      PrintUsage();
+      return 1;
+    }
+  }
+  if (optind >= argc) {
+    PrintUsage();
+    return 0;
+  }
+
+  // The script must fit in shared memory, like on the hardware.
+  int code_size = LoadFile(argv[optind], script.code_addr);
+  if (code_size < 0)
+    return 1;
+  if (script.code_addr + code_size > SHARED_MEMORY_SIZE) {
+    fprintf(stderr, "Script does not fit in shared memory.\n");
+    return 1;
+  }
+  script.code_size = code_size;
+
+  bool ok = true;
+  for (int run = 0; ok && run < num_runs; ++run) {
+    printf("Run %d:\n", run);
+    VM_Result result;
+    ok = vm_run(&script, &result);
+    printf("  error: %s, pc: 0x%04x, steps: %u\n",
+           kErrorNames[result.error], result.pc, result.num_steps);
+  }
+
+  for (size_t i = 0; i < dumps.size(); ++i)
+    DumpMemory(dumps[i]);
+
+  return ok ? 0 : 1;
+}